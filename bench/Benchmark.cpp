@@ -0,0 +1,194 @@
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "../src/Parser.hpp"
+#include "../src/Executer.hpp"
+#include "../src/Bytecode.hpp"
+#include "../src/DefiniteAssignment.hpp"
+#include "../src/VirtualMachine.hpp"
+#include "../src/RegisterMachine.hpp"
+#include "../src/Superinstructions.hpp"
+#include "../src/Optimizer.hpp"
+#include "../src/GlobalOptimizer.hpp"
+#include "../src/LoopOptimizer.hpp"
+#include "../src/RangeAnalysis.hpp"
+#include "../src/OpcodeProfile.hpp"
+#include "../src/Jit.hpp"
+#include "../src/TieredMachine.hpp"
+
+namespace mli {
+
+    // Discards the program output and counts its bytes.
+    class NullBuffer : public std::streambuf
+    {
+        private:
+            size_t m_bytes{};
+
+        protected:
+            int overflow(int a_char) override
+            {
+                ++m_bytes;
+                return a_char;
+            }
+
+            std::streamsize xsputn(const char*, std::streamsize a_count) override
+            {
+                m_bytes += a_count;
+                return a_count;
+            }
+
+        public:
+            size_t take()
+            {
+                size_t bytes = m_bytes;
+                m_bytes = 0;
+                return bytes;
+            }
+    };
+
+    class Benchmark
+    {
+        private:
+            struct Engine
+            {
+                std::string           name;
+                std::function<void()> run;
+            };
+
+            std::vector<Engine> m_engines;
+            int                 m_iterations;
+
+        public:
+
+            Benchmark(int a_iterations)
+                : m_iterations(a_iterations)
+            {
+            }
+
+            void add(const std::string& a_name, std::function<void()> a_run)
+            {
+                m_engines.push_back(Engine{a_name, a_run});
+            }
+
+            void run(std::ostream& a_out)
+            {
+                NullBuffer nullBuffer{};
+                double baseline{};
+
+                for (auto& engine : m_engines)
+                {
+                    std::streambuf* coutBuffer = std::cout.rdbuf(&nullBuffer);
+
+                    auto start = std::chrono::steady_clock::now();
+                    for (int i = 0; i < m_iterations; ++i)
+                    {
+                        engine.run();
+                    }
+                    auto finish = std::chrono::steady_clock::now();
+
+                    std::cout.rdbuf(coutBuffer);
+
+                    double ms = std::chrono::duration<double, std::milli>(finish - start).count() / m_iterations;
+                    double mb = nullBuffer.take() / 1e6 / m_iterations;
+                    baseline = baseline ? baseline : ms;
+
+                    a_out << std::left << std::setw(12) << engine.name
+                        << std::right << std::setw(12) << std::fixed << std::setprecision(3) << ms << " ms"
+                        << std::setw(10) << std::setprecision(2) << baseline / ms << "x";
+                    if (mb > 0)
+                    {
+                        a_out << std::setw(12) << mb / (ms / 1000) << " MB/s";
+                    }
+                    a_out << "\n";
+                }
+            }
+    };
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        if (argc != 2 && argc != 3)
+        {
+            throw std::runtime_error("[bench]: usage: mli_bench <program> [iterations]");
+        }
+
+        mli::Parser parser{argv[1]};
+        parser.analyze();
+
+        mli::Program program = mli::Compiler(parser.fetchPoliz(), parser.fetchVariables()).compile();
+        program = mli::DefiniteAssignment(program).check();
+
+        auto optimize = [&](int32_t a_unrollFactor)
+        {
+            mli::Program optimized = mli::Optimizer(program).optimize();
+            optimized = mli::GlobalOptimizer(optimized).optimize();
+            optimized = mli::LoopOptimizer(optimized, a_unrollFactor).optimize();
+            optimized = mli::RangeAnalysis(optimized).analyze();
+            return mli::Fuser(optimized).fuse();
+        };
+        mli::Program optimizedProgram = optimize(0);
+        mli::Program invertedProgram  = optimize(1);
+        mli::Program unrolledProgram  = optimize(mli::LoopOptimizer::s_defaultUnrollFactor);
+
+        program = mli::RangeAnalysis(program).analyze();
+        mli::RegisterProgram registerProgram = mli::RegisterTranslator(program).translate();
+        mli::Program         fusedProgram    = mli::Fuser(program).fuse();
+
+        mli::Executer        executer{};
+        mli::VirtualMachine  machine{};
+        mli::RegisterMachine registerMachine{};
+        mli::JitMachine      jit{};
+        mli::TieredMachine   tiered{};
+
+        mli::Benchmark benchmark{argc == 3 ? std::stoi(argv[2]) : 5};
+        benchmark.add("poliz",    [&]() { executer.executePoliz(parser.fetchPoliz()); });
+        benchmark.add("bytecode", [&]() { machine.execute(program); });
+        benchmark.add("fused",    [&]() { machine.execute(fusedProgram); });
+        benchmark.add("register", [&]() { registerMachine.execute(registerProgram); });
+        benchmark.add("optimized", [&]() { machine.execute(optimizedProgram); });
+        benchmark.add("inverted", [&]() { machine.execute(invertedProgram); });
+        benchmark.add("unrolled", [&]() { machine.execute(unrolledProgram); });
+
+        if (jit.compile(fusedProgram))
+        {
+            benchmark.add("jit", [&]() { jit.execute(); });
+        }
+        else
+        {
+            std::cerr << "[bench]: jit skipped, " << jit.reason() << "\n";
+        }
+
+        benchmark.add("tiered",   [&]() { tiered.execute(fusedProgram); });
+
+        benchmark.run(std::cout);
+
+        mli::NullBuffer nullBuffer{};
+        std::cout << "\n" << std::left << std::setw(12) << "" << std::right << std::setw(14) << "dispatches" << std::setw(12) << "jumps\n";
+        for (auto [name, fused] : {std::pair{"fused", &fusedProgram}, {"optimized", &optimizedProgram},
+                                   {"inverted", &invertedProgram}, {"unrolled", &unrolledProgram}})
+        {
+            mli::OpcodeProfile profile{};
+            std::streambuf* coutBuffer = std::cout.rdbuf(&nullBuffer);
+            machine.profile(*fused, profile);
+            std::cout.rdbuf(coutBuffer);
+
+            std::cout << std::left << std::setw(12) << name << std::right << std::setw(14) << profile.dispatches()
+                << std::setw(11) << profile.count(mli::Opcode::JUMP) << "\n";
+        }
+    }
+    catch (const std::exception& error)
+    {
+        std::cerr << error.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,146 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../src/Parser.hpp"
+
+namespace mli {
+
+    // Front-end throughput on a generated multi-megabyte script: the scanner alone, next to
+    // the legacy State machine, and the scanner with the parser and semantic checks. Each runs in its own process, as the
+    // scanner's tables are static.
+    class FrontendBenchmark
+    {
+        private:
+            std::string m_fileName;
+            size_t      m_bytes{};
+
+            void report(const std::string& a_name, std::function<size_t()> a_run) const
+            {
+                std::cout.flush();
+                pid_t child = fork();
+                if (child != 0)
+                {
+                    waitpid(child, nullptr, 0);
+                    return;
+                }
+
+                auto start = std::chrono::steady_clock::now();
+                size_t count = a_run();
+                auto finish = std::chrono::steady_clock::now();
+
+                double ms = std::chrono::duration<double, std::milli>(finish - start).count();
+                std::cout << std::left << std::setw(12) << a_name
+                    << std::right << std::setw(12) << std::fixed << std::setprecision(3) << ms << " ms"
+                    << std::setw(12) << std::setprecision(2) << m_bytes / 1e6 / (ms / 1000) << " MB/s"
+                    << std::setw(12) << count << " " << (a_name != "parser" ? "tokens" : "poliz entries") << std::endl;
+                _exit(0);
+            }
+
+        public:
+
+            FrontendBenchmark(std::string a_fileName)
+                : m_fileName(std::move(a_fileName))
+            {
+            }
+
+            void generate(size_t a_statements)
+            {
+                std::mt19937 random{42};
+                auto variable = [&random]() { return "value" + std::to_string(random() % 500); };
+
+                std::ofstream out{m_fileName};
+                out << "program\n{\n    int ";
+                for (int i = 0; i < 500; ++i)
+                {
+                    out << (i ? ", " : "") << "value" << i << " = " << i;
+                }
+                out << ";\n    real ratio = 0.5;\n    string text = \"start\";\n";
+
+                for (size_t i = 0; i < a_statements; ++i)
+                {
+                    switch (random() % 4)
+                    {
+                        case 0:
+                            out << "    " << variable() << " = " << variable() << " + " << random() % 100000 << " * (" << variable() << " - 17);\n";
+                            break;
+                        case 1:
+                            out << "    /* step " << i << " */ if (" << variable() << " <= " << variable() << " and not " << variable()
+                                << " != 3) ratio = ratio * 1.0625; else " << variable() << " = 0;\n";
+                            break;
+                        case 2:
+                            out << "    text = \"generated string literal number " << i % 97 << "\";\n";
+                            break;
+                        default:
+                            std::string loop = variable();
+                            out << "    while (" << loop << " > 100) " << loop << " = " << loop << " / 2;\n";
+                            break;
+                    }
+                }
+                out << "    write(value1, text);\n}\n";
+                out.close();
+
+                m_bytes = std::ifstream(m_fileName, std::ios::ate).tellg();
+                std::cout << a_statements << " statements, " << m_bytes / 1e6 << " MB\n";
+            }
+
+            void run()
+            {
+                for (bool legacy : {true, false})
+                {
+                    report(legacy ? "legacy" : "scanner", [&]()
+                    {
+                        Scanner scanner{m_fileName, legacy};
+                        size_t tokens = 0;
+                        while (scanner.getToken().getType() != Token::Type::FINISH)
+                        {
+                            ++tokens;
+                        }
+                        return tokens;
+                    });
+                }
+
+                report("parser", [&]()
+                {
+                    Parser parser{m_fileName};
+                    parser.analyze();
+                    return parser.fetchPoliz().size();
+                });
+            }
+    };
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        if (argc > 2)
+        {
+            throw std::runtime_error("[bench]: usage: mli_frontend [thousands of statements]");
+        }
+
+        size_t statements = (argc == 2 ? std::stod(argv[1]) : 30) * 1000;
+        std::string fileName = "/tmp/mli_frontend_" + std::to_string(getpid()) + ".mli";
+
+        mli::FrontendBenchmark benchmark{fileName};
+        benchmark.generate(statements);
+        benchmark.run();
+
+        std::remove(fileName.c_str());
+    }
+    catch (const std::exception& error)
+    {
+        std::cerr << error.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,181 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../src/InputBuffer.hpp"
+
+namespace mli {
+
+    // Input throughput of `read`: std::ifstream >> against InputBuffer over a mapped
+    // regular file and over a pipe, for files of ints, reals and words.
+    class InputBenchmark
+    {
+        private:
+            std::string m_fileName;
+            size_t      m_bytes{};
+
+            // Points stdin at the file, or at a pipe a child process fills from it.
+            pid_t redirect(bool a_pipe) const
+            {
+                int file = open(m_fileName.c_str(), O_RDONLY);
+                if (!a_pipe)
+                {
+                    dup2(file, STDIN_FILENO);
+                    close(file);
+                    return -1;
+                }
+
+                int ends[2]{};
+                if (pipe(ends) != 0)
+                {
+                    throw std::runtime_error("[bench]: cannot create a pipe");
+                }
+
+                pid_t child = fork();
+                if (child == 0)
+                {
+                    close(ends[0]);
+                    char block[1 << 16];
+                    for (ssize_t count{}; (count = read(file, block, sizeof(block))) > 0; )
+                    {
+                        for (ssize_t written = 0; written < count; )
+                        {
+                            ssize_t result = write(ends[1], block + written, count - written);
+                            if (result <= 0)
+                            {
+                                _exit(1);
+                            }
+                            written += result;
+                        }
+                    }
+                    _exit(0);
+                }
+
+                close(file);
+                close(ends[1]);
+                dup2(ends[0], STDIN_FILENO);
+                close(ends[0]);
+                return child;
+            }
+
+            void report(const std::string& a_name, std::function<double()> a_read) const
+            {
+                auto start = std::chrono::steady_clock::now();
+                double checksum = a_read();
+                auto finish = std::chrono::steady_clock::now();
+
+                double ms = std::chrono::duration<double, std::milli>(finish - start).count();
+                std::cout << std::left << std::setw(20) << a_name
+                    << std::right << std::setw(12) << std::fixed << std::setprecision(3) << ms << " ms"
+                    << std::setw(12) << std::setprecision(2) << m_bytes / 1e6 / (ms / 1000) << " MB/s"
+                    << "    checksum " << std::setprecision(0) << checksum << "\n";
+            }
+
+        public:
+
+            InputBenchmark(std::string a_fileName)
+                : m_fileName(std::move(a_fileName))
+            {
+            }
+
+            template<typename T>
+            void run(const std::string& a_kind, size_t a_count, std::function<T(std::mt19937&)> a_generate,
+                     std::function<T(InputBuffer&)> a_read, std::function<double(const T&)> a_weight)
+            {
+                std::mt19937 random{42};
+                {
+                    std::ofstream out{m_fileName};
+                    for (size_t i = 0; i < a_count; ++i)
+                    {
+                        out << a_generate(random) << ((i % 8 == 7) ? "\n" : " ");
+                    }
+                }
+                m_bytes = std::ifstream(m_fileName, std::ios::ate).tellg();
+                std::cout << a_kind << ": " << a_count << " values, " << m_bytes / 1e6 << " MB\n";
+
+                report("  ifstream >>", [&]()
+                {
+                    std::ifstream in{m_fileName};
+                    double checksum = 0;
+                    T value{};
+                    for (size_t i = 0; i < a_count && in >> value; ++i)
+                    {
+                        checksum += a_weight(value);
+                    }
+                    return checksum;
+                });
+
+                for (bool pipe : {false, true})
+                {
+                    pid_t child = redirect(pipe);
+                    report(pipe ? "  InputBuffer pipe" : "  InputBuffer mapped", [&]()
+                    {
+                        InputBuffer input{};
+                        double checksum = 0;
+                        for (size_t i = 0; i < a_count; ++i)
+                        {
+                            checksum += a_weight(a_read(input));
+                        }
+                        return checksum;
+                    });
+
+                    if (child > 0)
+                    {
+                        // Lets the writer finish even if the reader stopped early.
+                        int null = open("/dev/null", O_RDONLY);
+                        dup2(null, STDIN_FILENO);
+                        close(null);
+                        waitpid(child, nullptr, 0);
+                    }
+                }
+            }
+    };
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        if (argc > 2)
+        {
+            throw std::runtime_error("[bench]: usage: mli_input [millions of ints]");
+        }
+
+        size_t ints = (argc == 2 ? std::stod(argv[1]) : 5) * 1000000;
+        std::string fileName = "/tmp/mli_input_" + std::to_string(getpid());
+        mli::InputBenchmark benchmark{fileName};
+
+        benchmark.run<int32_t>("ints", ints,
+            [](std::mt19937& a_random) { return static_cast<int32_t>(a_random()); },
+            [](mli::InputBuffer& a_input) { return a_input.readInt(); },
+            [](const int32_t& a_value) { return static_cast<double>(a_value); });
+
+        benchmark.run<double>("reals", ints / 5,
+            [](std::mt19937& a_random) { return std::uniform_real_distribution<double>(-1e6, 1e6)(a_random); },
+            [](mli::InputBuffer& a_input) { return a_input.readReal(); },
+            [](const double& a_value) { return a_value; });
+
+        benchmark.run<std::string>("strings", ints / 5,
+            [](std::mt19937& a_random) { return std::string(1 + a_random() % 12, static_cast<char>('a' + a_random() % 26)); },
+            [](mli::InputBuffer& a_input) { return a_input.readString(); },
+            [](const std::string& a_value) { return static_cast<double>(a_value.size()); });
+
+        std::remove(fileName.c_str());
+    }
+    catch (const std::exception& error)
+    {
+        std::cerr << error.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,69 @@
+#include <iostream>
+#include <ostream>
+#include <streambuf>
+
+#include <sys/resource.h>
+
+#include "../src/Parser.hpp"
+#include "../src/Bytecode.hpp"
+#include "../src/VirtualMachine.hpp"
+
+namespace mli {
+
+    class NullBuffer : public std::streambuf
+    {
+        protected:
+            int overflow(int a_char) override
+            {
+                return a_char;
+            }
+    };
+
+    long peakResidentKb()
+    {
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        if (argc != 3)
+        {
+            throw std::runtime_error("[soak]: usage: mli_soak <program> <rss limit kB>");
+        }
+
+        mli::Parser parser{argv[1]};
+        parser.analyze();
+
+        mli::Program program = mli::Compiler(parser.fetchPoliz(), parser.fetchVariables()).compile();
+        mli::VirtualMachine machine{};
+
+        mli::NullBuffer nullBuffer{};
+        std::streambuf* coutBuffer = std::cout.rdbuf(&nullBuffer);
+        machine.execute(program);
+        std::cout.rdbuf(coutBuffer);
+
+        long peak  = mli::peakResidentKb();
+        long limit = std::stol(argv[2]);
+
+        std::cout << "peak rss: " << peak << " kB (limit " << limit << " kB), live strings: "
+            << machine.heap().liveCount() << " of " << machine.heap().capacity() << " slots\n";
+
+        if (peak > limit)
+        {
+            std::cerr << "[soak]: resident set grew past the limit" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    catch (const std::exception& error)
+    {
+        std::cerr << error.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,24 @@
+#!/bin/sh
+# Sums the dynamic opcode-pair profile of every program given on the command line.
+# usage: bench/pairs.sh <mli binary> [mli flags] -- <program>...
+
+mli=$1
+shift
+
+flags=""
+while [ $# -gt 0 ] && [ "$1" != "--" ]; do
+    flags="$flags $1"
+    shift
+done
+shift
+
+for program in "$@"; do
+    echo hello | "$mli" --profile-pairs $flags "$program" 2>&1 >/dev/null
+done | awk '
+    /^dispatches:/ { dispatches += $2 }
+    / -> /         { pairs[$3 " -> " $5] += $1 }
+    END {
+        print "dispatches: " dispatches
+        fflush()
+        for (pair in pairs) printf "%12d  %6.2f%%  %s\n", pairs[pair], 100.0 * pairs[pair] / dispatches, pair | "sort -k1,1 -n -r | head -n 25"
+    }'
@@ -0,0 +1,245 @@
+#ifndef BLOCK_LAYOUT_HPP
+#define BLOCK_LAYOUT_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Bytecode.hpp"
+#include "BranchProfile.hpp"
+#include "ControlFlow.hpp"
+#include "LoopOptimizer.hpp"
+
+namespace mli {
+
+    // Reorders basic blocks by a branch profile: each block is followed by its most frequent
+    // successor, so hot paths fall through, and blocks the profiled run never reached move to the end.
+    class BlockLayout
+    {
+        private:
+            Program                   m_program;
+            std::vector<BranchCounts> m_counts;
+            std::vector<uint64_t>     m_frequencies;
+            size_t                    m_inverted{};
+            size_t                    m_cold{};
+
+            static bool isConditional(Opcode a_opcode)
+            {
+                return isJump(a_opcode) && a_opcode != Opcode::JUMP;
+            }
+
+            // The next block when control falls off the end of a_block, or -1.
+            int32_t fallthrough(const ControlFlowGraph& a_cfg, int32_t a_block) const
+            {
+                const BasicBlock& block = a_cfg.block(a_block);
+                Opcode last = m_program.code()[block.end - 1].opcode;
+                bool falls = (last != Opcode::JUMP && last != Opcode::HALT && block.end < static_cast<int32_t>(m_program.code().size()));
+                return falls ? a_cfg.blockOf(block.end) : -1;
+            }
+
+            // Blocks ending in a jump ran as often as the jump; the others as often as they were entered.
+            void estimate(const ControlFlowGraph& a_cfg)
+            {
+                const std::vector<Instruction>& code = m_program.code();
+                std::vector<uint64_t> entered(a_cfg.blocks().size());
+                m_frequencies.assign(a_cfg.blocks().size(), 0);
+                entered[0] = 1;
+
+                for (size_t block = 0; block < a_cfg.blocks().size(); ++block)
+                {
+                    int32_t last = a_cfg.block(block).end - 1;
+                    if (isJump(code[last].opcode))
+                    {
+                        m_frequencies[block] = m_counts[last].executed;
+                    }
+                }
+
+                for (int32_t block : a_cfg.reversePostorder())
+                {
+                    int32_t last = a_cfg.block(block).end - 1;
+                    if (!isJump(code[last].opcode))
+                    {
+                        m_frequencies[block] = entered[block];
+                    }
+                    if (code[last].opcode == Opcode::JUMP || code[last].opcode == Opcode::HALT)
+                    {
+                        continue;
+                    }
+
+                    int32_t next = fallthrough(a_cfg, block);
+                    entered[next] += isConditional(code[last].opcode) ? m_counts[last].executed - m_counts[last].taken : m_frequencies[block];
+                }
+            }
+
+            uint64_t weight(const ControlFlowGraph& a_cfg, int32_t a_from, int32_t a_to) const
+            {
+                int32_t last = a_cfg.block(a_from).end - 1;
+                const Instruction& jump = m_program.code()[last];
+                if (!isConditional(jump.opcode))
+                {
+                    return m_frequencies[a_from];
+                }
+
+                uint64_t weight = 0;
+                weight += (a_cfg.blockOf(jump.operand) == a_to) ? m_counts[last].taken : 0;
+                weight += (fallthrough(a_cfg, a_from) == a_to) ? m_counts[last].executed - m_counts[last].taken : 0;
+                return weight;
+            }
+
+            std::vector<int32_t> order(const ControlFlowGraph& a_cfg)
+            {
+                size_t blocks = a_cfg.blocks().size();
+                std::vector<int32_t> order{};
+                std::vector<bool> placed(blocks);
+
+                // Blocks entered with operands on the stack (the inside of a lazy and/or) stay
+                // right behind the block falling into them, so every translator still sees the
+                // stack it expects there.
+                Verifier verifier{m_program};
+                verifier.verify();
+                auto glued = [&](int32_t a_block)
+                {
+                    return a_block != -1 && verifier.depths()[a_cfg.block(a_block).begin] > 0;
+                };
+
+                auto place = [&](int32_t a_block)
+                {
+                    for (placed[a_block] = true, order.push_back(a_block); glued(fallthrough(a_cfg, a_block)); )
+                    {
+                        a_block = fallthrough(a_cfg, a_block);
+                        placed[a_block] = true;
+                        order.push_back(a_block);
+                    }
+                    return a_block;
+                };
+
+                auto chain = [&](int32_t a_block)
+                {
+                    for (int32_t block = a_block; block != -1 && !placed[block]; )
+                    {
+                        block = place(block);
+
+                        int32_t next = -1;
+                        uint64_t best = 0;
+                        for (int32_t successor : a_cfg.block(block).successors)
+                        {
+                            uint64_t frequency = weight(a_cfg, block, successor);
+                            if (!placed[successor] && !glued(successor) && frequency > best)
+                            {
+                                next = successor;
+                                best = frequency;
+                            }
+                        }
+                        block = next;
+                    }
+                };
+
+                chain(0);
+                for (size_t block = 0; block < blocks; ++block)
+                {
+                    if (m_frequencies[block] > 0 && !glued(block))
+                    {
+                        chain(block);
+                    }
+                }
+
+                size_t lastHot = 0;
+                for (size_t block = 0; block < blocks; ++block)
+                {
+                    lastHot = (m_frequencies[block] > 0) ? block : lastHot;
+                }
+                for (size_t block = 0; block < blocks; ++block)
+                {
+                    if (!placed[block])
+                    {
+                        m_cold += (block < lastHot);
+                        place(block);
+                    }
+                }
+
+                return order;
+            }
+
+        public:
+
+            // a_counts holds the profile counts of every instruction of a_program.
+            BlockLayout(const Program& a_program, std::vector<BranchCounts> a_counts)
+                : m_program(a_program), m_counts(std::move(a_counts))
+            {
+                m_counts.resize(m_program.code().size());
+            }
+
+            Program layout()
+            {
+                ControlFlowGraph cfg{m_program};
+                estimate(cfg);
+                std::vector<int32_t> blocks = order(cfg);
+
+                const std::vector<Instruction>& code = m_program.code();
+                std::vector<Instruction> laidOut{};
+                std::vector<int32_t> start(blocks.size());
+                std::vector<std::pair<size_t, int32_t>> jumps{};
+
+                for (size_t k = 0; k < blocks.size(); ++k)
+                {
+                    const BasicBlock& block = cfg.block(blocks[k]);
+                    int32_t next = (k + 1 < blocks.size()) ? blocks[k + 1] : -1;
+                    int32_t falls = fallthrough(cfg, blocks[k]);
+
+                    start[blocks[k]] = laidOut.size();
+                    laidOut.insert(laidOut.end(), code.begin() + block.begin, code.begin() + block.end);
+
+                    Instruction& last = laidOut.back();
+                    int32_t target = isJump(last.opcode) ? cfg.blockOf(last.operand) : -1;
+
+                    if (last.opcode == Opcode::JUMP && target == next)
+                    {
+                        laidOut.pop_back();
+                        continue;
+                    }
+                    if (last.opcode == Opcode::JUMP_FALSE || last.opcode == Opcode::JUMP_TRUE)
+                    {
+                        if (target == next && falls != next)
+                        {
+                            std::vector<Instruction> tail(laidOut.end() - std::min<int32_t>(2, block.end - block.begin), laidOut.end());
+                            LoopOptimizer::negate(tail, tail.size() == 2);
+                            std::copy(tail.begin(), tail.end(), laidOut.end() - tail.size());
+                            std::swap(target, falls);
+                            ++m_inverted;
+                        }
+                    }
+                    if (target != -1)
+                    {
+                        jumps.emplace_back(laidOut.size() - 1, target);
+                    }
+                    if (falls != -1 && falls != next)
+                    {
+                        laidOut.push_back(Instruction{Opcode::JUMP, 0, 0});
+                        jumps.emplace_back(laidOut.size() - 1, falls);
+                    }
+                }
+
+                for (auto& [jump, target] : jumps)
+                {
+                    laidOut[jump].operand = start[target];
+                }
+
+                m_program.code() = std::move(laidOut);
+                m_program.setMaxDepth(Verifier(m_program).verify());
+                return m_program;
+            }
+
+            size_t inverted() const
+            {
+                return m_inverted;
+            }
+
+            size_t cold() const
+            {
+                return m_cold;
+            }
+    };
+}
+
+#endif // BLOCK_LAYOUT_HPP
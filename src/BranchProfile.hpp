@@ -0,0 +1,103 @@
+#ifndef BRANCH_PROFILE_HPP
+#define BRANCH_PROFILE_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "OpcodeProfile.hpp"
+
+namespace mli {
+
+    struct BranchCounts
+    {
+        uint64_t executed{};
+        uint64_t taken{};
+    };
+
+    // How often every POLIZ jump ran and how often it jumped. Saved by --profile-out as one
+    // "<poliz index> <executed> <taken>" line per jump and read back by --profile-in.
+    class BranchProfile
+    {
+        private:
+            std::map<int32_t, BranchCounts> m_counts;
+
+        public:
+
+            BranchProfile() = default;
+
+            // a_origins maps the instructions of the profiled program to their POLIZ jumps.
+            BranchProfile(const OpcodeProfile& a_profile, const std::vector<int32_t>& a_origins)
+            {
+                for (size_t i = 0; i < a_origins.size(); ++i)
+                {
+                    if (a_origins[i] != -1)
+                    {
+                        m_counts[a_origins[i]] = BranchCounts{a_profile.executed(i), a_profile.taken(i)};
+                    }
+                }
+            }
+
+            static BranchProfile load(const std::string& a_fileName)
+            {
+                std::ifstream in{a_fileName};
+                if (!in)
+                {
+                    throw std::runtime_error("[BranchProfile]: cannot open " + a_fileName);
+                }
+
+                BranchProfile profile{};
+                int32_t      jump{};
+                BranchCounts counts{};
+                while (in >> jump >> counts.executed >> counts.taken)
+                {
+                    if (counts.taken > counts.executed)
+                    {
+                        throw std::runtime_error("[BranchProfile]: jump " + std::to_string(jump) + " is taken more often than executed");
+                    }
+                    profile.m_counts[jump] = counts;
+                }
+
+                if (!in.eof())
+                {
+                    throw std::runtime_error("[BranchProfile]: malformed profile " + a_fileName);
+                }
+                return profile;
+            }
+
+            void save(const std::string& a_fileName) const
+            {
+                std::ofstream out{a_fileName};
+                for (const auto& [jump, counts] : m_counts)
+                {
+                    out << jump << " " << counts.executed << " " << counts.taken << "\n";
+                }
+
+                if (!out)
+                {
+                    throw std::runtime_error("[BranchProfile]: cannot write " + a_fileName);
+                }
+            }
+
+            // The counts of every instruction of a program compiled with the given origins;
+            // jumps missing from the profile never ran.
+            std::vector<BranchCounts> counts(const std::vector<int32_t>& a_origins) const
+            {
+                std::vector<BranchCounts> result(a_origins.size());
+                for (size_t i = 0; i < a_origins.size(); ++i)
+                {
+                    auto found = m_counts.find(a_origins[i]);
+                    if (a_origins[i] != -1 && found != m_counts.end())
+                    {
+                        result[i] = found->second;
+                    }
+                }
+                return result;
+            }
+    };
+}
+
+#endif // BRANCH_PROFILE_HPP
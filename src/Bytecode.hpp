@@ -0,0 +1,1080 @@
+#ifndef BYTECODE_HPP
+#define BYTECODE_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <ostream>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Token.hpp"
+#include "Ident.hpp"
+#include "Scanner.hpp"
+
+namespace mli {
+
+#define MLI_OPCODES(X)        \
+    X(PUSH_INT)               \
+    X(PUSH_REAL)              \
+    X(PUSH_STRING)            \
+    X(LOAD_INT)               \
+    X(LOAD_REAL)              \
+    X(LOAD_STRING)            \
+    X(STORE_INT)              \
+    X(STORE_REAL)             \
+    X(STORE_STRING)           \
+    X(STORE_KEEP_INT)         \
+    X(STORE_KEEP_REAL)        \
+    X(STORE_KEEP_STRING)      \
+    X(READ_INT)               \
+    X(READ_REAL)              \
+    X(READ_STRING)            \
+    X(APPEND_STRING)          \
+    X(CONCAT)                 \
+    X(WRITE)                  \
+    X(POP)                    \
+    X(TO_INT)                 \
+    X(TO_REAL)                \
+    X(TO_REAL_SECOND)         \
+    X(ADD_INT)                \
+    X(SUB_INT)                \
+    X(MUL_INT)                \
+    X(DIV_INT)                \
+    X(ADD_REAL)               \
+    X(SUB_REAL)               \
+    X(MUL_REAL)               \
+    X(DIV_REAL)               \
+    X(NEG_INT)                \
+    X(NEG_REAL)               \
+    X(NOT)                    \
+    X(EQ_INT)                 \
+    X(NEQ_INT)                \
+    X(LESS_INT)               \
+    X(GREATER_INT)            \
+    X(LEQ_INT)                \
+    X(GEQ_INT)                \
+    X(EQ_REAL)                \
+    X(NEQ_REAL)               \
+    X(LESS_REAL)              \
+    X(GREATER_REAL)           \
+    X(LEQ_REAL)               \
+    X(GEQ_REAL)               \
+    X(EQ_STRING)              \
+    X(NEQ_STRING)             \
+    X(LESS_STRING)            \
+    X(GREATER_STRING)         \
+    X(LEQ_STRING)             \
+    X(GEQ_STRING)             \
+    X(AND)                    \
+    X(OR)                     \
+    X(JUMP)                   \
+    X(JUMP_FALSE)             \
+    X(JUMP_TRUE)              \
+    X(JUMP_FALSE_LAZY)        \
+    X(JUMP_TRUE_LAZY)         \
+    X(HALT)                   \
+    X(INC_INT)                \
+    X(LOAD_INT_PUSH_INT)      \
+    X(EQ_INT_JUMP_FALSE)      \
+    X(NEQ_INT_JUMP_FALSE)     \
+    X(LESS_INT_JUMP_FALSE)    \
+    X(GREATER_INT_JUMP_FALSE) \
+    X(LEQ_INT_JUMP_FALSE)     \
+    X(GEQ_INT_JUMP_FALSE)
+
+    enum class Opcode : uint8_t
+    {
+#define MLI_OPCODE_ENUM(name) name,
+        MLI_OPCODES(MLI_OPCODE_ENUM)
+#undef MLI_OPCODE_ENUM
+    };
+
+    inline const char* opcodeName(Opcode a_opcode)
+    {
+        static const char* s_names[] = {
+#define MLI_OPCODE_NAME(name) #name,
+            MLI_OPCODES(MLI_OPCODE_NAME)
+#undef MLI_OPCODE_NAME
+        };
+
+        return s_names[static_cast<int>(a_opcode)];
+    }
+
+    inline bool isFused(Opcode a_opcode)
+    {
+        return a_opcode > Opcode::HALT;
+    }
+
+    inline bool isJump(Opcode a_opcode)
+    {
+        return (a_opcode >= Opcode::JUMP && a_opcode <= Opcode::JUMP_TRUE_LAZY)
+            || (a_opcode >= Opcode::EQ_INT_JUMP_FALSE && a_opcode <= Opcode::GEQ_INT_JUMP_FALSE);
+    }
+
+    inline bool isComparison(Opcode a_opcode)
+    {
+        return a_opcode >= Opcode::EQ_INT && a_opcode <= Opcode::GEQ_STRING;
+    }
+
+    inline bool hasOperand(Opcode a_opcode)
+    {
+        return a_opcode <= Opcode::CONCAT || isJump(a_opcode) || isFused(a_opcode);
+    }
+
+    inline bool isLoad(Opcode a_opcode)
+    {
+        return a_opcode >= Opcode::LOAD_INT && a_opcode <= Opcode::LOAD_STRING;
+    }
+
+    inline bool isIntArithmetic(Opcode a_opcode)
+    {
+        return (a_opcode >= Opcode::ADD_INT && a_opcode <= Opcode::DIV_INT) || a_opcode == Opcode::NEG_INT;
+    }
+
+    inline bool accessesVariable(Opcode a_opcode)
+    {
+        return a_opcode >= Opcode::LOAD_INT && a_opcode <= Opcode::APPEND_STRING;
+    }
+
+    inline Token::Type slotType(Opcode a_opcode)
+    {
+        if (a_opcode == Opcode::APPEND_STRING)
+        {
+            return Token::Type::STRING;
+        }
+
+        int offset = static_cast<int>(a_opcode) - static_cast<int>(Opcode::LOAD_INT);
+        return (offset % 3 == 1) ? Token::Type::REAL : (offset % 3 == 2) ? Token::Type::STRING : Token::Type::INT;
+    }
+
+    inline Opcode typedOpcode(Opcode a_intOpcode, Token::Type a_type)
+    {
+        int offset = (a_type == Token::Type::REAL) ? 1 : (a_type == Token::Type::STRING) ? 2 : 0;
+        return static_cast<Opcode>(static_cast<int>(a_intOpcode) + offset);
+    }
+
+    struct Instruction
+    {
+        // Set in the arity of a LOAD that may read a variable before its first assignment,
+        // or of a DIV_INT whose divisor may be zero.
+        static constexpr uint16_t s_checked = 1;
+        // Set in the arity of int arithmetic whose result is known to fit without wrapping.
+        static constexpr uint16_t s_exact   = 2;
+
+        Opcode   opcode{Opcode::HALT};
+        uint16_t arity{};
+        int32_t  operand{};
+    };
+
+    struct Variable
+    {
+        std::string name;
+        Token::Type type{Token::Type::NULL};
+        int32_t     slot{};
+    };
+
+    class Program
+    {
+        private:
+            std::vector<Instruction> m_code;
+            std::vector<Variable>    m_variables;
+            std::vector<double>      m_reals;
+            std::vector<std::string> m_strings;
+            int32_t                  m_intSlots{};
+            int32_t                  m_realSlots{};
+            int32_t                  m_stringSlots{};
+            int32_t                  m_maxDepth{-1};
+
+        public:
+
+            std::vector<Instruction>& code()
+            {
+                return m_code;
+            }
+
+            const std::vector<Instruction>& code() const
+            {
+                return m_code;
+            }
+
+            const std::vector<Variable>& variables() const
+            {
+                return m_variables;
+            }
+
+            const std::vector<double>& reals() const
+            {
+                return m_reals;
+            }
+
+            int32_t addReal(double a_value)
+            {
+                m_reals.push_back(a_value);
+                return m_reals.size() - 1;
+            }
+
+            int32_t internReal(double a_value)
+            {
+                auto found = std::find_if(m_reals.begin(), m_reals.end(), [&](double a_real)
+                {
+                    return std::bit_cast<uint64_t>(a_real) == std::bit_cast<uint64_t>(a_value);
+                });
+
+                return (found != m_reals.end()) ? found - m_reals.begin() : addReal(a_value);
+            }
+
+            const std::vector<std::string>& strings() const
+            {
+                return m_strings;
+            }
+
+            int32_t addString(const std::string& a_value)
+            {
+                m_strings.push_back(a_value);
+                return m_strings.size() - 1;
+            }
+
+            int32_t internString(const std::string& a_value)
+            {
+                auto found = std::find(m_strings.begin(), m_strings.end(), a_value);
+                return (found != m_strings.end()) ? found - m_strings.begin() : addString(a_value);
+            }
+
+            int32_t intSlots() const
+            {
+                return m_intSlots;
+            }
+
+            int32_t realSlots() const
+            {
+                return m_realSlots;
+            }
+
+            int32_t stringSlots() const
+            {
+                return m_stringSlots;
+            }
+
+            int32_t maxDepth() const
+            {
+                return m_maxDepth;
+            }
+
+            void setMaxDepth(int32_t a_maxDepth)
+            {
+                m_maxDepth = a_maxDepth;
+            }
+
+            const Variable& declare(const std::string& a_name, Token::Type a_type)
+            {
+                int32_t& slots = (a_type == Token::Type::INT) ? m_intSlots
+                    : (a_type == Token::Type::REAL) ? m_realSlots : m_stringSlots;
+
+                m_variables.push_back(Variable{a_name, a_type, slots++});
+                return m_variables.back();
+            }
+
+            const Variable& variableAt(Opcode a_opcode, int32_t a_slot) const
+            {
+                Token::Type type = slotType(a_opcode);
+
+                auto found = std::find_if(m_variables.begin(), m_variables.end(), [&](const Variable& a_variable)
+                {
+                    return a_variable.type == type && a_variable.slot == a_slot;
+                });
+
+                assert(found != m_variables.end());
+                return *found;
+            }
+
+            std::vector<bool> jumpTargets() const
+            {
+                std::vector<bool> targets(m_code.size() + 1);
+
+                for (auto& instruction : m_code)
+                {
+                    if (isJump(instruction.opcode))
+                    {
+                        targets[instruction.operand] = true;
+                    }
+                }
+
+                return targets;
+            }
+
+            void compact(const std::vector<bool>& a_removed)
+            {
+                std::vector<int32_t> newIndex(m_code.size() + 1);
+                std::vector<Instruction> result{};
+
+                for (size_t i = 0; i < m_code.size(); ++i)
+                {
+                    newIndex[i] = result.size();
+                    if (!a_removed[i])
+                    {
+                        result.push_back(m_code[i]);
+                    }
+                }
+                newIndex[m_code.size()] = result.size();
+
+                for (auto& instruction : result)
+                {
+                    if (isJump(instruction.opcode))
+                    {
+                        instruction.operand = newIndex[instruction.operand];
+                    }
+                }
+
+                m_code = std::move(result);
+            }
+
+            size_t emit(Opcode a_opcode, int32_t a_operand = 0, uint16_t a_arity = 0)
+            {
+                m_code.push_back(Instruction{a_opcode, a_arity, a_operand});
+                return m_code.size() - 1;
+            }
+
+            void dump(std::ostream& a_out) const
+            {
+                a_out << "########### BYTECODE ###########\n";
+                for (size_t i = 0; i < m_code.size(); ++i)
+                {
+                    a_out << std::setw(4) << i << ":  " << opcodeName(m_code[i].opcode);
+                    if (hasOperand(m_code[i].opcode))
+                    {
+                        a_out << " " << m_code[i].operand;
+                    }
+                    if (m_code[i].opcode == Opcode::PUSH_REAL)
+                    {
+                        a_out << " (" << m_reals[m_code[i].operand] << ")";
+                    }
+                    if (m_code[i].opcode == Opcode::PUSH_STRING)
+                    {
+                        a_out << " (\"" << m_strings[m_code[i].operand] << "\")";
+                    }
+                    if (accessesVariable(m_code[i].opcode))
+                    {
+                        a_out << " (" << variableAt(m_code[i].opcode, m_code[i].operand).name << ")";
+                    }
+                    if (m_code[i].opcode == Opcode::INC_INT || m_code[i].opcode == Opcode::LOAD_INT_PUSH_INT)
+                    {
+                        a_out << " (" << variableAt(Opcode::LOAD_INT, m_code[i].arity).name << ")";
+                    }
+                    else if (isLoad(m_code[i].opcode) || isIntArithmetic(m_code[i].opcode))
+                    {
+                        a_out << ((m_code[i].arity & Instruction::s_checked) ? " checked" : "")
+                              << ((m_code[i].arity & Instruction::s_exact) ? " exact" : "");
+                    }
+                    else if (m_code[i].arity)
+                    {
+                        a_out << " +" << m_code[i].arity;
+                    }
+                    a_out << "\n";
+                }
+                a_out << "################################\n";
+            }
+    };
+
+    // Proves that every reachable instruction sees the same operand-stack depth on all paths,
+    // never pops more than it has and only names existing slots, constants and targets.
+    // Engines rely on it to run over a flat stack of maxDepth() values without checks.
+    class Verifier
+    {
+        private:
+            const Program&       m_program;
+            std::vector<int32_t> m_depths;
+            int32_t              m_maxDepth{};
+
+            [[noreturn]] static void fail(size_t a_index, const std::string& a_message)
+            {
+                throw std::runtime_error("[Verifier]: " + a_message + " at " + std::to_string(a_index));
+            }
+
+            void checkOperands(size_t a_index, const Instruction& a_instruction) const
+            {
+                auto checkSlot = [&](Token::Type a_type, int32_t a_slot)
+                {
+                    int32_t slots = (a_type == Token::Type::INT) ? m_program.intSlots()
+                        : (a_type == Token::Type::REAL) ? m_program.realSlots() : m_program.stringSlots();
+
+                    if (a_slot < 0 || a_slot >= slots)
+                    {
+                        fail(a_index, "variable slot out of range");
+                    }
+                };
+
+                Opcode opcode = a_instruction.opcode;
+                if (opcode > Opcode::GEQ_INT_JUMP_FALSE)
+                {
+                    fail(a_index, "unknown opcode");
+                }
+                else if (accessesVariable(opcode))
+                {
+                    checkSlot(slotType(opcode), a_instruction.operand);
+                }
+                else if (opcode == Opcode::INC_INT || opcode == Opcode::LOAD_INT_PUSH_INT)
+                {
+                    checkSlot(Token::Type::INT, a_instruction.arity);
+                }
+                else if (opcode == Opcode::PUSH_REAL
+                    && (a_instruction.operand < 0 || a_instruction.operand >= static_cast<int32_t>(m_program.reals().size())))
+                {
+                    fail(a_index, "real constant out of range");
+                }
+                else if (opcode == Opcode::PUSH_STRING
+                    && (a_instruction.operand < 0 || a_instruction.operand >= static_cast<int32_t>(m_program.strings().size())))
+                {
+                    fail(a_index, "string constant out of range");
+                }
+                else if (opcode == Opcode::CONCAT && a_instruction.operand < 2)
+                {
+                    fail(a_index, "concatenation of fewer than two operands");
+                }
+
+                if (opcode == Opcode::APPEND_STRING && a_instruction.arity < 1)
+                {
+                    fail(a_index, "append without operands");
+                }
+            }
+
+        public:
+
+            Verifier(const Program& a_program)
+                : m_program(a_program)
+            {
+            }
+
+            static int32_t pops(const Instruction& a_instruction)
+            {
+                switch (a_instruction.opcode)
+                {
+                    case Opcode::PUSH_INT:
+                    case Opcode::PUSH_REAL:
+                    case Opcode::PUSH_STRING:
+                    case Opcode::LOAD_INT:
+                    case Opcode::LOAD_REAL:
+                    case Opcode::LOAD_STRING:
+                    case Opcode::READ_INT:
+                    case Opcode::READ_REAL:
+                    case Opcode::READ_STRING:
+                    case Opcode::JUMP:
+                    case Opcode::HALT:
+                    case Opcode::INC_INT:
+                    case Opcode::LOAD_INT_PUSH_INT:
+                        return 0;
+                    case Opcode::APPEND_STRING:
+                        return a_instruction.arity;
+                    case Opcode::CONCAT:
+                        return a_instruction.operand;
+                    case Opcode::STORE_INT:
+                    case Opcode::STORE_REAL:
+                    case Opcode::STORE_STRING:
+                    case Opcode::STORE_KEEP_INT:
+                    case Opcode::STORE_KEEP_REAL:
+                    case Opcode::STORE_KEEP_STRING:
+                    case Opcode::WRITE:
+                    case Opcode::POP:
+                    case Opcode::TO_INT:
+                    case Opcode::TO_REAL:
+                    case Opcode::NEG_INT:
+                    case Opcode::NEG_REAL:
+                    case Opcode::NOT:
+                    case Opcode::JUMP_FALSE:
+                    case Opcode::JUMP_TRUE:
+                    case Opcode::JUMP_FALSE_LAZY:
+                    case Opcode::JUMP_TRUE_LAZY:
+                        return 1;
+                    default:
+                        return 2;
+                }
+            }
+
+            static int32_t pushes(const Instruction& a_instruction)
+            {
+                switch (a_instruction.opcode)
+                {
+                    case Opcode::STORE_INT:
+                    case Opcode::STORE_REAL:
+                    case Opcode::STORE_STRING:
+                    case Opcode::READ_INT:
+                    case Opcode::READ_REAL:
+                    case Opcode::READ_STRING:
+                    case Opcode::APPEND_STRING:
+                    case Opcode::WRITE:
+                    case Opcode::POP:
+                    case Opcode::JUMP:
+                    case Opcode::JUMP_FALSE:
+                    case Opcode::JUMP_TRUE:
+                    case Opcode::HALT:
+                    case Opcode::INC_INT:
+                        return 0;
+                    case Opcode::TO_REAL_SECOND:
+                    case Opcode::LOAD_INT_PUSH_INT:
+                        return 2;
+                    default:
+                        return isFused(a_instruction.opcode) ? 0 : 1;
+                }
+            }
+
+            static int32_t stackEffect(const Instruction& a_instruction)
+            {
+                return pushes(a_instruction) - pops(a_instruction);
+            }
+
+            int32_t verify()
+            {
+                const std::vector<Instruction>& code = m_program.code();
+                if (code.empty())
+                {
+                    fail(0, "empty program");
+                }
+
+                m_depths.assign(code.size(), -1);
+                m_depths[0] = 0;
+                m_maxDepth  = 0;
+                std::vector<int32_t> worklist{0};
+
+                while (!worklist.empty())
+                {
+                    int32_t index = worklist.back();
+                    worklist.pop_back();
+
+                    const Instruction& instruction = code[index];
+                    checkOperands(index, instruction);
+
+                    if (m_depths[index] < pops(instruction))
+                    {
+                        fail(index, "operand stack underflow");
+                    }
+
+                    int32_t depth = m_depths[index] + stackEffect(instruction);
+                    m_maxDepth = std::max(m_maxDepth, depth);
+
+                    if (instruction.opcode == Opcode::HALT)
+                    {
+                        if (depth != 0)
+                        {
+                            fail(index, "operand stack is not empty at halt");
+                        }
+                        continue;
+                    }
+
+                    auto flow = [&](int32_t a_successor)
+                    {
+                        if (a_successor < 0 || a_successor >= static_cast<int32_t>(code.size()))
+                        {
+                            fail(index, "control leaves the program");
+                        }
+
+                        if (m_depths[a_successor] == -1)
+                        {
+                            m_depths[a_successor] = depth;
+                            worklist.push_back(a_successor);
+                        }
+                        else if (m_depths[a_successor] != depth)
+                        {
+                            fail(a_successor, "unbalanced operand stack");
+                        }
+                    };
+
+                    if (instruction.opcode != Opcode::JUMP)
+                    {
+                        flow(index + 1);
+                    }
+                    if (isJump(instruction.opcode))
+                    {
+                        flow(instruction.operand);
+                    }
+                }
+
+                return m_maxDepth;
+            }
+
+            const std::vector<int32_t>& depths() const
+            {
+                return m_depths;
+            }
+
+            int32_t maxDepth() const
+            {
+                return m_maxDepth;
+            }
+    };
+
+    class Compiler
+    {
+        private:
+            const std::vector<Token>& m_poliz;
+            const std::vector<Ident>& m_identifiers;
+
+            std::vector<bool>        m_isReference;
+            std::vector<bool>        m_isDiscarded;
+            std::vector<bool>        m_isSkipped;
+            std::vector<Token::Type> m_types;
+            std::vector<int32_t>     m_left;
+            std::vector<int32_t>     m_right;
+            std::vector<uint16_t>    m_leaves;
+            std::vector<int32_t>     m_firstLeaf;
+            std::vector<uint16_t>    m_appendLeaves;
+            std::vector<int32_t>     m_origins;
+
+            static constexpr uint16_t s_maxLeaves = UINT16_MAX;
+
+            static Token::Type toConstType(Token::Type a_type)
+            {
+                return (a_type == Token::Type::STRING) ? Token::Type::STRING_CONST
+                    : (a_type == Token::Type::REAL) ? Token::Type::REAL_CONST : Token::Type::INT_CONST;
+            }
+
+            Token::Type resultType(size_t a_index) const
+            {
+                Token::Type left  = m_types[m_left[a_index]];
+                Token::Type right = m_types[m_right[a_index]];
+
+                switch (m_poliz[a_index].getType())
+                {
+                    case Token::Type::PLUS:
+                    case Token::Type::MINUS:
+                    case Token::Type::MULTIPLY:
+                    case Token::Type::DIVIDE:
+                        if (left == Token::Type::STRING_CONST)
+                        {
+                            return Token::Type::STRING_CONST;
+                        }
+                        return (left == Token::Type::INT_CONST && right == Token::Type::INT_CONST)
+                            ? Token::Type::INT_CONST : Token::Type::REAL_CONST;
+
+                    default:
+                        return Token::Type::INT_CONST;
+                }
+            }
+
+            bool isConcatenation(int32_t a_index) const
+            {
+                return m_poliz[a_index].getType() == Token::Type::PLUS && m_types[a_index] == Token::Type::STRING_CONST;
+            }
+
+            void markUses()
+            {
+                std::vector<size_t> producers;
+
+                auto pop = [&producers]() -> size_t
+                {
+                    assert(!producers.empty() && "malformed poliz");
+                    size_t producer = producers.back();
+                    producers.pop_back();
+                    return producer;
+                };
+
+                for (size_t i = 0; i < m_poliz.size(); ++i)
+                {
+                    switch (m_poliz[i].getType())
+                    {
+                        case Token::Type::INT_CONST:
+                        case Token::Type::REAL_CONST:
+                        case Token::Type::STRING_CONST:
+                            m_types[i] = m_poliz[i].getType();
+                            producers.push_back(i);
+                            break;
+
+                        case Token::Type::ID:
+                            m_types[i] = toConstType(m_identifiers[m_poliz[i].getValue()].getType());
+                            producers.push_back(i);
+                            break;
+
+                        case Token::Type::POLIZ_LABEL:
+                            producers.push_back(i);
+                            break;
+
+                        case Token::Type::POLIZ_GO:
+                        case Token::Type::POLIZ_FALSE_LAZY:
+                        case Token::Type::POLIZ_TRUE_LAZY:
+                        case Token::Type::WRITE:
+                            pop();
+                            break;
+
+                        case Token::Type::POLIZ_FALSE_GO:
+                        case Token::Type::POLIZ_TRUE_GO:
+                            pop();
+                            pop();
+                            break;
+
+                        case Token::Type::READ:
+                            m_isReference[pop()] = true;
+                            break;
+
+                        case Token::Type::ASSIGN:
+                            m_right[i] = pop();
+                            m_left[i]  = pop();
+                            m_isReference[m_left[i]] = true;
+                            m_types[i] = m_types[m_left[i]];
+                            producers.push_back(i);
+                            break;
+
+                        case Token::Type::SEMICOLON:
+                        {
+                            size_t producer = pop();
+                            if (m_poliz[producer].getType() == Token::Type::ASSIGN)
+                            {
+                                m_isDiscarded[producer] = true;
+                                m_isDiscarded[i]        = true;
+                            }
+                            break;
+                        }
+
+                        case Token::Type::NOT:
+                        case Token::Type::UNARY_MINUS:
+                        case Token::Type::UNARY_PLUS:
+                            m_right[i] = pop();
+                            m_types[i] = (m_poliz[i].getType() == Token::Type::NOT) ? Token::Type::INT_CONST : m_types[m_right[i]];
+                            producers.push_back(i);
+                            break;
+
+                        default:
+                            m_right[i] = pop();
+                            m_left[i]  = pop();
+                            m_types[i] = resultType(i);
+                            producers.push_back(i);
+                            break;
+                    }
+                }
+            }
+
+            void markConcatenations()
+            {
+                for (size_t i = 0; i < m_poliz.size(); ++i)
+                {
+                    if (!isConcatenation(i))
+                    {
+                        continue;
+                    }
+
+                    uint16_t leftLeaves  = isConcatenation(m_left[i]) ? m_leaves[m_left[i]] : 1;
+                    uint16_t rightLeaves = isConcatenation(m_right[i]) ? m_leaves[m_right[i]] : 1;
+
+                    m_leaves[i]    = 2;
+                    m_firstLeaf[i] = m_left[i];
+
+                    if (leftLeaves + rightLeaves > s_maxLeaves)
+                    {
+                        continue;
+                    }
+
+                    m_leaves[i] = leftLeaves + rightLeaves;
+                    if (isConcatenation(m_left[i]))
+                    {
+                        m_isSkipped[m_left[i]] = true;
+                        m_firstLeaf[i] = m_firstLeaf[m_left[i]];
+                    }
+                    if (isConcatenation(m_right[i]))
+                    {
+                        m_isSkipped[m_right[i]] = true;
+                    }
+                }
+
+                for (size_t i = 0; i < m_poliz.size(); ++i)
+                {
+                    if (m_poliz[i].getType() != Token::Type::ASSIGN || !m_isDiscarded[i] || !isConcatenation(m_right[i]))
+                    {
+                        continue;
+                    }
+
+                    int32_t source    = m_right[i];
+                    int32_t firstLeaf = m_firstLeaf[source];
+
+                    bool appendsToItself = m_poliz[firstLeaf].getType() == Token::Type::ID
+                        && m_poliz[firstLeaf].getValue() == m_poliz[m_left[i]].getValue();
+
+                    auto writesVariable = [](const Token& a_token)
+                    {
+                        return a_token.getType() == Token::Type::ASSIGN || a_token.getType() == Token::Type::READ;
+                    };
+
+                    if (appendsToItself && std::none_of(m_poliz.begin() + firstLeaf, m_poliz.begin() + source, writesVariable))
+                    {
+                        m_isSkipped[firstLeaf] = true;
+                        m_isSkipped[source]    = true;
+                        m_appendLeaves[i]      = m_leaves[source] - 1;
+                    }
+                }
+            }
+
+            static Opcode binaryOpcode(Token::Type a_operator, Token::Type a_operands)
+            {
+                int type = (a_operands == Token::Type::REAL_CONST) ? 1 : (a_operands == Token::Type::STRING_CONST) ? 2 : 0;
+
+                auto arithmetic = [type](Opcode a_intOpcode)
+                {
+                    if (type == 2)
+                    {
+                        throw std::runtime_error("[Compiler]: arithmetic on string operands");
+                    }
+                    return static_cast<Opcode>(static_cast<int>(a_intOpcode) + 4 * type);
+                };
+
+                auto comparison = [type](Opcode a_intOpcode)
+                {
+                    return static_cast<Opcode>(static_cast<int>(a_intOpcode) + 6 * type);
+                };
+
+                switch (a_operator)
+                {
+                    case Token::Type::PLUS:     return arithmetic(Opcode::ADD_INT);
+                    case Token::Type::MINUS:    return arithmetic(Opcode::SUB_INT);
+                    case Token::Type::MULTIPLY: return arithmetic(Opcode::MUL_INT);
+                    case Token::Type::DIVIDE:   return arithmetic(Opcode::DIV_INT);
+                    case Token::Type::EQ:       return comparison(Opcode::EQ_INT);
+                    case Token::Type::NEQ:      return comparison(Opcode::NEQ_INT);
+                    case Token::Type::LESS:     return comparison(Opcode::LESS_INT);
+                    case Token::Type::GREATER:  return comparison(Opcode::GREATER_INT);
+                    case Token::Type::LEQ:      return comparison(Opcode::LEQ_INT);
+                    case Token::Type::GEQ:      return comparison(Opcode::GEQ_INT);
+                    case Token::Type::AND:      return Opcode::AND;
+                    case Token::Type::OR:       return Opcode::OR;
+                    default:
+                        throw std::runtime_error("[Compiler]: unexpected poliz element");
+                }
+            }
+
+            bool convertLiteral(Program& a_program, const std::vector<int32_t>& a_polizToCode, int32_t a_producer) const
+            {
+                if (m_poliz[a_producer].getType() != Token::Type::INT_CONST)
+                {
+                    return false;
+                }
+
+                Instruction& push = a_program.code()[a_polizToCode[a_producer]];
+                push = Instruction{Opcode::PUSH_REAL, 0, a_program.addReal(push.operand)};
+                return true;
+            }
+
+            void emitBinary(Program& a_program, const std::vector<int32_t>& a_polizToCode, size_t a_index) const
+            {
+                Token::Type left  = m_types[m_left[a_index]];
+                Token::Type right = m_types[m_right[a_index]];
+
+                Token::Type operands = (left == Token::Type::STRING_CONST) ? Token::Type::STRING_CONST
+                    : (left == Token::Type::INT_CONST && right == Token::Type::INT_CONST) ? Token::Type::INT_CONST : Token::Type::REAL_CONST;
+
+                if (operands == Token::Type::REAL_CONST && left == Token::Type::INT_CONST
+                    && !convertLiteral(a_program, a_polizToCode, m_left[a_index]))
+                {
+                    a_program.emit(Opcode::TO_REAL_SECOND);
+                }
+                if (operands == Token::Type::REAL_CONST && right == Token::Type::INT_CONST
+                    && !convertLiteral(a_program, a_polizToCode, m_right[a_index]))
+                {
+                    a_program.emit(Opcode::TO_REAL);
+                }
+
+                Opcode opcode = binaryOpcode(m_poliz[a_index].getType(), operands);
+                a_program.emit(opcode, 0, opcode == Opcode::DIV_INT ? Instruction::s_checked : 0);
+            }
+
+            void emitConversion(Program& a_program, const std::vector<int32_t>& a_polizToCode, int32_t a_source, Token::Type a_target) const
+            {
+                if (a_target == Token::Type::INT && m_types[a_source] == Token::Type::REAL_CONST)
+                {
+                    a_program.emit(Opcode::TO_INT);
+                }
+                else if (a_target == Token::Type::REAL && m_types[a_source] == Token::Type::INT_CONST
+                    && !convertLiteral(a_program, a_polizToCode, a_source))
+                {
+                    a_program.emit(Opcode::TO_REAL);
+                }
+            }
+
+        public:
+
+            Compiler(const std::vector<Token>& a_poliz, const std::vector<Ident>& a_identifiers)
+                : m_poliz(a_poliz), m_identifiers(a_identifiers)
+                , m_isReference(a_poliz.size()), m_isDiscarded(a_poliz.size()), m_isSkipped(a_poliz.size())
+                , m_types(a_poliz.size()), m_left(a_poliz.size(), -1), m_right(a_poliz.size(), -1)
+                , m_leaves(a_poliz.size()), m_firstLeaf(a_poliz.size(), -1), m_appendLeaves(a_poliz.size())
+            {
+            }
+
+            Program compile()
+            {
+                markUses();
+                markConcatenations();
+
+                Program program{};
+                std::vector<int32_t> polizToCode(m_poliz.size() + 1);
+                std::vector<int32_t> references;
+
+                for (auto& identifier : m_identifiers)
+                {
+                    program.declare(identifier.getName(), identifier.getType());
+                }
+
+                auto slotOf = [&program](int32_t a_id) -> const Variable&
+                {
+                    return program.variables()[a_id];
+                };
+                int32_t label{-1};
+
+                for (size_t i = 0; i < m_poliz.size(); ++i)
+                {
+                    const Token& token = m_poliz[i];
+                    polizToCode[i] = program.code().size();
+
+                    if (m_isSkipped[i])
+                    {
+                        continue;
+                    }
+
+                    switch (token.getType())
+                    {
+                        case Token::Type::INT_CONST:
+                            program.emit(Opcode::PUSH_INT, token.getValue());
+                            break;
+
+                        case Token::Type::REAL_CONST:
+                            program.emit(Opcode::PUSH_REAL, program.addReal(State::s_realNumbers[token.getValue()]));
+                            break;
+
+                        case Token::Type::STRING_CONST:
+                            program.emit(Opcode::PUSH_STRING, program.addString(State::s_strings[token.getValue()]));
+                            break;
+
+                        case Token::Type::ID:
+                            if (m_isReference[i])
+                            {
+                                references.push_back(token.getValue());
+                            }
+                            else
+                            {
+                                const Variable& variable = slotOf(token.getValue());
+                                program.emit(typedOpcode(Opcode::LOAD_INT, variable.type), variable.slot, Instruction::s_checked);
+                            }
+                            break;
+
+                        case Token::Type::POLIZ_LABEL:
+                            label = token.getValue();
+                            break;
+
+                        case Token::Type::POLIZ_GO:
+                            program.emit(Opcode::JUMP, label);
+                            break;
+
+                        case Token::Type::POLIZ_FALSE_GO:
+                            program.emit(Opcode::JUMP_FALSE, label);
+                            break;
+
+                        case Token::Type::POLIZ_TRUE_GO:
+                            program.emit(Opcode::JUMP_TRUE, label);
+                            break;
+
+                        case Token::Type::POLIZ_FALSE_LAZY:
+                            program.emit(Opcode::JUMP_FALSE_LAZY, label);
+                            break;
+
+                        case Token::Type::POLIZ_TRUE_LAZY:
+                            program.emit(Opcode::JUMP_TRUE_LAZY, label);
+                            break;
+
+                        case Token::Type::ASSIGN:
+                        {
+                            const Variable& variable = slotOf(references.back());
+
+                            if (m_appendLeaves[i])
+                            {
+                                size_t index = program.emit(Opcode::APPEND_STRING, variable.slot);
+                                program.code()[index].arity = m_appendLeaves[i];
+                                references.pop_back();
+                                break;
+                            }
+
+                            emitConversion(program, polizToCode, m_right[i], variable.type);
+
+                            Opcode store = m_isDiscarded[i] ? Opcode::STORE_INT : Opcode::STORE_KEEP_INT;
+                            program.emit(typedOpcode(store, variable.type), variable.slot);
+                            references.pop_back();
+                            break;
+                        }
+
+                        case Token::Type::READ:
+                        {
+                            const Variable& variable = slotOf(references.back());
+                            program.emit(typedOpcode(Opcode::READ_INT, variable.type), variable.slot);
+                            references.pop_back();
+                            break;
+                        }
+
+                        case Token::Type::WRITE:
+                            program.emit(Opcode::WRITE);
+                            break;
+
+                        case Token::Type::SEMICOLON:
+                            if (!m_isDiscarded[i])
+                            {
+                                program.emit(Opcode::POP);
+                            }
+                            break;
+
+                        case Token::Type::UNARY_PLUS:
+                            break;
+
+                        case Token::Type::UNARY_MINUS:
+                            if (m_types[i] == Token::Type::STRING_CONST)
+                            {
+                                throw std::runtime_error("[Compiler]: unary minus for string operand");
+                            }
+                            program.emit(m_types[i] == Token::Type::REAL_CONST ? Opcode::NEG_REAL : Opcode::NEG_INT);
+                            break;
+
+                        case Token::Type::NOT:
+                            program.emit(Opcode::NOT);
+                            break;
+
+                        default:
+                            if (m_leaves[i])
+                            {
+                                program.emit(Opcode::CONCAT, m_leaves[i]);
+                            }
+                            else
+                            {
+                                emitBinary(program, polizToCode, i);
+                            }
+                            break;
+                    }
+                }
+
+                polizToCode[m_poliz.size()] = program.code().size();
+                program.emit(Opcode::HALT);
+
+                m_origins.assign(program.code().size(), -1);
+                for (size_t i = 0; i < m_poliz.size(); ++i)
+                {
+                    if (!m_isSkipped[i] && m_poliz[i].getType() >= Token::Type::POLIZ_GO && m_poliz[i].getType() <= Token::Type::POLIZ_FALSE_LAZY)
+                    {
+                        m_origins[polizToCode[i]] = i;
+                    }
+                }
+
+                for (auto& instruction : program.code())
+                {
+                    if (isJump(instruction.opcode))
+                    {
+                        instruction.operand = polizToCode[instruction.operand];
+                    }
+                }
+
+                program.setMaxDepth(Verifier(program).verify());
+                return program;
+            }
+
+            // The POLIZ index of every jump of the compiled program, -1 for other instructions.
+            const std::vector<int32_t>& origins() const
+            {
+                return m_origins;
+            }
+    };
+}
+
+#endif // BYTECODE_HPP
@@ -0,0 +1,391 @@
+#ifndef CONTROL_FLOW_HPP
+#define CONTROL_FLOW_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "Bytecode.hpp"
+
+namespace mli {
+
+    struct BasicBlock
+    {
+        int32_t              begin{};
+        int32_t              end{};
+        std::vector<int32_t> successors;
+        std::vector<int32_t> predecessors;
+        int32_t              idom{-1};
+        std::vector<int32_t> children;
+        std::vector<int32_t> frontier;
+    };
+
+    struct Loop
+    {
+        int32_t              header{};
+        std::vector<int32_t> latches;
+        std::vector<int32_t> blocks;
+    };
+
+    class ControlFlowGraph
+    {
+        private:
+            const Program&          m_program;
+            std::vector<BasicBlock> m_blocks;
+            std::vector<int32_t>    m_blockOf;
+            std::vector<int32_t>    m_order;
+            std::vector<int32_t>    m_rank;
+
+            void split()
+            {
+                const std::vector<Instruction>& code = m_program.code();
+                std::vector<bool> leader(code.size() + 1);
+                leader[0] = true;
+
+                for (size_t i = 0; i < code.size(); ++i)
+                {
+                    if (isJump(code[i].opcode))
+                    {
+                        leader[code[i].operand] = true;
+                    }
+                    if (isJump(code[i].opcode) || code[i].opcode == Opcode::HALT)
+                    {
+                        leader[i + 1] = true;
+                    }
+                }
+
+                m_blockOf.assign(code.size(), -1);
+                for (size_t i = 0; i < code.size(); ++i)
+                {
+                    if (leader[i])
+                    {
+                        m_blocks.push_back(BasicBlock{static_cast<int32_t>(i), static_cast<int32_t>(i)});
+                    }
+                    m_blocks.back().end = i + 1;
+                    m_blockOf[i] = m_blocks.size() - 1;
+                }
+
+                for (size_t b = 0; b < m_blocks.size(); ++b)
+                {
+                    const Instruction& last = code[m_blocks[b].end - 1];
+
+                    if (last.opcode != Opcode::JUMP && last.opcode != Opcode::HALT && m_blocks[b].end < static_cast<int32_t>(code.size()))
+                    {
+                        m_blocks[b].successors.push_back(b + 1);
+                    }
+                    if (isJump(last.opcode))
+                    {
+                        m_blocks[b].successors.push_back(m_blockOf[last.operand]);
+                    }
+
+                    for (int32_t successor : m_blocks[b].successors)
+                    {
+                        m_blocks[successor].predecessors.push_back(b);
+                    }
+                }
+            }
+
+            void order()
+            {
+                std::vector<bool> visited(m_blocks.size());
+                std::vector<std::pair<int32_t, size_t>> stack{{0, 0}};
+                visited[0] = true;
+
+                while (!stack.empty())
+                {
+                    auto& [block, next] = stack.back();
+                    if (next < m_blocks[block].successors.size())
+                    {
+                        int32_t successor = m_blocks[block].successors[next++];
+                        if (!visited[successor])
+                        {
+                            visited[successor] = true;
+                            stack.push_back({successor, 0});
+                        }
+                    }
+                    else
+                    {
+                        m_order.push_back(block);
+                        stack.pop_back();
+                    }
+                }
+
+                std::reverse(m_order.begin(), m_order.end());
+                m_rank.assign(m_blocks.size(), -1);
+                for (size_t i = 0; i < m_order.size(); ++i)
+                {
+                    m_rank[m_order[i]] = i;
+                }
+            }
+
+            // Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm".
+            void dominators()
+            {
+                auto intersect = [&](int32_t a_left, int32_t a_right)
+                {
+                    while (a_left != a_right)
+                    {
+                        while (m_rank[a_left] > m_rank[a_right])
+                        {
+                            a_left = m_blocks[a_left].idom;
+                        }
+                        while (m_rank[a_right] > m_rank[a_left])
+                        {
+                            a_right = m_blocks[a_right].idom;
+                        }
+                    }
+                    return a_left;
+                };
+
+                m_blocks[0].idom = 0;
+                bool changed = true;
+                while (changed)
+                {
+                    changed = false;
+                    for (size_t i = 1; i < m_order.size(); ++i)
+                    {
+                        int32_t block = m_order[i];
+                        int32_t idom  = -1;
+
+                        for (int32_t predecessor : m_blocks[block].predecessors)
+                        {
+                            if (m_blocks[predecessor].idom != -1)
+                            {
+                                idom = (idom == -1) ? predecessor : intersect(predecessor, idom);
+                            }
+                        }
+
+                        if (m_blocks[block].idom != idom)
+                        {
+                            m_blocks[block].idom = idom;
+                            changed = true;
+                        }
+                    }
+                }
+
+                for (size_t i = 1; i < m_order.size(); ++i)
+                {
+                    m_blocks[m_blocks[m_order[i]].idom].children.push_back(m_order[i]);
+                }
+
+                for (int32_t block : m_order)
+                {
+                    const std::vector<int32_t>& predecessors = m_blocks[block].predecessors;
+                    if (predecessors.size() < 2)
+                    {
+                        continue;
+                    }
+
+                    for (int32_t predecessor : predecessors)
+                    {
+                        for (int32_t runner = predecessor; reachable(runner) && runner != m_blocks[block].idom; runner = m_blocks[runner].idom)
+                        {
+                            std::vector<int32_t>& frontier = m_blocks[runner].frontier;
+                            if (std::find(frontier.begin(), frontier.end(), block) == frontier.end())
+                            {
+                                frontier.push_back(block);
+                            }
+                        }
+                    }
+                }
+            }
+
+        public:
+
+            ControlFlowGraph(const Program& a_program)
+                : m_program(a_program)
+            {
+                split();
+                order();
+                dominators();
+            }
+
+            const Program& program() const
+            {
+                return m_program;
+            }
+
+            const std::vector<BasicBlock>& blocks() const
+            {
+                return m_blocks;
+            }
+
+            const BasicBlock& block(int32_t a_block) const
+            {
+                return m_blocks[a_block];
+            }
+
+            int32_t blockOf(int32_t a_instruction) const
+            {
+                return m_blockOf[a_instruction];
+            }
+
+            // Reachable blocks in reverse postorder; the entry block comes first.
+            const std::vector<int32_t>& reversePostorder() const
+            {
+                return m_order;
+            }
+
+            bool reachable(int32_t a_block) const
+            {
+                return m_rank[a_block] != -1;
+            }
+
+            bool dominates(int32_t a_dominator, int32_t a_block) const
+            {
+                if (!reachable(a_block))
+                {
+                    return false;
+                }
+
+                while (a_block != a_dominator && a_block != 0)
+                {
+                    a_block = m_blocks[a_block].idom;
+                }
+                return a_block == a_dominator;
+            }
+
+            // Natural loops, one per header, innermost first; irreducible cycles have none.
+            std::vector<Loop> loops() const
+            {
+                std::vector<Loop> result{};
+                for (int32_t header : m_order)
+                {
+                    Loop loop{header, {}, {header}};
+                    for (int32_t predecessor : m_blocks[header].predecessors)
+                    {
+                        if (dominates(header, predecessor))
+                        {
+                            loop.latches.push_back(predecessor);
+                        }
+                    }
+                    if (loop.latches.empty())
+                    {
+                        continue;
+                    }
+
+                    std::vector<bool> inLoop(m_blocks.size());
+                    inLoop[header] = true;
+                    std::vector<int32_t> worklist = loop.latches;
+                    while (!worklist.empty())
+                    {
+                        int32_t block = worklist.back();
+                        worklist.pop_back();
+                        if (inLoop[block])
+                        {
+                            continue;
+                        }
+
+                        inLoop[block] = true;
+                        loop.blocks.push_back(block);
+                        for (int32_t predecessor : m_blocks[block].predecessors)
+                        {
+                            if (reachable(predecessor))
+                            {
+                                worklist.push_back(predecessor);
+                            }
+                        }
+                    }
+
+                    std::sort(loop.blocks.begin(), loop.blocks.end());
+                    result.push_back(std::move(loop));
+                }
+
+                std::stable_sort(result.begin(), result.end(), [](const Loop& a_left, const Loop& a_right)
+                {
+                    return a_left.blocks.size() < a_right.blocks.size();
+                });
+                return result;
+            }
+    };
+
+    // Collects replacements for single instructions and applies them in one pass.
+    // Jump operands in the replacements, like those in the original code, are old indices.
+    class Rewrite
+    {
+        private:
+            std::vector<std::vector<Instruction>> m_replacements;
+            std::vector<bool>                     m_replaced;
+            std::vector<std::vector<Instruction>> m_inserted;
+            std::vector<std::vector<Instruction>> m_prepended;
+            bool                                  m_changed{};
+
+        public:
+
+            Rewrite(const Program& a_program)
+                : m_replacements(a_program.code().size()), m_replaced(a_program.code().size())
+                , m_inserted(a_program.code().size()), m_prepended(a_program.code().size())
+            {
+            }
+
+            void replace(int32_t a_index, std::vector<Instruction> a_instructions)
+            {
+                m_replacements[a_index] = std::move(a_instructions);
+                m_replaced[a_index]     = true;
+                m_changed               = true;
+            }
+
+            void remove(int32_t a_index)
+            {
+                replace(a_index, {});
+            }
+
+            void insertAfter(int32_t a_index, Instruction a_instruction)
+            {
+                m_inserted[a_index].push_back(a_instruction);
+                m_changed = true;
+            }
+
+            // Code run on the way into a_index by falling through; jumps to it skip the code.
+            void insertBefore(int32_t a_index, const std::vector<Instruction>& a_instructions)
+            {
+                m_prepended[a_index].insert(m_prepended[a_index].end(), a_instructions.begin(), a_instructions.end());
+                m_changed = m_changed || !a_instructions.empty();
+            }
+
+            bool replaced(int32_t a_index) const
+            {
+                return m_replaced[a_index];
+            }
+
+            bool changed() const
+            {
+                return m_changed;
+            }
+
+            void apply(Program& a_program) const
+            {
+                std::vector<Instruction>& code = a_program.code();
+                std::vector<int32_t> newIndex(code.size() + 1);
+                std::vector<Instruction> result{};
+
+                for (size_t i = 0; i < code.size(); ++i)
+                {
+                    result.insert(result.end(), m_prepended[i].begin(), m_prepended[i].end());
+                    newIndex[i] = result.size();
+                    if (m_replaced[i])
+                    {
+                        result.insert(result.end(), m_replacements[i].begin(), m_replacements[i].end());
+                    }
+                    else
+                    {
+                        result.push_back(code[i]);
+                    }
+                    result.insert(result.end(), m_inserted[i].begin(), m_inserted[i].end());
+                }
+                newIndex[code.size()] = result.size();
+
+                for (auto& instruction : result)
+                {
+                    if (isJump(instruction.opcode))
+                    {
+                        instruction.operand = newIndex[instruction.operand];
+                    }
+                }
+
+                code = std::move(result);
+            }
+    };
+}
+
+#endif // CONTROL_FLOW_HPP
@@ -0,0 +1,464 @@
+#ifndef CPP_EMITTER_HPP
+#define CPP_EMITTER_HPP
+
+#include <algorithm>
+#include <cstdio>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Bytecode.hpp"
+
+namespace mli {
+
+    class CppEmitter
+    {
+        private:
+            using Stack = std::vector<Token::Type>;
+
+            const Program&     m_program;
+            std::vector<Stack> m_stacks;
+            std::vector<bool>  m_reachable;
+            std::vector<bool>  m_labels;
+            size_t             m_maxDepth{};
+
+            static char prefix(Token::Type a_type)
+            {
+                switch (a_type)
+                {
+                    case Token::Type::INT:  return 'i';
+                    case Token::Type::REAL: return 'r';
+                    default:                return 's';
+                }
+            }
+
+            static std::string temporary(Token::Type a_type, size_t a_depth)
+            {
+                return prefix(a_type) + std::to_string(a_depth);
+            }
+
+            std::string variable(Token::Type a_type, int32_t a_slot) const
+            {
+                return std::string("v") + prefix(a_type) + std::to_string(a_slot) + "_"
+                    + m_program.variableAt(a_type == Token::Type::INT ? Opcode::LOAD_INT
+                        : a_type == Token::Type::REAL ? Opcode::LOAD_REAL : Opcode::LOAD_STRING, a_slot).name;
+            }
+
+            std::string flag(Token::Type a_type, int32_t a_slot) const
+            {
+                return std::string("a") + prefix(a_type) + std::to_string(a_slot);
+            }
+
+            static std::string quote(const std::string& a_string)
+            {
+                std::string result{"\""};
+                for (unsigned char c : a_string)
+                {
+                    if (c == '"' || c == '\\')
+                    {
+                        result += '\\';
+                        result += c;
+                    }
+                    else if (c < 0x20 || c >= 0x7F)
+                    {
+                        char escaped[8]{};
+                        std::snprintf(escaped, sizeof(escaped), "\\%03o", c);
+                        result += escaped;
+                    }
+                    else
+                    {
+                        result += c;
+                    }
+                }
+                return result + "\"";
+            }
+
+            static std::string literal(double a_value)
+            {
+                std::ostringstream out{};
+                out << std::hexfloat << a_value;
+                return out.str();
+            }
+
+            static const char* comparison(int a_index)
+            {
+                static const char* s_operators[] = {"==", "!=", "<", ">", "<=", ">="};
+                return s_operators[a_index];
+            }
+
+            static const char* arithmetic(int a_index)
+            {
+                static const char* s_operators[] = {"+", "-", "*", "/"};
+                return s_operators[a_index];
+            }
+
+            static void transfer(const Instruction& a_instruction, Stack& a_stack)
+            {
+                Opcode opcode = a_instruction.opcode;
+
+                switch (opcode)
+                {
+                    case Opcode::PUSH_INT:
+                    case Opcode::LOAD_INT:
+                        a_stack.push_back(Token::Type::INT);
+                        break;
+                    case Opcode::PUSH_REAL:
+                    case Opcode::LOAD_REAL:
+                        a_stack.push_back(Token::Type::REAL);
+                        break;
+                    case Opcode::PUSH_STRING:
+                    case Opcode::LOAD_STRING:
+                        a_stack.push_back(Token::Type::STRING);
+                        break;
+                    case Opcode::LOAD_INT_PUSH_INT:
+                        a_stack.push_back(Token::Type::INT);
+                        a_stack.push_back(Token::Type::INT);
+                        break;
+                    case Opcode::APPEND_STRING:
+                        a_stack.resize(a_stack.size() - a_instruction.arity);
+                        break;
+                    case Opcode::CONCAT:
+                        a_stack.resize(a_stack.size() - a_instruction.operand + 1);
+                        break;
+                    case Opcode::TO_INT:
+                        a_stack.back() = Token::Type::INT;
+                        break;
+                    case Opcode::TO_REAL:
+                        a_stack.back() = Token::Type::REAL;
+                        break;
+                    case Opcode::TO_REAL_SECOND:
+                        a_stack[a_stack.size() - 2] = Token::Type::REAL;
+                        break;
+                    case Opcode::STORE_INT:
+                    case Opcode::STORE_REAL:
+                    case Opcode::STORE_STRING:
+                    case Opcode::WRITE:
+                    case Opcode::POP:
+                    case Opcode::JUMP_FALSE:
+                    case Opcode::JUMP_TRUE:
+                        a_stack.pop_back();
+                        break;
+                    case Opcode::ADD_INT:
+                    case Opcode::SUB_INT:
+                    case Opcode::MUL_INT:
+                    case Opcode::DIV_INT:
+                    case Opcode::ADD_REAL:
+                    case Opcode::SUB_REAL:
+                    case Opcode::MUL_REAL:
+                    case Opcode::DIV_REAL:
+                        a_stack.pop_back();
+                        break;
+                    case Opcode::AND:
+                    case Opcode::OR:
+                        a_stack.pop_back();
+                        a_stack.back() = Token::Type::INT;
+                        break;
+                    default:
+                        if (isComparison(opcode))
+                        {
+                            a_stack.pop_back();
+                            a_stack.back() = Token::Type::INT;
+                        }
+                        else if (opcode >= Opcode::EQ_INT_JUMP_FALSE)
+                        {
+                            a_stack.resize(a_stack.size() - 2);
+                        }
+                        break;
+                }
+            }
+
+            void analyze()
+            {
+                const std::vector<Instruction>& code = m_program.code();
+                m_stacks.assign(code.size(), {});
+                m_reachable.assign(code.size(), false);
+                m_labels.assign(code.size(), false);
+
+                std::vector<size_t> worklist{0};
+                m_reachable[0] = true;
+
+                auto reach = [&](size_t a_index, const Stack& a_stack)
+                {
+                    if (a_index >= code.size())
+                    {
+                        throw std::runtime_error("[CppEmitter]: control flow leaves the program");
+                    }
+
+                    if (!m_reachable[a_index])
+                    {
+                        m_reachable[a_index] = true;
+                        m_stacks[a_index]    = a_stack;
+                        worklist.push_back(a_index);
+                    }
+                    else if (m_stacks[a_index] != a_stack)
+                    {
+                        throw std::runtime_error("[CppEmitter]: inconsistent operand stack at " + std::to_string(a_index));
+                    }
+                };
+
+                while (!worklist.empty())
+                {
+                    size_t index = worklist.back();
+                    worklist.pop_back();
+
+                    const Instruction& instruction = code[index];
+                    Stack stack = m_stacks[index];
+                    transfer(instruction, stack);
+                    m_maxDepth = std::max(m_maxDepth, stack.size());
+
+                    if (isJump(instruction.opcode))
+                    {
+                        m_labels[instruction.operand] = true;
+                        reach(instruction.operand, stack);
+                    }
+                    if (instruction.opcode != Opcode::JUMP && instruction.opcode != Opcode::HALT)
+                    {
+                        reach(index + 1, stack);
+                    }
+                }
+            }
+
+            std::string loadChecked(Token::Type a_type, int32_t a_slot) const
+            {
+                return "if (!" + flag(a_type, a_slot) + ") mli_rt::unassigned(); ";
+            }
+
+            void statement(std::ostream& a_out, size_t a_index) const
+            {
+                const Instruction& instruction = m_program.code()[a_index];
+                const Stack&       stack       = m_stacks[a_index];
+
+                Opcode  opcode  = instruction.opcode;
+                int32_t operand = instruction.operand;
+                size_t  depth   = stack.size();
+
+                auto top = [&](size_t a_fromTop)
+                {
+                    return temporary(stack[depth - a_fromTop], depth - a_fromTop);
+                };
+
+                std::string label = "goto L" + std::to_string(operand) + ";";
+
+                switch (opcode)
+                {
+                    case Opcode::PUSH_INT:
+                        a_out << temporary(Token::Type::INT, depth) << " = " << operand << ";";
+                        break;
+                    case Opcode::PUSH_REAL:
+                        a_out << temporary(Token::Type::REAL, depth) << " = " << literal(m_program.reals()[operand]) << ";";
+                        break;
+                    case Opcode::PUSH_STRING:
+                        a_out << temporary(Token::Type::STRING, depth) << " = " << quote(m_program.strings()[operand]) << ";";
+                        break;
+
+                    case Opcode::LOAD_INT:
+                    case Opcode::LOAD_REAL:
+                    case Opcode::LOAD_STRING:
+                    {
+                        Token::Type type = slotType(opcode);
+                        a_out << ((instruction.arity & Instruction::s_checked) ? loadChecked(type, operand) : "") << temporary(type, depth) << " = " << variable(type, operand) << ";";
+                        break;
+                    }
+
+                    case Opcode::STORE_INT:
+                    case Opcode::STORE_REAL:
+                    case Opcode::STORE_STRING:
+                    case Opcode::STORE_KEEP_INT:
+                    case Opcode::STORE_KEEP_REAL:
+                    case Opcode::STORE_KEEP_STRING:
+                    {
+                        Token::Type type = slotType(opcode);
+                        a_out << variable(type, operand) << " = " << top(1) << "; " << flag(type, operand) << " = true;";
+                        break;
+                    }
+
+                    case Opcode::READ_INT:
+                        a_out << variable(Token::Type::INT, operand) << " = mli_rt::readInt(); " << flag(Token::Type::INT, operand) << " = true;";
+                        break;
+                    case Opcode::READ_REAL:
+                        a_out << variable(Token::Type::REAL, operand) << " = mli_rt::readReal(); " << flag(Token::Type::REAL, operand) << " = true;";
+                        break;
+                    case Opcode::READ_STRING:
+                        a_out << variable(Token::Type::STRING, operand) << " = mli_rt::readString(); " << flag(Token::Type::STRING, operand) << " = true;";
+                        break;
+
+                    case Opcode::APPEND_STRING:
+                        a_out << loadChecked(Token::Type::STRING, operand);
+                        for (size_t i = instruction.arity; i > 0; --i)
+                        {
+                            a_out << variable(Token::Type::STRING, operand) << " += " << top(i) << "; ";
+                        }
+                        break;
+
+                    case Opcode::CONCAT:
+                        for (int32_t i = operand - 1; i > 0; --i)
+                        {
+                            a_out << top(operand) << " += " << top(i) << "; ";
+                        }
+                        break;
+
+                    case Opcode::WRITE:
+                        a_out << "mli_rt::write(" << top(1) << ");";
+                        break;
+
+                    case Opcode::POP:
+                        break;
+
+                    case Opcode::TO_INT:
+                        a_out << temporary(Token::Type::INT, depth - 1) << " = static_cast<int32_t>(" << top(1) << ");";
+                        break;
+                    case Opcode::TO_REAL:
+                        a_out << temporary(Token::Type::REAL, depth - 1) << " = " << top(1) << ";";
+                        break;
+                    case Opcode::TO_REAL_SECOND:
+                        a_out << temporary(Token::Type::REAL, depth - 2) << " = " << top(2) << ";";
+                        break;
+
+                    case Opcode::ADD_INT:
+                    case Opcode::SUB_INT:
+                    case Opcode::MUL_INT:
+                    case Opcode::DIV_INT:
+                        if (instruction.arity & Instruction::s_checked)
+                        {
+                            a_out << "if (" << top(1) << " == 0) mli_rt::divisionByZero(); ";
+                        }
+                        if (instruction.arity & Instruction::s_exact)
+                        {
+                            a_out << top(2) << " = " << top(2) << " "
+                                << arithmetic(static_cast<int>(opcode) - static_cast<int>(Opcode::ADD_INT)) << " " << top(1) << ";";
+                            break;
+                        }
+                        a_out << top(2) << " = mli_rt::wrap(int64_t(" << top(2) << ") "
+                            << arithmetic(static_cast<int>(opcode) - static_cast<int>(Opcode::ADD_INT)) << " " << top(1) << ");";
+                        break;
+
+                    case Opcode::ADD_REAL:
+                    case Opcode::SUB_REAL:
+                    case Opcode::MUL_REAL:
+                    case Opcode::DIV_REAL:
+                        a_out << top(2) << " = " << top(2) << " "
+                            << arithmetic(static_cast<int>(opcode) - static_cast<int>(Opcode::ADD_REAL)) << " " << top(1) << ";";
+                        break;
+
+                    case Opcode::NEG_INT:
+                        if (instruction.arity & Instruction::s_exact)
+                        {
+                            a_out << top(1) << " = -" << top(1) << ";";
+                            break;
+                        }
+                        a_out << top(1) << " = mli_rt::wrap(-int64_t(" << top(1) << "));";
+                        break;
+                    case Opcode::NEG_REAL:
+                        a_out << top(1) << " = -" << top(1) << ";";
+                        break;
+                    case Opcode::NOT:
+                        a_out << top(1) << " = !" << top(1) << ";";
+                        break;
+
+                    case Opcode::AND:
+                    case Opcode::OR:
+                        a_out << temporary(Token::Type::INT, depth - 2) << " = " << top(2)
+                            << (opcode == Opcode::AND ? " && " : " || ") << top(1) << ";";
+                        break;
+
+                    case Opcode::JUMP:
+                        a_out << label;
+                        break;
+                    case Opcode::JUMP_FALSE:
+                    case Opcode::JUMP_FALSE_LAZY:
+                        a_out << "if (!" << top(1) << ") " << label;
+                        break;
+                    case Opcode::JUMP_TRUE:
+                    case Opcode::JUMP_TRUE_LAZY:
+                        a_out << "if (" << top(1) << ") " << label;
+                        break;
+
+                    case Opcode::HALT:
+                        a_out << "return;";
+                        break;
+
+                    case Opcode::INC_INT:
+                    {
+                        std::string target = variable(Token::Type::INT, instruction.arity);
+                        a_out << target << " = mli_rt::wrap(int64_t(" << target << ") + " << operand << ");";
+                        break;
+                    }
+
+                    case Opcode::LOAD_INT_PUSH_INT:
+                        a_out << temporary(Token::Type::INT, depth) << " = " << variable(Token::Type::INT, instruction.arity) << "; "
+                            << temporary(Token::Type::INT, depth + 1) << " = " << operand << ";";
+                        break;
+
+                    default:
+                        if (isComparison(opcode))
+                        {
+                            int index = (static_cast<int>(opcode) - static_cast<int>(Opcode::EQ_INT)) % 6;
+                            a_out << temporary(Token::Type::INT, depth - 2) << " = " << top(2) << " " << comparison(index) << " " << top(1) << ";";
+                        }
+                        else
+                        {
+                            int index = static_cast<int>(opcode) - static_cast<int>(Opcode::EQ_INT_JUMP_FALSE);
+                            a_out << "if (!(" << top(2) << " " << comparison(index) << " " << top(1) << ")) " << label;
+                        }
+                        break;
+                }
+            }
+
+        public:
+
+            CppEmitter(const Program& a_program)
+                : m_program(a_program)
+            {
+            }
+
+            void emit(std::ostream& a_out)
+            {
+                analyze();
+
+                a_out << "// Generated by mli --emit-cpp; build with: c++ -O2 -std=c++20 -I<mli>/src\n";
+                a_out << "#include \"MliRuntime.hpp\"\n\n";
+                a_out << "static void program()\n{\n";
+
+                for (auto& variable : m_program.variables())
+                {
+                    const char* type = (variable.type == Token::Type::INT) ? "int32_t"
+                        : (variable.type == Token::Type::REAL) ? "double" : "std::string";
+                    a_out << "    " << type << " " << this->variable(variable.type, variable.slot) << "{}; "
+                        << "bool " << flag(variable.type, variable.slot) << "{};\n";
+                }
+
+                for (size_t depth = 0; depth < m_maxDepth + 1; ++depth)
+                {
+                    a_out << "    [[maybe_unused]] int32_t " << temporary(Token::Type::INT, depth) << "{}; "
+                        << "[[maybe_unused]] double " << temporary(Token::Type::REAL, depth) << "{}; "
+                        << "[[maybe_unused]] std::string " << temporary(Token::Type::STRING, depth) << "{};\n";
+                }
+
+                a_out << "\n";
+
+                const std::vector<Instruction>& code = m_program.code();
+                for (size_t i = 0; i < code.size(); ++i)
+                {
+                    if (!m_reachable[i])
+                    {
+                        continue;
+                    }
+
+                    if (m_labels[i])
+                    {
+                        a_out << "L" << i << ":\n";
+                    }
+
+                    a_out << "    ";
+                    statement(a_out, i);
+                    a_out << "\n";
+                }
+
+                a_out << "}\n\nint main()\n{\n    return mli_rt::run(program);\n}\n";
+            }
+    };
+}
+
+#endif // CPP_EMITTER_HPP
@@ -0,0 +1,97 @@
+#ifndef DEFINITE_ASSIGNMENT_HPP
+#define DEFINITE_ASSIGNMENT_HPP
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "Bytecode.hpp"
+#include "ControlFlow.hpp"
+#include "Ssa.hpp"
+
+namespace mli {
+
+    // Clears the runtime check of every load that an assignment reaches on all paths.
+    // A read of a variable no path assigns is a compile error when every run that
+    // reaches the end of the program executes it; elsewhere it keeps its check.
+    class DefiniteAssignment
+    {
+        private:
+            Program m_program;
+            size_t  m_checked{};
+            size_t  m_unchecked{};
+
+            bool alwaysExecuted(const ControlFlowGraph& a_cfg, int32_t a_block) const
+            {
+                bool halts = false;
+                for (int32_t block : a_cfg.reversePostorder())
+                {
+                    if (m_program.code()[a_cfg.block(block).end - 1].opcode != Opcode::HALT)
+                    {
+                        continue;
+                    }
+
+                    halts = true;
+                    if (!a_cfg.dominates(a_block, block))
+                    {
+                        return false;
+                    }
+                }
+                return halts;
+            }
+
+        public:
+
+            DefiniteAssignment(const Program& a_program)
+                : m_program(a_program)
+            {
+            }
+
+            Program check()
+            {
+                ControlFlowGraph cfg{m_program};
+                SsaForm ssa{cfg};
+                std::vector<Instruction>& code = m_program.code();
+
+                for (int32_t block : cfg.reversePostorder())
+                {
+                    for (int32_t i = cfg.block(block).begin; i < cfg.block(block).end; ++i)
+                    {
+                        Opcode opcode = code[i].opcode;
+                        if (!isLoad(opcode) && opcode != Opcode::APPEND_STRING)
+                        {
+                            continue;
+                        }
+
+                        int32_t value = ssa.use(i);
+                        if (ssa.definitelyUnassigned(value) && alwaysExecuted(cfg, block))
+                        {
+                            throw std::runtime_error("[DefiniteAssignment]: variable " + m_program.variableAt(opcode, code[i].operand).name
+                                + " is read before it is assigned");
+                        }
+
+                        // APPEND_STRING keeps its arity for the appended operands and always checks.
+                        if (isLoad(opcode))
+                        {
+                            code[i].arity = ssa.maybeUnassigned(value) ? Instruction::s_checked : 0;
+                            ++(ssa.maybeUnassigned(value) ? m_checked : m_unchecked);
+                        }
+                    }
+                }
+
+                return m_program;
+            }
+
+            size_t checked() const
+            {
+                return m_checked;
+            }
+
+            size_t unchecked() const
+            {
+                return m_unchecked;
+            }
+    };
+}
+
+#endif // DEFINITE_ASSIGNMENT_HPP
@@ -0,0 +1,1452 @@
+#ifndef ELF_EMITTER_HPP
+#define ELF_EMITTER_HPP
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Bytecode.hpp"
+#include "Jit.hpp"
+#include "Value.hpp"
+#include "X86Assembler.hpp"
+
+namespace mli {
+
+    class ElfEmitter
+    {
+        private:
+            static constexpr uint64_t s_textBase     = 0x400000;
+            static constexpr uint64_t s_headerSize   = 64 + 3 * 56;
+            static constexpr uint64_t s_codeOffset   = (s_headerSize + 15) & ~15ull;
+            static constexpr uint64_t s_pageSize     = 0x1000;
+            // Each string arena reserves address space for two halves of up to s_*Reserve bytes
+            // and starts collecting at s_*Limit, which doubles whenever a collection leaves it
+            // more than half full. Headers are mapped below 2 GiB, as handles are 32 bits.
+            static constexpr uint64_t s_headerReserve = 512ull << 20;
+            static constexpr uint64_t s_dataReserve   = 64ull << 30;
+            static constexpr int32_t  s_headerLimit   = 4 << 20;
+            static constexpr int32_t  s_dataLimit     = 32 << 20;
+
+            static constexpr int32_t  s_bufferSize     = 1 << 16;
+            static constexpr int32_t  s_outputLength   = 0;
+            static constexpr int32_t  s_inputPosition  = 8;
+            static constexpr int32_t  s_inputLength    = 16;
+            static constexpr int32_t  s_headerTop      = 24;
+            static constexpr int32_t  s_headerEnd      = 32;
+            static constexpr int32_t  s_dataTop        = 40;
+            static constexpr int32_t  s_dataEnd        = 48;
+            static constexpr int32_t  s_inputFailed    = 56;
+            static constexpr int32_t  s_scratch        = 64;
+            static constexpr int32_t  s_outputBuffer   = 128;
+            static constexpr int32_t  s_inputBuffer    = s_outputBuffer + s_bufferSize;
+            static constexpr int32_t  s_headerSpace    = s_inputBuffer + s_bufferSize;
+            static constexpr int32_t  s_spareHeaders   = s_headerSpace + 8;
+            static constexpr int32_t  s_dataSpace      = s_headerSpace + 16;
+            static constexpr int32_t  s_spareData      = s_headerSpace + 24;
+            static constexpr int32_t  s_headerExtent   = s_headerSpace + 32;
+            static constexpr int32_t  s_dataExtent     = s_headerSpace + 40;
+            static constexpr int32_t  s_headerMaximum  = s_headerSpace + 48;
+            static constexpr int32_t  s_dataMaximum    = s_headerSpace + 56;
+            static constexpr int32_t  s_globalsSize    = s_headerSpace + 64;
+
+            const Program& m_program;
+            JitRuntime     m_layout;
+            X86Assembler   m_assembler;
+
+            uint64_t m_constants{};
+            uint64_t m_dataBase{};
+            uint64_t m_stackBase{};
+            uint64_t m_variablesBase{};
+            uint64_t m_dataSize{};
+
+            size_t m_flush{};
+            size_t m_exit{};
+            size_t m_put{};
+            size_t m_newline{};
+            size_t m_writeInt{};
+            size_t m_writeString{};
+            size_t m_writeReal{};
+            size_t m_write{};
+            size_t m_getc{};
+            size_t m_ungetc{};
+            size_t m_skipSpace{};
+            size_t m_readInt{};
+            size_t m_readReal{};
+            size_t m_outOfMemory{};
+            size_t m_unassigned{};
+            size_t m_divisionByZero{};
+            size_t m_forward{};
+            size_t m_collect{};
+            size_t m_reserve{};
+            size_t m_newHeader{};
+            size_t m_readString{};
+            size_t m_concat{};
+            size_t m_compare{};
+
+            static uint64_t align(uint64_t a_value, uint64_t a_alignment)
+            {
+                return (a_value + a_alignment - 1) / a_alignment * a_alignment;
+            }
+
+            static uint64_t bits(double a_value)
+            {
+                return std::bit_cast<uint64_t>(a_value);
+            }
+
+            uint64_t address(size_t a_offset) const
+            {
+                return s_textBase + s_codeOffset + a_offset;
+            }
+
+            uint64_t constant(int32_t a_index) const
+            {
+                return m_constants + 16 * a_index;
+            }
+
+            void callTo(size_t a_routine)
+            {
+                m_assembler.patch(m_assembler.call(), a_routine);
+            }
+
+            void jumpTo(size_t a_routine)
+            {
+                m_assembler.patch(m_assembler.jmp(), a_routine);
+            }
+
+            void here(size_t a_fixup)
+            {
+                m_assembler.patch(a_fixup, m_assembler.size());
+            }
+
+            void layout()
+            {
+                m_layout.layout(m_program);
+
+                uint64_t variables = m_layout.m_stringFlagOffset + m_program.stringSlots();
+
+                m_stackBase     = align(s_globalsSize, 16);
+                m_variablesBase = align(m_stackBase + 8 * (m_program.maxDepth() + 1), 16);
+                m_dataSize      = align(m_variablesBase + variables, s_pageSize);
+            }
+
+            size_t message(const std::string& a_text)
+            {
+                size_t offset = m_assembler.size();
+                for (char c : a_text)
+                {
+                    m_assembler.byte(c);
+                }
+                return offset;
+            }
+
+            void constants()
+            {
+                const std::vector<std::string>& strings = m_program.strings();
+
+                m_constants = address(m_assembler.size());
+                uint64_t bytes = m_constants + 16 * strings.size();
+
+                for (auto& string : strings)
+                {
+                    m_assembler.qword(bytes);
+                    m_assembler.qword(string.size());
+                    bytes += string.size();
+                }
+
+                for (auto& string : strings)
+                {
+                    message(string);
+                }
+            }
+
+            void pad()
+            {
+                while (m_assembler.size() % 16)
+                {
+                    m_assembler.byte(0xCC);
+                }
+            }
+
+            void emitOutput()
+            {
+                X86Assembler& a = m_assembler;
+
+                m_flush = a.size();
+                a.load64(Reg::RDX, Reg::RBX, s_outputLength);
+                a.lea(Reg::RSI, Reg::RBX, s_outputBuffer);
+                size_t flushLoop = a.size();
+                a.test64(Reg::RDX, Reg::RDX);
+                size_t flushed = a.jcc(Condition::E);
+                a.movImm(Reg::RAX, 1);
+                a.movImm(Reg::RDI, 1);
+                a.syscall();
+                a.test64(Reg::RAX, Reg::RAX);
+                size_t failed = a.jcc(Condition::LE);
+                a.add64(Reg::RSI, Reg::RAX);
+                a.sub64(Reg::RDX, Reg::RAX);
+                a.patch(a.jmp(), flushLoop);
+                here(flushed);
+                here(failed);
+                a.storeImm64(Reg::RBX, s_outputLength, 0);
+                a.ret();
+
+                m_exit = a.size();
+                a.push(Reg::RDI);
+                callTo(m_flush);
+                a.pop(Reg::RDI);
+                a.movImm(Reg::RAX, 231);
+                a.syscall();
+
+                m_put = a.size();
+                size_t putLoop = a.size();
+                a.test64(Reg::RDX, Reg::RDX);
+                size_t putDone = a.jcc(Condition::E);
+                a.load64(Reg::RAX, Reg::RBX, s_outputLength);
+                a.cmpImm(Reg::RAX, s_bufferSize);
+                size_t room = a.jcc(Condition::B);
+                a.push(Reg::RSI);
+                a.push(Reg::RDX);
+                callTo(m_flush);
+                a.pop(Reg::RDX);
+                a.pop(Reg::RSI);
+                a.patch(a.jmp(), putLoop);
+                here(room);
+                a.movImm(Reg::RCX, s_bufferSize);
+                a.sub64(Reg::RCX, Reg::RAX);
+                a.cmp64(Reg::RDX, Reg::RCX);
+                size_t keep = a.jcc(Condition::AE);
+                a.mov(Reg::RCX, Reg::RDX);
+                here(keep);
+                a.lea(Reg::RDI, Reg::RBX, s_outputBuffer);
+                a.add64(Reg::RDI, Reg::RAX);
+                a.add64(Reg::RAX, Reg::RCX);
+                a.store64(Reg::RBX, s_outputLength, Reg::RAX);
+                a.sub64(Reg::RDX, Reg::RCX);
+                a.repMovsb();
+                a.patch(a.jmp(), putLoop);
+                here(putDone);
+                a.ret();
+
+                m_newline = a.size();
+                a.lea(Reg::RSI, Reg::RBX, s_scratch);
+                a.storeByte(Reg::RSI, 0, '\n');
+                a.movImm(Reg::RDX, 1);
+                jumpTo(m_put);
+
+                m_writeInt = a.size();
+                a.movsx64(Reg::RAX, Reg::RDI);
+                a.lea(Reg::RSI, Reg::RBX, s_scratch + 64);
+                a.subImm(Reg::RSI, 1);
+                a.storeByte(Reg::RSI, 0, '\n');
+                a.mov(Reg::R8, Reg::RAX);
+                a.test64(Reg::RAX, Reg::RAX);
+                size_t positive = a.jcc(Condition::NS);
+                a.neg64(Reg::RAX);
+                here(positive);
+                a.movImm(Reg::RCX, 10);
+                size_t digit = a.size();
+                a.xor64(Reg::RDX, Reg::RDX);
+                a.div64(Reg::RCX);
+                a.addImm(Reg::RDX, '0');
+                a.subImm(Reg::RSI, 1);
+                a.storeByteReg(Reg::RSI, 0, Reg::RDX);
+                a.test64(Reg::RAX, Reg::RAX);
+                a.patch(a.jcc(Condition::NE), digit);
+                a.test64(Reg::R8, Reg::R8);
+                size_t unsignedDone = a.jcc(Condition::NS);
+                a.subImm(Reg::RSI, 1);
+                a.storeByte(Reg::RSI, 0, '-');
+                here(unsignedDone);
+                a.lea(Reg::RDX, Reg::RBX, s_scratch + 64);
+                a.sub64(Reg::RDX, Reg::RSI);
+                jumpTo(m_put);
+
+                m_writeString = a.size();
+                a.mov32(Reg::RDI, Reg::RDI);
+                a.load64(Reg::RSI, Reg::RDI, 0);
+                a.load64(Reg::RDX, Reg::RDI, 8);
+                callTo(m_put);
+                jumpTo(m_newline);
+
+                emitWriteReal();
+
+                m_write = a.size();
+                a.mov(Reg::RAX, Reg::RDI);
+                a.shrImm(Reg::RAX, 48);
+                a.cmpImm(Reg::RAX, Value::fromInt(0).bits() >> 48);
+                a.patch(a.jcc(Condition::E), m_writeInt);
+                a.cmpImm(Reg::RAX, Value::fromString(0).bits() >> 48);
+                a.patch(a.jcc(Condition::E), m_writeString);
+                a.movqToXmm(Xmm::XMM0, Reg::RDI);
+                jumpTo(m_writeReal);
+            }
+
+            // Formats xmm0 the way std::ostream does by default (%g, six significant digits).
+            void emitWriteReal()
+            {
+                X86Assembler& a = m_assembler;
+
+                auto put = [&](char a_char)
+                {
+                    a.storeByte(Reg::R8, 0, a_char);
+                    a.addImm(Reg::R8, 1);
+                };
+
+                auto digit = [&]()
+                {
+                    a.lea(Reg::RDI, Reg::RBX, s_scratch);
+                    a.add64(Reg::RDI, Reg::RCX);
+                    a.movzxByteLoad(Reg::RAX, Reg::RDI, 0);
+                    a.storeByteReg(Reg::R8, 0, Reg::RAX);
+                    a.addImm(Reg::R8, 1);
+                };
+
+                auto loopWhile = [&](Reg a_left, Reg a_right, Condition a_condition, size_t a_target)
+                {
+                    a.cmp64(a_left, a_right);
+                    a.patch(a.jcc(a_condition), a_target);
+                };
+
+                m_writeReal = a.size();
+                a.lea(Reg::R8, Reg::RBX, s_scratch + 8);
+                a.ucomisd(Xmm::XMM0, Xmm::XMM0);
+                size_t nan = a.jcc(Condition::P);
+                a.movqFromXmm(Reg::RAX, Xmm::XMM0);
+                a.test64(Reg::RAX, Reg::RAX);
+                size_t positive = a.jcc(Condition::NS);
+                put('-');
+                a.movImm(Reg::RCX, 0x7FFFFFFFFFFFFFFFull);
+                a.and64(Reg::RAX, Reg::RCX);
+                a.movqToXmm(Xmm::XMM0, Reg::RAX);
+                here(positive);
+                a.movImm(Reg::RCX, bits(INFINITY));
+                a.cmp64(Reg::RAX, Reg::RCX);
+                size_t inf = a.jcc(Condition::E);
+                a.test64(Reg::RAX, Reg::RAX);
+                size_t zero = a.jcc(Condition::E);
+
+                a.xor64(Reg::R9, Reg::R9);
+                a.movImm(Reg::RAX, bits(10.0));
+                a.movqToXmm(Xmm::XMM1, Reg::RAX);
+                size_t down = a.size();
+                a.ucomisd(Xmm::XMM0, Xmm::XMM1);
+                size_t below = a.jcc(Condition::B);
+                a.divsd(Xmm::XMM0, Xmm::XMM1);
+                a.addImm(Reg::R9, 1);
+                a.patch(a.jmp(), down);
+                here(below);
+                a.movImm(Reg::RAX, bits(1.0));
+                a.movqToXmm(Xmm::XMM2, Reg::RAX);
+                size_t up = a.size();
+                a.ucomisd(Xmm::XMM0, Xmm::XMM2);
+                size_t scaled = a.jcc(Condition::AE);
+                a.mulsd(Xmm::XMM0, Xmm::XMM1);
+                a.subImm(Reg::R9, 1);
+                a.patch(a.jmp(), up);
+                here(scaled);
+
+                a.movImm(Reg::RAX, bits(1e5));
+                a.movqToXmm(Xmm::XMM2, Reg::RAX);
+                a.mulsd(Xmm::XMM0, Xmm::XMM2);
+                a.cvtsd2si64(Reg::RAX, Xmm::XMM0);
+                a.cmpImm(Reg::RAX, 1000000);
+                size_t rounded = a.jcc(Condition::B);
+                a.xor64(Reg::RDX, Reg::RDX);
+                a.movImm(Reg::RCX, 10);
+                a.div64(Reg::RCX);
+                a.addImm(Reg::R9, 1);
+                here(rounded);
+
+                a.lea(Reg::RSI, Reg::RBX, s_scratch + 6);
+                a.movImm(Reg::RCX, 10);
+                a.movImm(Reg::R10, 6);
+                size_t digits = a.size();
+                a.xor64(Reg::RDX, Reg::RDX);
+                a.div64(Reg::RCX);
+                a.addImm(Reg::RDX, '0');
+                a.subImm(Reg::RSI, 1);
+                a.storeByteReg(Reg::RSI, 0, Reg::RDX);
+                a.subImm(Reg::R10, 1);
+                a.patch(a.jcc(Condition::NE), digits);
+
+                a.movImm(Reg::R10, 6);
+                size_t strip = a.size();
+                a.cmpImm(Reg::R10, 1);
+                size_t stripped = a.jcc(Condition::E);
+                a.lea(Reg::RDI, Reg::RBX, s_scratch - 1);
+                a.add64(Reg::RDI, Reg::R10);
+                a.movzxByteLoad(Reg::RAX, Reg::RDI, 0);
+                a.cmpImm(Reg::RAX, '0');
+                size_t significant = a.jcc(Condition::NE);
+                a.subImm(Reg::R10, 1);
+                a.patch(a.jmp(), strip);
+                here(stripped);
+                here(significant);
+
+                a.cmpImm(Reg::R9, -4);
+                size_t scientificLow = a.jcc(Condition::L);
+                a.cmpImm(Reg::R9, 6);
+                size_t scientificHigh = a.jcc(Condition::GE);
+                a.test64(Reg::R9, Reg::R9);
+                size_t small = a.jcc(Condition::S);
+
+                a.xor64(Reg::RCX, Reg::RCX);
+                size_t integral = a.size();
+                digit();
+                a.addImm(Reg::RCX, 1);
+                loopWhile(Reg::RCX, Reg::R9, Condition::LE, integral);
+                a.cmp64(Reg::RCX, Reg::R10);
+                size_t wholeNumber = a.jcc(Condition::GE);
+                put('.');
+                size_t fraction = a.size();
+                digit();
+                a.addImm(Reg::RCX, 1);
+                loopWhile(Reg::RCX, Reg::R10, Condition::L, fraction);
+                size_t fixedDone = a.jmp();
+
+                here(small);
+                put('0');
+                put('.');
+                a.mov(Reg::RCX, Reg::R9);
+                a.neg64(Reg::RCX);
+                a.subImm(Reg::RCX, 1);
+                size_t zeros = a.size();
+                a.test64(Reg::RCX, Reg::RCX);
+                size_t zerosDone = a.jcc(Condition::E);
+                put('0');
+                a.subImm(Reg::RCX, 1);
+                a.patch(a.jmp(), zeros);
+                here(zerosDone);
+                a.xor64(Reg::RCX, Reg::RCX);
+                size_t smallDigits = a.size();
+                digit();
+                a.addImm(Reg::RCX, 1);
+                loopWhile(Reg::RCX, Reg::R10, Condition::L, smallDigits);
+                size_t smallDone = a.jmp();
+
+                here(scientificLow);
+                here(scientificHigh);
+                a.xor64(Reg::RCX, Reg::RCX);
+                digit();
+                a.cmpImm(Reg::R10, 1);
+                size_t noFraction = a.jcc(Condition::E);
+                put('.');
+                a.movImm(Reg::RCX, 1);
+                size_t mantissa = a.size();
+                digit();
+                a.addImm(Reg::RCX, 1);
+                loopWhile(Reg::RCX, Reg::R10, Condition::L, mantissa);
+                here(noFraction);
+                put('e');
+                a.mov(Reg::RAX, Reg::R9);
+                a.test64(Reg::RAX, Reg::RAX);
+                size_t negativeExponent = a.jcc(Condition::S);
+                put('+');
+                size_t exponentSign = a.jmp();
+                here(negativeExponent);
+                put('-');
+                a.neg64(Reg::RAX);
+                here(exponentSign);
+                a.cmpImm(Reg::RAX, 100);
+                size_t twoDigits = a.jcc(Condition::B);
+                a.xor64(Reg::RDX, Reg::RDX);
+                a.movImm(Reg::RCX, 100);
+                a.div64(Reg::RCX);
+                a.addImm(Reg::RAX, '0');
+                a.storeByteReg(Reg::R8, 0, Reg::RAX);
+                a.addImm(Reg::R8, 1);
+                a.mov(Reg::RAX, Reg::RDX);
+                here(twoDigits);
+                a.xor64(Reg::RDX, Reg::RDX);
+                a.movImm(Reg::RCX, 10);
+                a.div64(Reg::RCX);
+                a.addImm(Reg::RAX, '0');
+                a.storeByteReg(Reg::R8, 0, Reg::RAX);
+                a.addImm(Reg::RDX, '0');
+                a.storeByteReg(Reg::R8, 1, Reg::RDX);
+                a.addImm(Reg::R8, 2);
+                size_t scientificDone = a.jmp();
+
+                here(nan);
+                put('n');
+                put('a');
+                put('n');
+                size_t nanDone = a.jmp();
+                here(inf);
+                put('i');
+                put('n');
+                put('f');
+                size_t infDone = a.jmp();
+                here(zero);
+                put('0');
+
+                here(wholeNumber);
+                here(fixedDone);
+                here(smallDone);
+                here(scientificDone);
+                here(nanDone);
+                here(infDone);
+                put('\n');
+                a.lea(Reg::RSI, Reg::RBX, s_scratch + 8);
+                a.mov(Reg::RDX, Reg::R8);
+                a.sub64(Reg::RDX, Reg::RSI);
+                jumpTo(m_put);
+            }
+
+            void emitInput()
+            {
+                X86Assembler& a = m_assembler;
+
+                m_getc = a.size();
+                a.load64(Reg::RAX, Reg::RBX, s_inputPosition);
+                a.cmp64(Reg::RAX, Reg::RBX, s_inputLength);
+                size_t buffered = a.jcc(Condition::B);
+                a.xor64(Reg::RAX, Reg::RAX);
+                a.xor64(Reg::RDI, Reg::RDI);
+                a.lea(Reg::RSI, Reg::RBX, s_inputBuffer);
+                a.movImm(Reg::RDX, s_bufferSize);
+                a.syscall();
+                a.test64(Reg::RAX, Reg::RAX);
+                size_t eof = a.jcc(Condition::LE);
+                a.store64(Reg::RBX, s_inputLength, Reg::RAX);
+                a.storeImm64(Reg::RBX, s_inputPosition, 0);
+                a.xor64(Reg::RAX, Reg::RAX);
+                here(buffered);
+                a.lea(Reg::RCX, Reg::RBX, s_inputBuffer);
+                a.add64(Reg::RCX, Reg::RAX);
+                a.movzxByteLoad(Reg::RCX, Reg::RCX, 0);
+                a.addImm(Reg::RAX, 1);
+                a.store64(Reg::RBX, s_inputPosition, Reg::RAX);
+                a.mov(Reg::RAX, Reg::RCX);
+                a.ret();
+                here(eof);
+                a.storeImm64(Reg::RBX, s_inputLength, 0);
+                a.storeImm64(Reg::RBX, s_inputPosition, 0);
+                a.movImm(Reg::RAX, -1);
+                a.ret();
+
+                m_ungetc = a.size();
+                a.load64(Reg::RAX, Reg::RBX, s_inputPosition);
+                a.subImm(Reg::RAX, 1);
+                a.store64(Reg::RBX, s_inputPosition, Reg::RAX);
+                a.ret();
+
+                m_skipSpace = a.size();
+                size_t skip = a.size();
+                callTo(m_getc);
+                a.cmpImm(Reg::RAX, ' ');
+                a.patch(a.jcc(Condition::E), skip);
+                a.cmpImm(Reg::RAX, '\t');
+                size_t notSpace = a.jcc(Condition::L);
+                a.cmpImm(Reg::RAX, '\r');
+                a.patch(a.jcc(Condition::LE), skip);
+                here(notSpace);
+                a.cmpImm(Reg::RAX, -1);
+                size_t atEnd = a.jcc(Condition::E);
+                callTo(m_ungetc);
+                here(atEnd);
+                a.ret();
+
+                auto sign = [&](Reg a_flag, size_t& a_digitLoop, size_t& a_firstDigit)
+                {
+                    callTo(m_getc);
+                    a.cmpImm(Reg::RAX, '-');
+                    size_t plus = a.jcc(Condition::NE);
+                    a.movImm(a_flag, 1);
+                    a_digitLoop = a.jmp();
+                    here(plus);
+                    a.cmpImm(Reg::RAX, '+');
+                    a_firstDigit = a.jcc(Condition::NE);
+                };
+
+                auto notDigit = [&](std::vector<size_t>& a_exits)
+                {
+                    a.cmpImm(Reg::RAX, '0');
+                    a_exits.push_back(a.jcc(Condition::L));
+                    a.cmpImm(Reg::RAX, '9');
+                    a_exits.push_back(a.jcc(Condition::G));
+                    a.subImm(Reg::RAX, '0');
+                };
+
+                auto pushBack = [&]()
+                {
+                    a.cmpImm(Reg::RAX, -1);
+                    size_t atEnd = a.jcc(Condition::E);
+                    callTo(m_ungetc);
+                    here(atEnd);
+                };
+
+                // As with a failed std::cin, a read that does not parse or is out of range
+                // leaves the default value in this read and every later one.
+                auto failed = [&]()
+                {
+                    a.cmpByte(Reg::RBX, s_inputFailed, 0);
+                    return a.jcc(Condition::NE);
+                };
+
+                auto fail = [&]()
+                {
+                    a.storeByte(Reg::RBX, s_inputFailed, 1);
+                };
+
+                m_readInt = a.size();
+                {
+                    size_t skip = failed();
+                    callTo(m_skipSpace);
+                    a.xor64(Reg::R8, Reg::R8);
+                    a.xor64(Reg::R9, Reg::R9);
+                    a.xor64(Reg::R10, Reg::R10);
+                    size_t toLoop{}, toCheck{};
+                    sign(Reg::R9, toLoop, toCheck);
+                    size_t loop = a.size();
+                    here(toLoop);
+                    callTo(m_getc);
+                    here(toCheck);
+                    std::vector<size_t> stop{};
+                    notDigit(stop);
+                    a.movImm(Reg::R10, 1);
+                    a.imulImm(Reg::R8, Reg::R8, 10);
+                    a.add64(Reg::R8, Reg::RAX);
+                    a.movImm(Reg::RCX, 2147483648ull);
+                    a.cmp64(Reg::R8, Reg::RCX);
+                    a.patch(a.jcc(Condition::BE), loop);
+                    a.mov(Reg::R8, Reg::RCX);
+                    fail();
+                    a.patch(a.jmp(), loop);
+                    for (size_t fixup : stop)
+                    {
+                        here(fixup);
+                    }
+                    pushBack();
+                    a.test64(Reg::R10, Reg::R10);
+                    size_t parsed = a.jcc(Condition::NE);
+                    fail();
+                    here(skip);
+                    a.xor64(Reg::RAX, Reg::RAX);
+                    a.ret();
+                    here(parsed);
+                    a.test64(Reg::R9, Reg::R9);
+                    size_t positive = a.jcc(Condition::E);
+                    a.neg64(Reg::R8);
+                    a.mov(Reg::RAX, Reg::R8);
+                    a.ret();
+                    here(positive);
+                    a.movImm(Reg::RCX, 2147483647ull);
+                    a.cmp64(Reg::R8, Reg::RCX);
+                    size_t inRange = a.jcc(Condition::BE);
+                    a.mov(Reg::R8, Reg::RCX);
+                    fail();
+                    here(inRange);
+                    a.mov(Reg::RAX, Reg::R8);
+                    a.ret();
+                }
+
+                m_readReal = a.size();
+                {
+                    static constexpr uint64_t s_mantissaLimit = 100000000000000000ull;
+
+                    size_t skip = failed();
+                    a.push(Reg::RBP);
+                    a.push(Reg::R14);
+                    a.push(Reg::R15);
+                    callTo(m_skipSpace);
+                    a.xor64(Reg::R8, Reg::R8);
+                    a.xor64(Reg::R9, Reg::R9);
+                    a.xor64(Reg::R10, Reg::R10);
+                    a.xor64(Reg::R15, Reg::R15);
+
+                    size_t toLoop{}, toCheck{};
+                    sign(Reg::R9, toLoop, toCheck);
+                    size_t integral = a.size();
+                    here(toLoop);
+                    callTo(m_getc);
+                    here(toCheck);
+                    std::vector<size_t> integralStop{};
+                    notDigit(integralStop);
+                    a.movImm(Reg::R15, 1);
+                    a.movImm(Reg::RCX, s_mantissaLimit);
+                    a.cmp64(Reg::R8, Reg::RCX);
+                    size_t dropIntegral = a.jcc(Condition::AE);
+                    a.imulImm(Reg::R8, Reg::R8, 10);
+                    a.add64(Reg::R8, Reg::RAX);
+                    a.patch(a.jmp(), integral);
+                    here(dropIntegral);
+                    a.addImm(Reg::R10, 1);
+                    a.patch(a.jmp(), integral);
+
+                    for (size_t fixup : integralStop)
+                    {
+                        here(fixup);
+                    }
+                    a.cmpImm(Reg::RAX, '.');
+                    size_t noPoint = a.jcc(Condition::NE);
+                    size_t fraction = a.size();
+                    callTo(m_getc);
+                    std::vector<size_t> fractionStop{};
+                    notDigit(fractionStop);
+                    a.movImm(Reg::R15, 1);
+                    a.movImm(Reg::RCX, s_mantissaLimit);
+                    a.cmp64(Reg::R8, Reg::RCX);
+                    a.patch(a.jcc(Condition::AE), fraction);
+                    a.imulImm(Reg::R8, Reg::R8, 10);
+                    a.add64(Reg::R8, Reg::RAX);
+                    a.subImm(Reg::R10, 1);
+                    a.patch(a.jmp(), fraction);
+
+                    here(noPoint);
+                    for (size_t fixup : fractionStop)
+                    {
+                        here(fixup);
+                    }
+                    a.test64(Reg::R15, Reg::R15);
+                    size_t noMantissa = a.jcc(Condition::E);
+                    a.cmpImm(Reg::RAX, 'e');
+                    size_t exponentLower = a.jcc(Condition::E);
+                    a.cmpImm(Reg::RAX, 'E');
+                    size_t exponentUpper = a.jcc(Condition::E);
+                    pushBack();
+                    size_t noExponent = a.jmp();
+
+                    here(exponentLower);
+                    here(exponentUpper);
+                    a.xor64(Reg::RBP, Reg::RBP);
+                    a.xor64(Reg::R14, Reg::R14);
+                    a.xor64(Reg::R15, Reg::R15);
+                    size_t toExponentLoop{}, toExponentCheck{};
+                    sign(Reg::R14, toExponentLoop, toExponentCheck);
+                    size_t exponent = a.size();
+                    here(toExponentLoop);
+                    callTo(m_getc);
+                    here(toExponentCheck);
+                    std::vector<size_t> exponentStop{};
+                    notDigit(exponentStop);
+                    a.movImm(Reg::R15, 1);
+                    a.cmpImm(Reg::RBP, 10000);
+                    a.patch(a.jcc(Condition::AE), exponent);
+                    a.imulImm(Reg::RBP, Reg::RBP, 10);
+                    a.add64(Reg::RBP, Reg::RAX);
+                    a.patch(a.jmp(), exponent);
+                    for (size_t fixup : exponentStop)
+                    {
+                        here(fixup);
+                    }
+                    pushBack();
+                    a.test64(Reg::R15, Reg::R15);
+                    size_t noExponentDigits = a.jcc(Condition::E);
+                    a.test64(Reg::R14, Reg::R14);
+                    size_t positiveExponent = a.jcc(Condition::E);
+                    a.neg64(Reg::RBP);
+                    here(positiveExponent);
+                    a.add64(Reg::R10, Reg::RBP);
+
+                    here(noExponent);
+                    a.cvtsi2sd64(Xmm::XMM0, Reg::R8);
+                    a.test64(Reg::R8, Reg::R8);
+                    size_t zero = a.jcc(Condition::E);
+
+                    // Scales by 1e300 first where 10^-exponent alone would overflow, so that
+                    // denormals do not flush to zero.
+                    a.cmpImm(Reg::R10, -300);
+                    size_t normal = a.jcc(Condition::GE);
+                    a.movImm(Reg::RAX, bits(1e300));
+                    a.movqToXmm(Xmm::XMM1, Reg::RAX);
+                    a.divsd(Xmm::XMM0, Xmm::XMM1);
+                    a.addImm(Reg::R10, 300);
+                    here(normal);
+
+                    a.movImm(Reg::RAX, bits(1.0));
+                    a.movqToXmm(Xmm::XMM1, Reg::RAX);
+                    a.movImm(Reg::RAX, bits(10.0));
+                    a.movqToXmm(Xmm::XMM2, Reg::RAX);
+                    a.mov(Reg::RCX, Reg::R10);
+                    a.test64(Reg::RCX, Reg::RCX);
+                    size_t power = a.jcc(Condition::NS);
+                    a.neg64(Reg::RCX);
+                    here(power);
+                    size_t powerLoop = a.size();
+                    a.test64(Reg::RCX, Reg::RCX);
+                    size_t powerDone = a.jcc(Condition::E);
+                    a.mulsd(Xmm::XMM1, Xmm::XMM2);
+                    a.subImm(Reg::RCX, 1);
+                    a.patch(a.jmp(), powerLoop);
+                    here(powerDone);
+                    a.test64(Reg::R10, Reg::R10);
+                    size_t divide = a.jcc(Condition::S);
+                    a.mulsd(Xmm::XMM0, Xmm::XMM1);
+                    size_t scaled = a.jmp();
+                    here(divide);
+                    a.divsd(Xmm::XMM0, Xmm::XMM1);
+                    here(scaled);
+
+                    // An overflow reads as the largest finite value, with the sign applied below.
+                    a.movqFromXmm(Reg::RAX, Xmm::XMM0);
+                    a.movImm(Reg::RCX, bits(std::numeric_limits<double>::infinity()));
+                    a.cmp64(Reg::RAX, Reg::RCX);
+                    size_t finite = a.jcc(Condition::NE);
+                    fail();
+                    a.movImm(Reg::RAX, bits(std::numeric_limits<double>::max()));
+                    a.movqToXmm(Xmm::XMM0, Reg::RAX);
+                    here(finite);
+                    here(zero);
+
+                    a.test64(Reg::R9, Reg::R9);
+                    size_t unsignedResult = a.jcc(Condition::E);
+                    a.movqFromXmm(Reg::RAX, Xmm::XMM0);
+                    a.movImm(Reg::RCX, 0x8000000000000000ull);
+                    a.xor64(Reg::RAX, Reg::RCX);
+                    a.movqToXmm(Xmm::XMM0, Reg::RAX);
+                    here(unsignedResult);
+                    a.pop(Reg::R15);
+                    a.pop(Reg::R14);
+                    a.pop(Reg::RBP);
+                    a.ret();
+
+                    here(noMantissa);
+                    pushBack();
+                    here(noExponentDigits);
+                    fail();
+                    a.pop(Reg::R15);
+                    a.pop(Reg::R14);
+                    a.pop(Reg::RBP);
+                    here(skip);
+                    a.xor64(Reg::RAX, Reg::RAX);
+                    a.movqToXmm(Xmm::XMM0, Reg::RAX);
+                    a.ret();
+                }
+            }
+
+            void emitErrors(size_t a_outOfMemory, size_t a_unassigned, size_t a_divisionByZero)
+            {
+                X86Assembler& a = m_assembler;
+
+                auto fail = [&](size_t a_message, size_t a_length)
+                {
+                    callTo(m_flush);
+                    a.patch(a.leaRip(Reg::RSI), a_message);
+                    a.movImm(Reg::RDX, a_length);
+                    a.movImm(Reg::RAX, 1);
+                    a.movImm(Reg::RDI, 2);
+                    a.syscall();
+                    a.movImm(Reg::RDI, 1);
+                    a.movImm(Reg::RAX, 231);
+                    a.syscall();
+                };
+
+                m_outOfMemory = a.size();
+                fail(a_outOfMemory, std::strlen(s_outOfMemoryMessage));
+
+                m_unassigned = a.size();
+                fail(a_unassigned, std::strlen(s_unassignedMessage));
+
+                m_divisionByZero = a.size();
+                fail(a_divisionByZero, std::strlen(s_divisionByZeroMessage));
+            }
+
+            void emitStrings()
+            {
+                X86Assembler& a = m_assembler;
+
+                // Strings live in semispaces: when either arena runs out, the headers reachable
+                // from the operand stack and the string variables are copied to the spare halves.
+                // A copied header keeps a forwarding handle and a length of -1.
+                m_forward = a.size();
+                a.load32(Reg::RAX, Reg::R8, 0);
+                a.mov(Reg::R9, Reg::RAX);
+                a.load64(Reg::RCX, Reg::RBX, s_spareHeaders);
+                a.sub64(Reg::R9, Reg::RCX);
+                a.cmp64(Reg::R9, Reg::RBX, s_headerMaximum);
+                size_t outside = a.jcc(Condition::AE);
+                a.load64(Reg::RCX, Reg::RAX, 8);
+                a.cmpImm(Reg::RCX, -1);
+                size_t copy = a.jcc(Condition::NE);
+                a.load64(Reg::R9, Reg::RAX, 0);
+                size_t relink = a.jmp();
+                here(copy);
+                a.load64(Reg::RSI, Reg::RAX, 0);
+                a.load64(Reg::RDI, Reg::RBX, s_dataTop);
+                a.mov(Reg::R10, Reg::RDI);
+                a.mov(Reg::RDX, Reg::RDI);
+                a.add64(Reg::RDX, Reg::RCX);
+                a.cmp64(Reg::RDX, Reg::RBX, s_dataEnd);
+                a.patch(a.jcc(Condition::A), m_outOfMemory);
+                a.repMovsb();
+                a.store64(Reg::RBX, s_dataTop, Reg::RDI);
+                a.load64(Reg::R9, Reg::RBX, s_headerTop);
+                a.store64(Reg::R9, 0, Reg::R10);
+                a.sub64(Reg::RDI, Reg::R10);
+                a.store64(Reg::R9, 8, Reg::RDI);
+                a.lea(Reg::RCX, Reg::R9, 16);
+                a.store64(Reg::RBX, s_headerTop, Reg::RCX);
+                a.store64(Reg::RAX, 0, Reg::R9);
+                a.storeImm64(Reg::RAX, 8, -1);
+                here(relink);
+                a.store32(Reg::R8, 0, Reg::R9);
+                here(outside);
+                a.ret();
+
+                m_collect = a.size();
+                auto swap = [&](int32_t a_space, int32_t a_spare, int32_t a_top, int32_t a_end, int32_t a_size)
+                {
+                    a.load64(Reg::RAX, Reg::RBX, a_space);
+                    a.load64(Reg::RCX, Reg::RBX, a_spare);
+                    a.store64(Reg::RBX, a_space, Reg::RCX);
+                    a.store64(Reg::RBX, a_spare, Reg::RAX);
+                    a.store64(Reg::RBX, a_top, Reg::RCX);
+                    a.load64(Reg::RDX, Reg::RBX, a_size);
+                    a.add64(Reg::RCX, Reg::RDX);
+                    a.store64(Reg::RBX, a_end, Reg::RCX);
+                };
+                swap(s_headerSpace, s_spareHeaders, s_headerTop, s_headerEnd, s_headerExtent);
+                swap(s_dataSpace, s_spareData, s_dataTop, s_dataEnd, s_dataExtent);
+                a.lea(Reg::R11, Reg::RBX, static_cast<int32_t>(m_stackBase));
+                size_t scan = a.size();
+                a.cmp64(Reg::R11, JitCompiler::s_stack);
+                size_t scanned = a.jcc(Condition::AE);
+                a.load64(Reg::RAX, Reg::R11, 0);
+                a.shrImm(Reg::RAX, 48);
+                a.cmpImm(Reg::RAX, static_cast<int32_t>(Value::fromString(0).bits() >> 48));
+                size_t notString = a.jcc(Condition::NE);
+                a.mov(Reg::R8, Reg::R11);
+                callTo(m_forward);
+                here(notString);
+                a.addImm(Reg::R11, 8);
+                a.patch(a.jmp(), scan);
+                here(scanned);
+                for (int32_t slot = 0; slot < m_program.stringSlots(); ++slot)
+                {
+                    a.cmpByte(JitCompiler::s_variables, m_layout.m_stringFlagOffset + slot, 0);
+                    size_t unset = a.jcc(Condition::E);
+                    a.lea(Reg::R8, JitCompiler::s_variables, m_layout.m_stringOffset + 4 * slot);
+                    callTo(m_forward);
+                    here(unset);
+                }
+                auto release = [&](int32_t a_spare, int32_t a_size)
+                {
+                    a.load64(Reg::RDI, Reg::RBX, a_spare);
+                    a.load64(Reg::RSI, Reg::RBX, a_size);
+                    a.movImm(Reg::RDX, 4);
+                    a.movImm(Reg::RAX, 28);
+                    a.syscall();
+                };
+                release(s_spareHeaders, s_headerExtent);
+                release(s_spareData, s_dataExtent);
+                a.ret();
+
+                // Makes room for a header and rdi bytes of string data, collecting at most once.
+                m_reserve = a.size();
+                auto fits = [&]
+                {
+                    a.load64(Reg::RAX, Reg::RBX, s_headerTop);
+                    a.cmp64(Reg::RAX, Reg::RBX, s_headerEnd);
+                    size_t full = a.jcc(Condition::AE);
+                    a.load64(Reg::RAX, Reg::RBX, s_dataTop);
+                    a.add64(Reg::RAX, Reg::RDI);
+                    a.cmp64(Reg::RAX, Reg::RBX, s_dataEnd);
+                    size_t tight = a.jcc(Condition::A);
+                    a.ret();
+                    here(full);
+                    here(tight);
+                };
+                fits();
+                a.push(Reg::RDI);
+                callTo(m_collect);
+                a.pop(Reg::RDI);
+
+                // Doubles a limit, up to the reserve, while the live strings and the request
+                // would fill more than half of it.
+                auto grow = [&](int32_t a_space, int32_t a_top, int32_t a_end, int32_t a_size, int32_t a_maximum, Reg a_request)
+                {
+                    a.load64(Reg::RAX, Reg::RBX, a_top);
+                    a.load64(Reg::RCX, Reg::RBX, a_space);
+                    a.sub64(Reg::RAX, Reg::RCX);
+                    a.add64(Reg::RAX, a_request);
+                    a.add64(Reg::RAX, Reg::RAX);
+                    a.load64(Reg::RCX, Reg::RBX, a_size);
+                    size_t loop = a.size();
+                    a.cmp64(Reg::RAX, Reg::RCX);
+                    size_t enough = a.jcc(Condition::BE);
+                    a.cmp64(Reg::RCX, Reg::RBX, a_maximum);
+                    size_t largest = a.jcc(Condition::AE);
+                    a.add64(Reg::RCX, Reg::RCX);
+                    a.patch(a.jmp(), loop);
+                    here(enough);
+                    here(largest);
+                    a.cmp64(Reg::RCX, Reg::RBX, a_maximum);
+                    size_t within = a.jcc(Condition::BE);
+                    a.load64(Reg::RCX, Reg::RBX, a_maximum);
+                    here(within);
+                    a.store64(Reg::RBX, a_size, Reg::RCX);
+                    a.load64(Reg::RAX, Reg::RBX, a_space);
+                    a.add64(Reg::RAX, Reg::RCX);
+                    a.store64(Reg::RBX, a_end, Reg::RAX);
+                };
+                a.movImm(Reg::RSI, 16);
+                grow(s_headerSpace, s_headerTop, s_headerEnd, s_headerExtent, s_headerMaximum, Reg::RSI);
+                grow(s_dataSpace, s_dataTop, s_dataEnd, s_dataExtent, s_dataMaximum, Reg::RDI);
+                fits();
+                jumpTo(m_outOfMemory);
+
+                m_newHeader = a.size();
+                a.load64(Reg::RAX, Reg::RBX, s_headerTop);
+                a.cmp64(Reg::RAX, Reg::RBX, s_headerEnd);
+                a.patch(a.jcc(Condition::AE), m_outOfMemory);
+                a.store64(Reg::RAX, 0, Reg::RDI);
+                a.store64(Reg::RAX, 8, Reg::RSI);
+                a.lea(Reg::RCX, Reg::RAX, 16);
+                a.store64(Reg::RBX, s_headerTop, Reg::RCX);
+                a.ret();
+
+                m_readString = a.size();
+                a.movImm(Reg::RDI, s_bufferSize);
+                callTo(m_reserve);
+                a.load64(Reg::R8, Reg::RBX, s_dataTop);
+                a.mov(Reg::R9, Reg::R8);
+                a.cmpByte(Reg::RBX, s_inputFailed, 0);
+                size_t failed = a.jcc(Condition::NE);
+                callTo(m_skipSpace);
+                size_t next = a.size();
+                callTo(m_getc);
+                a.cmpImm(Reg::RAX, -1);
+                size_t atEnd = a.jcc(Condition::E);
+                a.cmpImm(Reg::RAX, ' ');
+                size_t space = a.jcc(Condition::E);
+                a.cmpImm(Reg::RAX, '\t');
+                size_t printable = a.jcc(Condition::L);
+                a.cmpImm(Reg::RAX, '\r');
+                size_t control = a.jcc(Condition::LE);
+                here(printable);
+                a.cmp64(Reg::R9, Reg::RBX, s_dataEnd);
+                a.patch(a.jcc(Condition::AE), m_outOfMemory);
+                a.storeByteReg(Reg::R9, 0, Reg::RAX);
+                a.addImm(Reg::R9, 1);
+                a.patch(a.jmp(), next);
+                here(space);
+                here(control);
+                callTo(m_ungetc);
+                here(atEnd);
+                a.cmp64(Reg::R9, Reg::R8);
+                size_t read = a.jcc(Condition::NE);
+                a.storeByte(Reg::RBX, s_inputFailed, 1);
+                here(read);
+                here(failed);
+                a.store64(Reg::RBX, s_dataTop, Reg::R9);
+                a.mov(Reg::RDI, Reg::R8);
+                a.mov(Reg::RSI, Reg::R9);
+                a.sub64(Reg::RSI, Reg::R8);
+                jumpTo(m_newHeader);
+
+                // Strings are immutable; a head that ends at the top of the arena is extended in place.
+                // The head is passed by the address of its handle, since a collection may move it.
+                m_concat = a.size();
+                a.push(Reg::R14);
+                a.push(Reg::RDI);
+                a.push(Reg::RSI);
+                a.push(Reg::RDX);
+                a.load32(Reg::RAX, Reg::RDI, 0);
+                a.load64(Reg::RDI, Reg::RAX, 8);
+                size_t measure = a.size();
+                a.test64(Reg::RDX, Reg::RDX);
+                size_t measured = a.jcc(Condition::E);
+                a.load32(Reg::RAX, Reg::RSI, 0);
+                a.load64(Reg::RCX, Reg::RAX, 8);
+                a.add64(Reg::RDI, Reg::RCX);
+                a.addImm(Reg::RSI, 8);
+                a.subImm(Reg::RDX, 1);
+                a.patch(a.jmp(), measure);
+                here(measured);
+                callTo(m_reserve);
+                a.pop(Reg::R9);
+                a.pop(Reg::R8);
+                a.pop(Reg::RDI);
+                a.load32(Reg::RDI, Reg::RDI, 0);
+                a.load64(Reg::RSI, Reg::RDI, 0);
+                a.load64(Reg::RCX, Reg::RDI, 8);
+                a.mov(Reg::RAX, Reg::RSI);
+                a.add64(Reg::RAX, Reg::RCX);
+                a.cmp64(Reg::RAX, Reg::RBX, s_dataTop);
+                size_t copyHead = a.jcc(Condition::NE);
+                a.mov(Reg::R10, Reg::RSI);
+                a.mov(Reg::R14, Reg::RAX);
+                size_t tail = a.jmp();
+                here(copyHead);
+                a.load64(Reg::R10, Reg::RBX, s_dataTop);
+                a.mov(Reg::RDI, Reg::R10);
+                a.repMovsb();
+                a.mov(Reg::R14, Reg::RDI);
+                here(tail);
+                size_t piece = a.size();
+                a.test64(Reg::R9, Reg::R9);
+                size_t finished = a.jcc(Condition::E);
+                a.load32(Reg::RAX, Reg::R8, 0);
+                a.load64(Reg::RSI, Reg::RAX, 0);
+                a.load64(Reg::RCX, Reg::RAX, 8);
+                a.mov(Reg::RDI, Reg::R14);
+                a.repMovsb();
+                a.mov(Reg::R14, Reg::RDI);
+                a.addImm(Reg::R8, 8);
+                a.subImm(Reg::R9, 1);
+                a.patch(a.jmp(), piece);
+                here(finished);
+                a.store64(Reg::RBX, s_dataTop, Reg::R14);
+                a.mov(Reg::RDI, Reg::R10);
+                a.mov(Reg::RSI, Reg::R14);
+                a.sub64(Reg::RSI, Reg::R10);
+                a.pop(Reg::R14);
+                jumpTo(m_newHeader);
+
+                m_compare = a.size();
+                a.load64(Reg::R8, Reg::RDI, 0);
+                a.load64(Reg::R9, Reg::RDI, 8);
+                a.load64(Reg::R10, Reg::RSI, 0);
+                a.load64(Reg::R11, Reg::RSI, 8);
+                a.mov(Reg::RCX, Reg::R9);
+                a.cmp64(Reg::RCX, Reg::R11);
+                size_t shorter = a.jcc(Condition::BE);
+                a.mov(Reg::RCX, Reg::R11);
+                here(shorter);
+                size_t compareLoop = a.size();
+                a.test64(Reg::RCX, Reg::RCX);
+                size_t prefix = a.jcc(Condition::E);
+                a.movzxByteLoad(Reg::RAX, Reg::R8, 0);
+                a.movzxByteLoad(Reg::RDX, Reg::R10, 0);
+                a.cmp64(Reg::RAX, Reg::RDX);
+                size_t less = a.jcc(Condition::B);
+                size_t greater = a.jcc(Condition::A);
+                a.addImm(Reg::R8, 1);
+                a.addImm(Reg::R10, 1);
+                a.subImm(Reg::RCX, 1);
+                a.patch(a.jmp(), compareLoop);
+                here(prefix);
+                a.cmp64(Reg::R9, Reg::R11);
+                size_t shorterLess = a.jcc(Condition::B);
+                size_t longerGreater = a.jcc(Condition::A);
+                a.xor64(Reg::RAX, Reg::RAX);
+                a.ret();
+                here(less);
+                here(shorterLess);
+                a.movImm(Reg::RAX, -1);
+                a.ret();
+                here(greater);
+                here(longerGreater);
+                a.movImm(Reg::RAX, 1);
+                a.ret();
+            }
+
+            bool translate(X86Assembler& a_assembler, const Instruction& a_instruction)
+            {
+                X86Assembler& a = a_assembler;
+
+                const Reg stack     = JitCompiler::s_stack;
+                const Reg variables = JitCompiler::s_variables;
+
+                int32_t  operand    = a_instruction.operand;
+                int32_t  stringSlot = m_layout.m_stringOffset + 4 * operand;
+                uint64_t stringTag  = Value::fromString(0).bits();
+
+                auto call = [&](size_t a_routine)
+                {
+                    a.patch(a.call(), a_routine);
+                };
+
+                auto assigned = [&](int32_t a_flagOffset, int32_t a_slot)
+                {
+                    a.storeByte(variables, a_flagOffset + a_slot, 1);
+                };
+
+                switch (a_instruction.opcode)
+                {
+                    case Opcode::PUSH_STRING:
+                        a.movImm(Reg::RAX, stringTag | constant(operand));
+                        a.store64(stack, 0, Reg::RAX);
+                        a.addImm(stack, 8);
+                        return true;
+
+                    case Opcode::LOAD_STRING:
+                        if (a_instruction.arity & Instruction::s_checked)
+                        {
+                            a.cmpByte(variables, m_layout.m_stringFlagOffset + operand, 0);
+                            a.patch(a.jcc(Condition::E), m_unassigned);
+                        }
+                        a.load32(Reg::RAX, variables, stringSlot);
+                        a.movImm(Reg::RCX, stringTag);
+                        a.or64(Reg::RAX, Reg::RCX);
+                        a.store64(stack, 0, Reg::RAX);
+                        a.addImm(stack, 8);
+                        return true;
+
+                    case Opcode::STORE_STRING:
+                    case Opcode::STORE_KEEP_STRING:
+                        if (a_instruction.opcode == Opcode::STORE_STRING)
+                        {
+                            a.subImm(stack, 8);
+                        }
+                        a.load32(Reg::RAX, stack, a_instruction.opcode == Opcode::STORE_STRING ? 0 : -8);
+                        a.store32(variables, stringSlot, Reg::RAX);
+                        assigned(m_layout.m_stringFlagOffset, operand);
+                        return true;
+
+                    case Opcode::POP:
+                        a.subImm(stack, 8);
+                        return true;
+
+                    case Opcode::READ_INT:
+                        call(m_readInt);
+                        a.store32(variables, m_layout.m_intOffset + 4 * operand, Reg::RAX);
+                        assigned(m_layout.m_intFlagOffset, operand);
+                        return true;
+
+                    case Opcode::READ_REAL:
+                        call(m_readReal);
+                        a.movsdStore(variables, m_layout.m_realOffset + 8 * operand, Xmm::XMM0);
+                        assigned(m_layout.m_realFlagOffset, operand);
+                        return true;
+
+                    case Opcode::READ_STRING:
+                        call(m_readString);
+                        a.store32(variables, stringSlot, Reg::RAX);
+                        assigned(m_layout.m_stringFlagOffset, operand);
+                        return true;
+
+                    case Opcode::APPEND_STRING:
+                        a.cmpByte(variables, m_layout.m_stringFlagOffset + operand, 0);
+                        a.patch(a.jcc(Condition::E), m_unassigned);
+                        a.lea(Reg::RDI, variables, stringSlot);
+                        a.lea(Reg::RSI, stack, -8 * a_instruction.arity);
+                        a.movImm(Reg::RDX, a_instruction.arity);
+                        call(m_concat);
+                        a.store32(variables, stringSlot, Reg::RAX);
+                        a.subImm(stack, 8 * a_instruction.arity);
+                        return true;
+
+                    case Opcode::CONCAT:
+                        a.lea(Reg::RDI, stack, -8 * operand);
+                        a.lea(Reg::RSI, stack, 8 - 8 * operand);
+                        a.movImm(Reg::RDX, operand - 1);
+                        call(m_concat);
+                        a.movImm(Reg::RCX, stringTag);
+                        a.or64(Reg::RAX, Reg::RCX);
+                        a.store64(stack, -8 * operand, Reg::RAX);
+                        a.subImm(stack, 8 * (operand - 1));
+                        return true;
+
+                    case Opcode::WRITE:
+                        a.subImm(stack, 8);
+                        a.load64(Reg::RDI, stack, 0);
+                        call(m_write);
+                        return true;
+
+                    case Opcode::EQ_STRING:
+                    case Opcode::NEQ_STRING:
+                    case Opcode::LESS_STRING:
+                    case Opcode::GREATER_STRING:
+                    case Opcode::LEQ_STRING:
+                    case Opcode::GEQ_STRING:
+                    {
+                        static const Condition s_conditions[] = {
+                            Condition::E, Condition::NE, Condition::L, Condition::G, Condition::LE, Condition::GE
+                        };
+
+                        a.subImm(stack, 8);
+                        a.load32(Reg::RSI, stack, 0);
+                        a.load32(Reg::RDI, stack, -8);
+                        call(m_compare);
+                        a.cmpImm(Reg::RAX, 0);
+                        a.setcc(s_conditions[static_cast<int>(a_instruction.opcode) - static_cast<int>(Opcode::EQ_STRING)], Reg::RAX);
+                        a.movzxByte(Reg::RAX, Reg::RAX);
+                        a.or64(Reg::RAX, JitCompiler::s_intTag);
+                        a.store64(stack, -8, Reg::RAX);
+                        return true;
+                    }
+
+                    default:
+                        return false;
+                }
+            }
+
+            static constexpr const char* s_outOfMemoryMessage    = "out of memory\n";
+            static constexpr const char* s_unassignedMessage     = "variable is not assigned\n";
+            static constexpr const char* s_divisionByZeroMessage = "division by zero\n";
+
+            template<typename T>
+            static void put(std::vector<uint8_t>& a_out, size_t& a_cursor, T a_value)
+            {
+                std::memcpy(a_out.data() + a_cursor, &a_value, sizeof(T));
+                a_cursor += sizeof(T);
+            }
+
+            static void segment(std::vector<uint8_t>& a_out, size_t& a_cursor, uint32_t a_type, uint32_t a_flags, uint64_t a_vaddr,
+                uint64_t a_fileSize, uint64_t a_memorySize)
+            {
+                put<uint32_t>(a_out, a_cursor, a_type);
+                put<uint32_t>(a_out, a_cursor, a_flags);
+                put<uint64_t>(a_out, a_cursor, 0);
+                put<uint64_t>(a_out, a_cursor, a_vaddr);
+                put<uint64_t>(a_out, a_cursor, a_vaddr);
+                put<uint64_t>(a_out, a_cursor, a_fileSize);
+                put<uint64_t>(a_out, a_cursor, a_memorySize);
+                put<uint64_t>(a_out, a_cursor, a_type == 1 ? s_pageSize : 16);
+            }
+
+        public:
+
+            ElfEmitter(const Program& a_program)
+                : m_program(a_program)
+            {
+            }
+
+            std::vector<uint8_t> emit()
+            {
+                layout();
+
+                constants();
+                size_t outOfMemory = message(s_outOfMemoryMessage);
+                size_t unassigned  = message(s_unassignedMessage);
+                size_t division    = message(s_divisionByZeroMessage);
+                pad();
+
+                emitOutput();
+                emitInput();
+                emitErrors(outOfMemory, unassigned, division);
+                emitStrings();
+                pad();
+
+                // Data segment addresses depend on the final text size, so the start stub
+                // is emitted with placeholders and patched after the program is compiled.
+                X86Assembler& a = m_assembler;
+
+                size_t start = a.size();
+                size_t dataBase = a.size();
+                a.movImm(Reg::RBX, 0);
+                // Reserves both halves of an arena without committing memory, halving the
+                // reserve while the kernel refuses it.
+                auto arena = [&](uint64_t a_reserve, int32_t a_limit, uint64_t a_flags, int32_t a_space, int32_t a_spare,
+                                 int32_t a_top, int32_t a_end, int32_t a_size, int32_t a_maximum)
+                {
+                    static constexpr uint64_t s_privateAnonymous = 0x22;
+                    static constexpr uint64_t s_noReserve        = 0x4000;
+
+                    a.movImm(Reg::R14, a_reserve);
+                    size_t retry = a.size();
+                    a.xor64(Reg::RDI, Reg::RDI);
+                    a.mov(Reg::RSI, Reg::R14);
+                    a.add64(Reg::RSI, Reg::R14);
+                    a.movImm(Reg::RDX, 3);
+                    a.movImm(Reg::R10, s_privateAnonymous | s_noReserve | a_flags);
+                    a.movImm(Reg::R8, -1);
+                    a.xor64(Reg::R9, Reg::R9);
+                    a.movImm(Reg::RAX, 9);
+                    a.syscall();
+                    a.cmpImm(Reg::RAX, -4096);
+                    size_t mapped = a.jcc(Condition::B);
+                    a.shrImm(Reg::R14, 1);
+                    a.cmpImm(Reg::R14, a_limit);
+                    a.patch(a.jcc(Condition::AE), retry);
+                    jumpTo(m_outOfMemory);
+                    here(mapped);
+                    a.store64(Reg::RBX, a_space, Reg::RAX);
+                    a.store64(Reg::RBX, a_top, Reg::RAX);
+                    a.store64(Reg::RBX, a_maximum, Reg::R14);
+                    a.movImm(Reg::RCX, a_limit);
+                    a.store64(Reg::RBX, a_size, Reg::RCX);
+                    a.add64(Reg::RCX, Reg::RAX);
+                    a.store64(Reg::RBX, a_end, Reg::RCX);
+                    a.add64(Reg::RAX, Reg::R14);
+                    a.store64(Reg::RBX, a_spare, Reg::RAX);
+                };
+                arena(s_headerReserve, s_headerLimit, 0x40, s_headerSpace, s_spareHeaders, s_headerTop, s_headerEnd, s_headerExtent, s_headerMaximum);
+                arena(s_dataReserve, s_dataLimit, 0, s_dataSpace, s_spareData, s_dataTop, s_dataEnd, s_dataExtent, s_dataMaximum);
+                a.mov(Reg::RDI, Reg::RBX);
+                a.lea(Reg::RSI, Reg::RBX, static_cast<int32_t>(m_stackBase));
+                a.lea(Reg::RDX, Reg::RBX, static_cast<int32_t>(m_variablesBase));
+                size_t firstInstruction = a.leaRip(Reg::RCX);
+                size_t program = a.call();
+                a.cmpImm(Reg::RAX, JitCompiler::s_divisionByZero);
+                a.patch(a.jcc(Condition::E), m_divisionByZero);
+                a.test64(Reg::RAX, Reg::RAX);
+                a.patch(a.jcc(Condition::NE), m_unassigned);
+                a.xor64(Reg::RDI, Reg::RDI);
+                jumpTo(m_exit);
+                pad();
+
+                JitCompiler compiler{m_program, m_layout, std::move(m_assembler),
+                    [this](X86Assembler& a_assembler, const Instruction& a_instruction)
+                    {
+                        return translate(a_assembler, a_instruction);
+                    }};
+
+                if (!compiler.compile())
+                {
+                    throw std::runtime_error("[ElfEmitter]: " + compiler.reason());
+                }
+
+                std::vector<uint8_t> code = compiler.code();
+
+                auto relative = [&](size_t a_fixup, size_t a_target)
+                {
+                    int32_t displacement = static_cast<int32_t>(a_target - (a_fixup + 4));
+                    std::memcpy(&code[a_fixup], &displacement, sizeof(displacement));
+                };
+
+                relative(firstInstruction, compiler.offsets()[0]);
+                relative(program, compiler.entry());
+
+                uint64_t textSize = s_codeOffset + code.size();
+                m_dataBase = align(s_textBase + textSize, s_pageSize);
+
+                std::memcpy(&code[dataBase + 2], &m_dataBase, sizeof(m_dataBase));
+
+                static constexpr uint8_t identification[16]{0x7F, 'E', 'L', 'F', 2, 1, 1};
+
+                std::vector<uint8_t> image(s_codeOffset + code.size(), 0);
+                std::memcpy(image.data(), identification, sizeof(identification));
+                std::memcpy(image.data() + s_codeOffset, code.data(), code.size());
+
+                size_t cursor = sizeof(identification);
+                put<uint16_t>(image, cursor, 2);
+                put<uint16_t>(image, cursor, 62);
+                put<uint32_t>(image, cursor, 1);
+                put<uint64_t>(image, cursor, address(start));
+                put<uint64_t>(image, cursor, 64);
+                put<uint64_t>(image, cursor, 0);
+                put<uint32_t>(image, cursor, 0);
+                put<uint16_t>(image, cursor, 64);
+                put<uint16_t>(image, cursor, 56);
+                put<uint16_t>(image, cursor, 3);
+                put<uint16_t>(image, cursor, 64);
+                put<uint16_t>(image, cursor, 0);
+                put<uint16_t>(image, cursor, 0);
+
+                segment(image, cursor, 1, 5, s_textBase, textSize, textSize);
+                segment(image, cursor, 1, 6, m_dataBase, 0, m_dataSize);
+                segment(image, cursor, 0x6474E551, 6, 0, 0, 0);
+
+                return image;
+            }
+
+            void write(const std::string& a_path)
+            {
+                std::vector<uint8_t> image = emit();
+
+                std::ofstream out{a_path, std::ios::binary | std::ios::trunc};
+                out.write(reinterpret_cast<const char*>(image.data()), image.size());
+                if (!out)
+                {
+                    throw std::runtime_error("[ElfEmitter]: cannot write " + a_path);
+                }
+                out.close();
+
+                namespace fs = std::filesystem;
+                fs::permissions(a_path, fs::perms::owner_exec | fs::perms::group_exec | fs::perms::others_exec,
+                    fs::perm_options::add);
+            }
+    };
+}
+
+#endif // ELF_EMITTER_HPP
@@ -3,20 +3,28 @@
 
 #include "Token.hpp"
 #include "Parser.hpp"
+#include "InputBuffer.hpp"
+#include "OutputBuffer.hpp"
+#include <cstdint>
 #include <vector>
 #include <stack>
 #include <map>
+#include <stdexcept>
+
+#undef NULL
 
 namespace mli {
 
+    using OperandStack = std::stack<Token, std::vector<Token>>;
+
     class WriteOperation;
 
     class Operation
     {
         public:
-            virtual Token perform(std::stack<Token>& a_operands) = 0;
+            virtual Token perform(OperandStack& a_operands) = 0;
 
-            Token popOperand(std::stack<Token>& a_operands)
+            Token popOperand(OperandStack& a_operands)
             {
                 Token operand = a_operands.top();
                 a_operands.pop();
@@ -55,6 +63,11 @@ namespace mli {
                 }
             }
 
+            static int wrap(int64_t a_value)
+            {
+                return static_cast<int32_t>(static_cast<uint32_t>(a_value));
+            }
+
             double numericToDouble(Token a_token)
             {
                 if (a_token.getType() == Token::Type::REAL_CONST)
@@ -71,7 +84,7 @@ namespace mli {
     class WriteOperation : public Operation
     {
         public:
-            virtual Token perform(std::stack<Token>& a_operands) override
+            virtual Token perform(OperandStack& a_operands) override
             {
                 Token operand = popOperand(a_operands);
                 idTokenToValueToken(operand);
@@ -79,15 +92,15 @@ namespace mli {
 
                 if (operandType == Token::Type::STRING_CONST)
                 {
-                    std::cout << State::s_strings[operand.getValue()] << "\n";
+                    OutputBuffer::standard().write(State::s_strings[operand.getValue()]);
                 }
                 else if (operandType == Token::Type::INT_CONST)
                 {
-                    std::cout << operand.getValue() << "\n";
+                    OutputBuffer::standard().write(operand.getValue());
                 }
                 else if (operandType == Token::Type::REAL_CONST)
                 {
-                    std::cout << State::s_realNumbers[operand.getValue()] << "\n";
+                    OutputBuffer::standard().write(State::s_realNumbers[operand.getValue()]);
                 }
                 else
                 {
@@ -101,7 +114,7 @@ namespace mli {
     class ReadOperation : public Operation
     {
         public:
-            virtual Token perform(std::stack<Token>& a_operands) override
+            virtual Token perform(OperandStack& a_operands) override
             {
                 Token operand = popOperand(a_operands);
 
@@ -111,23 +124,17 @@ namespace mli {
 
                 if (variableType == Token::Type::STRING)
                 {
-                    std::string stringConst{};
-                    std::cin >> stringConst;
                     variable.setValue(State::s_strings.size());
-                    State::s_strings.push_back(stringConst);
+                    State::s_strings.push_back(InputBuffer::standard().readString());
                 }
                 else if (variableType == Token::Type::REAL)
                 {
-                    double doubleConst{};
-                    std::cin >> doubleConst;
                     variable.setValue(State::s_realNumbers.size());
-                    State::s_realNumbers.push_back(doubleConst);
+                    State::s_realNumbers.push_back(InputBuffer::standard().readReal());
                 }
                 else if (variableType == Token::Type::INT)
                 {
-                    int intConst{};
-                    std::cin >> intConst;
-                    variable.setValue(intConst);
+                    variable.setValue(InputBuffer::standard().readInt());
                 }
                 else
                 {
@@ -141,7 +148,7 @@ namespace mli {
     class AssignOperation : public Operation
     {
         public:
-            virtual Token perform(std::stack<Token>& a_operands) override
+            virtual Token perform(OperandStack& a_operands) override
             {
                 Token srcToken = popOperand(a_operands);
                 idTokenToValueToken(srcToken);
@@ -192,7 +199,7 @@ namespace mli {
     class FalseGoOperation : public Operation
     {
         public:
-            virtual Token perform(std::stack<Token>& a_operands) override
+            virtual Token perform(OperandStack& a_operands) override
             {
                 Token label = popOperand(a_operands);
                 Token expression = popOperand(a_operands);
@@ -214,7 +221,7 @@ namespace mli {
     class TrueGoOperation : public Operation
     {
         public:
-            virtual Token perform(std::stack<Token>& a_operands) override
+            virtual Token perform(OperandStack& a_operands) override
             {
                 Token label = popOperand(a_operands);
                 Token expression = popOperand(a_operands);
@@ -236,7 +243,7 @@ namespace mli {
     class FalseLazyOperation : public Operation
     {
         public:
-            virtual Token perform(std::stack<Token>& a_operands) override
+            virtual Token perform(OperandStack& a_operands) override
             {
                 Token label = popOperand(a_operands);
                 Token expression = a_operands.top();
@@ -258,7 +265,7 @@ namespace mli {
     class TrueLazyOperation : public Operation
     {
         public:
-            virtual Token perform(std::stack<Token>& a_operands) override
+            virtual Token perform(OperandStack& a_operands) override
             {
                 Token label = popOperand(a_operands);
                 Token expression = a_operands.top();
@@ -280,7 +287,7 @@ namespace mli {
     class GoOperation : public Operation
     {
         public:
-            virtual Token perform(std::stack<Token>& a_operands) override
+            virtual Token perform(OperandStack& a_operands) override
             {
                 Token label = popOperand(a_operands);
                 label.setType(Token::Type::POLIZ_GO);
@@ -292,7 +299,7 @@ namespace mli {
     class PopOperation : public Operation
     {
         public:
-            virtual Token perform(std::stack<Token>& a_operands) override
+            virtual Token perform(OperandStack& a_operands) override
             {
                 popOperand(a_operands);
 
@@ -303,7 +310,7 @@ namespace mli {
     class SubtractOperation : public Operation
     {
         public:
-            virtual Token perform(std::stack<Token>& a_operands) override
+            virtual Token perform(OperandStack& a_operands) override
             {
                 Token token1 = popOperand(a_operands);
                 idTokenToValueToken(token1);
@@ -314,7 +321,7 @@ namespace mli {
                 if (token1.getType() == Token::Type::INT_CONST && token2.getType() == Token::Type::INT_CONST)
                 {
                     result.setType(Token::Type::INT_CONST);
-                    result.setValue(token2.getValue() - token1.getValue());
+                    result.setValue(wrap(int64_t(token2.getValue()) - token1.getValue()));
                 }
                 else
                 {
@@ -332,7 +339,7 @@ namespace mli {
     class PlusOperation : public Operation
     {
         public:
-            virtual Token perform(std::stack<Token>& a_operands) override
+            virtual Token perform(OperandStack& a_operands) override
             {
                 Token token1 = popOperand(a_operands);
                 idTokenToValueToken(token1);
@@ -343,7 +350,7 @@ namespace mli {
                 if (token1.getType() == Token::Type::INT_CONST && token2.getType() == Token::Type::INT_CONST)
                 {
                     result.setType(Token::Type::INT_CONST);
-                    result.setValue(token2.getValue() + token1.getValue());
+                    result.setValue(wrap(int64_t(token2.getValue()) + token1.getValue()));
                 }
                 else if (token1.getType() == Token::Type::STRING_CONST && token2.getType() == Token::Type::STRING_CONST)
                 {
@@ -369,7 +376,7 @@ namespace mli {
     class MultiplyOperation : public Operation
     {
         public:
-            virtual Token perform(std::stack<Token>& a_operands) override
+            virtual Token perform(OperandStack& a_operands) override
             {
                 Token token1 = popOperand(a_operands);
                 idTokenToValueToken(token1);
@@ -380,7 +387,7 @@ namespace mli {
                 if (token1.getType() == Token::Type::INT_CONST && token2.getType() == Token::Type::INT_CONST)
                 {
                     result.setType(Token::Type::INT_CONST);
-                    result.setValue(token2.getValue() * token1.getValue());
+                    result.setValue(wrap(int64_t(token2.getValue()) * token1.getValue()));
                 }
                 else
                 {
@@ -398,7 +405,7 @@ namespace mli {
     class DivideOperation : public Operation
     {
         public:
-            virtual Token perform(std::stack<Token>& a_operands) override
+            virtual Token perform(OperandStack& a_operands) override
             {
                 Token token1 = popOperand(a_operands);
                 idTokenToValueToken(token1);
@@ -408,8 +415,12 @@ namespace mli {
 
                 if (token1.getType() == Token::Type::INT_CONST && token2.getType() == Token::Type::INT_CONST)
                 {
+                    if (token1.getValue() == 0)
+                    {
+                        throw std::runtime_error("division by zero");
+                    }
                     result.setType(Token::Type::INT_CONST);
-                    result.setValue(token2.getValue() / token1.getValue());
+                    result.setValue(wrap(int64_t(token2.getValue()) / token1.getValue()));
                 }
                 else
                 {
@@ -427,7 +438,7 @@ namespace mli {
     class UnaryPlusOperation : public Operation
     {
         public:
-            virtual Token perform(std::stack<Token>& a_operands) override
+            virtual Token perform(OperandStack& a_operands) override
             {
                 Token token = popOperand(a_operands);
                 idTokenToValueToken(token);
@@ -439,14 +450,14 @@ namespace mli {
     class UnaryMinusOperation : public Operation
     {
         public:
-            virtual Token perform(std::stack<Token>& a_operands) override
+            virtual Token perform(OperandStack& a_operands) override
             {
                 Token token = popOperand(a_operands);
                 idTokenToValueToken(token);
 
                 if (token.getType() == Token::Type::INT_CONST)
                 {
-                    token.setValue(-token.getValue());
+                    token.setValue(wrap(-int64_t(token.getValue())));
                 }
                 else
                 {
@@ -575,7 +586,12 @@ namespace mli {
                 return this->m_numericValue && other.getNumeric();
             }
 
-            virtual Token perform(std::stack<Token>& a_operands) override
+            int operator!()
+            {
+                return !this->m_numericValue;
+            }
+
+            virtual Token perform(OperandStack& a_operands) override
             {
                 assert(false && "unaviable option");
             }
@@ -584,7 +600,7 @@ namespace mli {
     class EqualOperation : public Operation
     {
         public:
-            virtual Token perform(std::stack<Token>& a_operands) override
+            virtual Token perform(OperandStack& a_operands) override
             {
                 Token token1 = popOperand(a_operands);
                 Token token2 = popOperand(a_operands);
@@ -599,7 +615,7 @@ namespace mli {
     class LessOperation : public Operation
     {
         public:
-            virtual Token perform(std::stack<Token>& a_operands) override
+            virtual Token perform(OperandStack& a_operands) override
             {
                 Token token1 = popOperand(a_operands);
                 Token token2 = popOperand(a_operands);
@@ -614,7 +630,7 @@ namespace mli {
     class GreaterOperation : public Operation
     {
         public:
-            virtual Token perform(std::stack<Token>& a_operands) override
+            virtual Token perform(OperandStack& a_operands) override
             {
                 Token token1 = popOperand(a_operands);
                 Token token2 = popOperand(a_operands);
@@ -629,7 +645,7 @@ namespace mli {
     class NotEqualOperation : public Operation
     {
         public:
-            virtual Token perform(std::stack<Token>& a_operands) override
+            virtual Token perform(OperandStack& a_operands) override
             {
                 Token token1 = popOperand(a_operands);
                 Token token2 = popOperand(a_operands);
@@ -644,7 +660,7 @@ namespace mli {
     class GreaterEqualOperation : public Operation
     {
         public:
-            virtual Token perform(std::stack<Token>& a_operands) override
+            virtual Token perform(OperandStack& a_operands) override
             {
                 Token token1 = popOperand(a_operands);
                 Token token2 = popOperand(a_operands);
@@ -659,7 +675,7 @@ namespace mli {
     class LessEqualOperation : public Operation
     {
         public:
-            virtual Token perform(std::stack<Token>& a_operands) override
+            virtual Token perform(OperandStack& a_operands) override
             {
                 Token token1 = popOperand(a_operands);
                 Token token2 = popOperand(a_operands);
@@ -674,7 +690,7 @@ namespace mli {
     class AndOperation : public Operation
     {
         public:
-            virtual Token perform(std::stack<Token>& a_operands) override
+            virtual Token perform(OperandStack& a_operands) override
             {
                 Token token1 = popOperand(a_operands);
                 Token token2 = popOperand(a_operands);
@@ -689,7 +705,7 @@ namespace mli {
     class OrOperation : public Operation
     {
         public:
-            virtual Token perform(std::stack<Token>& a_operands) override
+            virtual Token perform(OperandStack& a_operands) override
             {
                 Token token1 = popOperand(a_operands);
                 Token token2 = popOperand(a_operands);
@@ -701,6 +717,20 @@ namespace mli {
             }
     };
 
+    class NotOperation : public Operation
+    {
+        public:
+            virtual Token perform(OperandStack& a_operands) override
+            {
+                Token token = popOperand(a_operands);
+                Token result{token};
+                result.setType(Token::Type::INT_CONST);
+                result.setValue(!OperandWrapper(token));
+
+                return result;
+            }
+    };
+
     class Executer
     {
         private:
@@ -729,6 +759,7 @@ namespace mli {
             GreaterEqualOperation greaterEqualOperation;
             OrOperation           orOperation;
             AndOperation          andOperation;
+            NotOperation          notOperation;
 
             std::map<Token::Type, Operation*> operations
             {
@@ -754,14 +785,18 @@ namespace mli {
                     { Token::Type::LEQ,              &lessEqualOperation },
                     { Token::Type::GEQ,              &greaterEqualOperation },
                     { Token::Type::OR,               &orOperation },
-                    { Token::Type::AND,              &andOperation }
+                    { Token::Type::AND,              &andOperation },
+                    { Token::Type::NOT,              &notOperation }
             };
 
         public:
 
             void executePoliz(std::vector<Token>& a_poliz)
             {
-                std::stack<Token> operands;
+                // Reserve roughly one slot per POLIZ entry to avoid regrowth.
+                std::vector<Token> storage{};
+                storage.reserve(a_poliz.size());
+                OperandStack operands{std::move(storage)};
 
                 int polizIndex = 0;
                 const int polizSize = a_poliz.size();
@@ -793,6 +828,8 @@ namespace mli {
 
                     ++polizIndex;
                 }
+
+                OutputBuffer::standard().flush();
             }
 
     };
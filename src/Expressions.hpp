@@ -0,0 +1,219 @@
+#ifndef EXPRESSIONS_HPP
+#define EXPRESSIONS_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "Bytecode.hpp"
+#include "ControlFlow.hpp"
+#include "Ssa.hpp"
+#include "Value.hpp"
+
+namespace mli {
+
+    // A value on the operand stack and the contiguous instructions that compute it.
+    struct Expression
+    {
+        int32_t              begin{};
+        int32_t              end{};
+        int32_t              number{};
+        Token::Type          type{Token::Type::NULL};
+        bool                 replaceable{};
+        bool                 removable{};
+        std::vector<int32_t> loads;
+    };
+
+    // Rebuilds the expression trees of basic blocks from the stack code and numbers them:
+    // two expressions get the same number when they compute the same SSA values the same way.
+    class ExpressionTrees
+    {
+        private:
+            const ControlFlowGraph&                 m_cfg;
+            const SsaForm&                          m_ssa;
+            const std::vector<int32_t>&             m_depths;
+            std::map<std::vector<int64_t>, int32_t> m_numbers;
+
+            static bool isCommutative(Opcode a_opcode)
+            {
+                switch (a_opcode)
+                {
+                    case Opcode::ADD_INT:
+                    case Opcode::MUL_INT:
+                    case Opcode::ADD_REAL:
+                    case Opcode::MUL_REAL:
+                    case Opcode::EQ_INT:
+                    case Opcode::NEQ_INT:
+                    case Opcode::EQ_REAL:
+                    case Opcode::NEQ_REAL:
+                    case Opcode::EQ_STRING:
+                    case Opcode::NEQ_STRING:
+                    case Opcode::AND:
+                    case Opcode::OR:
+                        return true;
+                    default:
+                        return false;
+                }
+            }
+
+            static Token::Type resultType(Opcode a_opcode)
+            {
+                switch (a_opcode)
+                {
+                    case Opcode::PUSH_REAL:
+                    case Opcode::LOAD_REAL:
+                    case Opcode::TO_REAL:
+                    case Opcode::ADD_REAL:
+                    case Opcode::SUB_REAL:
+                    case Opcode::MUL_REAL:
+                    case Opcode::DIV_REAL:
+                    case Opcode::NEG_REAL:
+                        return Token::Type::REAL;
+                    case Opcode::PUSH_STRING:
+                    case Opcode::LOAD_STRING:
+                    case Opcode::CONCAT:
+                        return Token::Type::STRING;
+                    default:
+                        return Token::Type::INT;
+                }
+            }
+
+            int32_t number(std::vector<int64_t> a_key)
+            {
+                auto [found, inserted] = m_numbers.emplace(std::move(a_key), m_numbers.size());
+                return found->second;
+            }
+
+            int32_t opaque()
+            {
+                return number({-1, static_cast<int64_t>(m_numbers.size())});
+            }
+
+        public:
+
+            ExpressionTrees(const ControlFlowGraph& a_cfg, const SsaForm& a_ssa, const std::vector<int32_t>& a_depths)
+                : m_cfg(a_cfg), m_ssa(a_ssa), m_depths(a_depths)
+            {
+            }
+
+            // Returns every expression of the block; a_visit sees each instruction with the
+            // expressions it consumes, in stack order, before they are combined.
+            template<typename Visit>
+            std::vector<Expression> build(int32_t a_block, Visit a_visit)
+            {
+                const Program& program = m_cfg.program();
+                const std::vector<Instruction>& code = program.code();
+                const BasicBlock& block = m_cfg.block(a_block);
+
+                std::vector<Expression> created{};
+                std::vector<Expression> stack{};
+
+                for (int32_t depth = 0; depth < m_depths[block.begin]; ++depth)
+                {
+                    stack.push_back(Expression{block.begin, block.begin, opaque(), Token::Type::NULL, false, false, {}});
+                }
+
+                for (int32_t i = block.begin; i < block.end; ++i)
+                {
+                    const Instruction& instruction = code[i];
+                    Opcode opcode = instruction.opcode;
+
+                    int32_t consumed = Verifier::pops(instruction);
+                    std::vector<Expression> operands(stack.end() - consumed, stack.end());
+                    a_visit(i, operands);
+
+                    auto combine = [&](std::vector<int64_t> a_key, bool a_canFail)
+                    {
+                        Expression result{i, i + 1, 0, resultType(opcode), true, !a_canFail, {}};
+                        for (size_t k = 0; k < operands.size(); ++k)
+                        {
+                            const Expression& operand = operands[k];
+                            int32_t following = (k + 1 < operands.size()) ? operands[k + 1].begin : i;
+
+                            result.begin        = std::min(result.begin, operand.begin);
+                            result.replaceable &= operand.replaceable && operand.end == following;
+                            result.removable   &= operand.removable;
+                            result.loads.insert(result.loads.end(), operand.loads.begin(), operand.loads.end());
+                            a_key.push_back(operand.number);
+                        }
+
+                        if (isCommutative(opcode) && a_key[a_key.size() - 2] > a_key.back())
+                        {
+                            std::swap(a_key[a_key.size() - 2], a_key.back());
+                        }
+
+                        result.number    = number(std::move(a_key));
+                        result.removable = result.removable && result.replaceable;
+                        stack.resize(stack.size() - consumed);
+                        stack.push_back(result);
+                        created.push_back(result);
+                    };
+
+                    switch (opcode)
+                    {
+                        case Opcode::PUSH_INT:
+                        case Opcode::PUSH_STRING:
+                        case Opcode::CONCAT:
+                            combine({static_cast<int64_t>(opcode), instruction.operand}, false);
+                            break;
+                        case Opcode::PUSH_REAL:
+                            combine({static_cast<int64_t>(opcode), static_cast<int64_t>(Value::fromReal(program.reals()[instruction.operand]).bits())}, false);
+                            break;
+                        case Opcode::LOAD_INT:
+                        case Opcode::LOAD_REAL:
+                        case Opcode::LOAD_STRING:
+                            combine({static_cast<int64_t>(Opcode::LOAD_INT), m_ssa.use(i)}, m_ssa.maybeUnassigned(m_ssa.use(i)));
+                            stack.back().loads.push_back(m_ssa.use(i));
+                            created.back().loads.push_back(m_ssa.use(i));
+                            break;
+                        case Opcode::STORE_KEEP_INT:
+                        case Opcode::STORE_KEEP_REAL:
+                        case Opcode::STORE_KEEP_STRING:
+                            stack.back().end         = i + 1;
+                            stack.back().replaceable = false;
+                            stack.back().removable   = false;
+                            break;
+                        case Opcode::TO_REAL_SECOND:
+                        {
+                            Expression& second = stack[stack.size() - 2];
+                            second.number      = number({static_cast<int64_t>(Opcode::TO_REAL), second.number});
+                            second.type        = Token::Type::REAL;
+                            second.replaceable = false;
+                            second.removable   = false;
+                            break;
+                        }
+                        case Opcode::TO_INT:
+                        case Opcode::TO_REAL:
+                        case Opcode::NEG_INT:
+                        case Opcode::NEG_REAL:
+                        case Opcode::NOT:
+                            combine({static_cast<int64_t>(opcode)}, false);
+                            break;
+                        case Opcode::JUMP_FALSE_LAZY:
+                        case Opcode::JUMP_TRUE_LAZY:
+                            break;
+                        default:
+                            if (Verifier::pushes(instruction) == 1 && consumed == 2)
+                            {
+                                combine({static_cast<int64_t>(opcode)}, opcode == Opcode::DIV_INT);
+                            }
+                            else
+                            {
+                                stack.resize(stack.size() - consumed);
+                            }
+                            break;
+                    }
+                }
+
+                return created;
+            }
+
+            std::vector<Expression> build(int32_t a_block)
+            {
+                return build(a_block, [](int32_t, const std::vector<Expression>&) {});
+            }
+    };
+}
+
+#endif // EXPRESSIONS_HPP
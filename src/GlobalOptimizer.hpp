@@ -0,0 +1,596 @@
+#ifndef GLOBAL_OPTIMIZER_HPP
+#define GLOBAL_OPTIMIZER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Bytecode.hpp"
+#include "ControlFlow.hpp"
+#include "Expressions.hpp"
+#include "Optimizer.hpp"
+#include "Ssa.hpp"
+#include "Value.hpp"
+
+namespace mli {
+
+    class GlobalOptimizer
+    {
+        private:
+            struct Lattice
+            {
+                enum class State : uint8_t { TOP, CONSTANT, BOTTOM };
+
+                State state{State::TOP};
+                Value value{};
+
+                static Lattice constant(Value a_value)
+                {
+                    return Lattice{State::CONSTANT, a_value};
+                }
+
+                static Lattice bottom()
+                {
+                    return Lattice{State::BOTTOM, {}};
+                }
+
+                bool operator==(const Lattice& a_other) const
+                {
+                    return state == a_other.state && (state != State::CONSTANT || value.bits() == a_other.value.bits());
+                }
+
+                Lattice meet(const Lattice& a_other) const
+                {
+                    if (state == State::TOP || *this == a_other)
+                    {
+                        return a_other;
+                    }
+                    return (a_other.state == State::TOP) ? *this : bottom();
+                }
+            };
+
+            struct Occurrence
+            {
+                int32_t     end{};
+                Token::Type type{Token::Type::NULL};
+                int32_t     slot{-1};
+            };
+
+            Program m_program;
+            size_t  m_constants{};
+            size_t  m_redundant{};
+            size_t  m_deadStores{};
+            int32_t m_temporaries{};
+
+            Lattice evaluate(Opcode a_opcode, const Lattice& a_left, const Lattice& a_right) const
+            {
+                if (a_left.state == Lattice::State::BOTTOM || a_right.state == Lattice::State::BOTTOM)
+                {
+                    return Lattice::bottom();
+                }
+                if (a_left.state == Lattice::State::TOP || a_right.state == Lattice::State::TOP)
+                {
+                    return Lattice{};
+                }
+
+                int32_t result{};
+                if (a_left.value.isInt() && a_right.value.isInt())
+                {
+                    return Optimizer::evaluate(a_opcode, a_left.value.asInt(), a_right.value.asInt(), result)
+                        ? Lattice::constant(Value::fromInt(result)) : Lattice::bottom();
+                }
+
+                double left  = a_left.value.asReal();
+                double right = a_right.value.asReal();
+                switch (a_opcode)
+                {
+                    case Opcode::ADD_REAL: return Lattice::constant(Value::fromReal(left + right));
+                    case Opcode::SUB_REAL: return Lattice::constant(Value::fromReal(left - right));
+                    case Opcode::MUL_REAL: return Lattice::constant(Value::fromReal(left * right));
+                    case Opcode::DIV_REAL: return Lattice::constant(Value::fromReal(left / right));
+                    default:
+                        return Optimizer::compare(a_opcode, Opcode::EQ_REAL, left, right, result)
+                            ? Lattice::constant(Value::fromInt(result)) : Lattice::bottom();
+                }
+            }
+
+            Lattice evaluate(Opcode a_opcode, const Lattice& a_operand) const
+            {
+                if (a_operand.state != Lattice::State::CONSTANT)
+                {
+                    return a_operand;
+                }
+
+                Value value = a_operand.value;
+                switch (a_opcode)
+                {
+                    case Opcode::NEG_INT:  return Lattice::constant(Value::fromInt(static_cast<int32_t>(0u - static_cast<uint32_t>(value.asInt()))));
+                    case Opcode::NOT:      return Lattice::constant(Value::fromInt(!value.asInt()));
+                    case Opcode::TO_REAL:  return Lattice::constant(Value::fromReal(value.asInt()));
+                    case Opcode::NEG_REAL: return Lattice::constant(Value::fromReal(-value.asReal()));
+                    case Opcode::TO_INT:
+                        if (value.asReal() > std::numeric_limits<int32_t>::min() - 1.0 && value.asReal() < std::numeric_limits<int32_t>::max() + 1.0)
+                        {
+                            return Lattice::constant(Value::fromInt(static_cast<int32_t>(value.asReal())));
+                        }
+                        return Lattice::bottom();
+                    default:
+                        return Lattice::bottom();
+                }
+            }
+
+            // Wegman and Zadeck's sparse conditional constant propagation, re-evaluating whole blocks
+            // when one of the SSA values they read drops in the lattice.
+            bool propagateConstants()
+            {
+                ControlFlowGraph cfg{m_program};
+                SsaForm ssa{cfg};
+                Verifier verifier{m_program};
+                verifier.verify();
+
+                const std::vector<Instruction>& code = m_program.code();
+                const std::vector<SsaValue>& values  = ssa.values();
+
+                std::vector<Lattice> lattice(values.size());
+                std::vector<std::vector<int32_t>> readers(values.size());
+                for (size_t value = 0; value < values.size(); ++value)
+                {
+                    if (values[value].kind == SsaValue::Kind::ENTRY)
+                    {
+                        lattice[value] = Lattice::bottom();
+                    }
+                    else if (values[value].kind == SsaValue::Kind::PHI)
+                    {
+                        for (int32_t operand : values[value].operands)
+                        {
+                            if (operand != -1)
+                            {
+                                readers[operand].push_back(values[value].site);
+                            }
+                        }
+                    }
+                }
+                for (size_t i = 0; i < code.size(); ++i)
+                {
+                    if (ssa.use(i) != -1)
+                    {
+                        readers[ssa.use(i)].push_back(cfg.blockOf(i));
+                    }
+                }
+
+                std::vector<bool> executable(cfg.blocks().size());
+                std::vector<std::vector<bool>> edges(cfg.blocks().size());
+                for (size_t block = 0; block < cfg.blocks().size(); ++block)
+                {
+                    edges[block].assign(cfg.block(block).predecessors.size(), false);
+                }
+
+                std::vector<int32_t> worklist{0};
+                executable[0] = true;
+
+                std::vector<Lattice> loads(code.size());
+                std::vector<Lattice> conditions(code.size());
+
+                auto update = [&](int32_t a_value, const Lattice& a_lattice)
+                {
+                    if (lattice[a_value] == a_lattice)
+                    {
+                        return;
+                    }
+
+                    lattice[a_value] = a_lattice;
+                    for (int32_t reader : readers[a_value])
+                    {
+                        if (executable[reader])
+                        {
+                            worklist.push_back(reader);
+                        }
+                    }
+                };
+
+                auto follow = [&](int32_t a_from, int32_t a_to)
+                {
+                    const std::vector<int32_t>& predecessors = cfg.block(a_to).predecessors;
+                    for (size_t k = 0; k < predecessors.size(); ++k)
+                    {
+                        if (predecessors[k] == a_from && !edges[a_to][k])
+                        {
+                            edges[a_to][k]   = true;
+                            executable[a_to] = true;
+                            worklist.push_back(a_to);
+                        }
+                    }
+                };
+
+                while (!worklist.empty())
+                {
+                    int32_t index = worklist.back();
+                    worklist.pop_back();
+                    const BasicBlock& block = cfg.block(index);
+
+                    for (int32_t phi : ssa.phis(index))
+                    {
+                        Lattice merged{};
+                        for (size_t k = 0; k < values[phi].operands.size(); ++k)
+                        {
+                            if (edges[index][k] && values[phi].operands[k] != -1)
+                            {
+                                merged = merged.meet(lattice[values[phi].operands[k]]);
+                            }
+                        }
+                        update(phi, merged);
+                    }
+
+                    std::vector<Lattice> stack(verifier.depths()[block.begin], Lattice::bottom());
+                    auto pop = [&]()
+                    {
+                        Lattice top = stack.back();
+                        stack.pop_back();
+                        return top;
+                    };
+
+                    for (int32_t i = block.begin; i < block.end; ++i)
+                    {
+                        const Instruction& instruction = code[i];
+                        Opcode opcode = instruction.opcode;
+
+                        switch (opcode)
+                        {
+                            case Opcode::PUSH_INT:
+                                stack.push_back(Lattice::constant(Value::fromInt(instruction.operand)));
+                                break;
+                            case Opcode::PUSH_REAL:
+                                stack.push_back(Lattice::constant(Value::fromReal(m_program.reals()[instruction.operand])));
+                                break;
+                            case Opcode::PUSH_STRING:
+                            case Opcode::LOAD_STRING:
+                            case Opcode::CONCAT:
+                                stack.resize(stack.size() - (opcode == Opcode::CONCAT ? instruction.operand : 0));
+                                stack.push_back(Lattice::bottom());
+                                break;
+                            case Opcode::LOAD_INT:
+                            case Opcode::LOAD_REAL:
+                                loads[i] = lattice[ssa.use(i)];
+                                stack.push_back(loads[i]);
+                                break;
+                            case Opcode::STORE_INT:
+                            case Opcode::STORE_REAL:
+                            case Opcode::STORE_STRING:
+                                update(ssa.def(i), pop());
+                                break;
+                            case Opcode::STORE_KEEP_INT:
+                            case Opcode::STORE_KEEP_REAL:
+                            case Opcode::STORE_KEEP_STRING:
+                                update(ssa.def(i), stack.back());
+                                break;
+                            case Opcode::READ_INT:
+                            case Opcode::READ_REAL:
+                            case Opcode::READ_STRING:
+                                update(ssa.def(i), Lattice::bottom());
+                                break;
+                            case Opcode::APPEND_STRING:
+                                stack.resize(stack.size() - instruction.arity);
+                                update(ssa.def(i), Lattice::bottom());
+                                break;
+                            case Opcode::WRITE:
+                            case Opcode::POP:
+                                pop();
+                                break;
+                            case Opcode::TO_REAL_SECOND:
+                                stack[stack.size() - 2] = evaluate(Opcode::TO_REAL, stack[stack.size() - 2]);
+                                break;
+                            case Opcode::TO_INT:
+                            case Opcode::TO_REAL:
+                            case Opcode::NEG_INT:
+                            case Opcode::NEG_REAL:
+                            case Opcode::NOT:
+                                stack.back() = evaluate(opcode, stack.back());
+                                break;
+                            case Opcode::JUMP:
+                                follow(index, cfg.blockOf(instruction.operand));
+                                break;
+                            case Opcode::JUMP_FALSE:
+                            case Opcode::JUMP_TRUE:
+                            case Opcode::JUMP_FALSE_LAZY:
+                            case Opcode::JUMP_TRUE_LAZY:
+                            {
+                                bool lazy = (opcode == Opcode::JUMP_FALSE_LAZY || opcode == Opcode::JUMP_TRUE_LAZY);
+                                Lattice condition = lazy ? stack.back() : pop();
+                                conditions[i] = condition;
+
+                                if (condition.state == Lattice::State::TOP)
+                                {
+                                    break;
+                                }
+
+                                bool onTrue = (opcode == Opcode::JUMP_TRUE || opcode == Opcode::JUMP_TRUE_LAZY);
+                                bool known  = (condition.state == Lattice::State::CONSTANT);
+                                bool value  = known && condition.value.asInt() != 0;
+
+                                if (!known || value == onTrue)
+                                {
+                                    follow(index, cfg.blockOf(instruction.operand));
+                                }
+                                if (!known || value != onTrue)
+                                {
+                                    follow(index, cfg.blockOf(i + 1));
+                                }
+                                break;
+                            }
+                            case Opcode::HALT:
+                                break;
+                            default:
+                                if (isComparison(opcode) && opcode >= Opcode::EQ_STRING)
+                                {
+                                    stack.resize(stack.size() - 2);
+                                    stack.push_back(Lattice::bottom());
+                                }
+                                else
+                                {
+                                    Lattice right = pop();
+                                    stack.back() = evaluate(opcode, stack.back(), right);
+                                }
+                                break;
+                        }
+                    }
+
+                    const Instruction& last = code[block.end - 1];
+                    if (!isJump(last.opcode) && last.opcode != Opcode::HALT && block.end < static_cast<int32_t>(code.size()))
+                    {
+                        follow(index, cfg.blockOf(block.end));
+                    }
+                }
+
+                Rewrite rewrite{m_program};
+                for (int32_t index : cfg.reversePostorder())
+                {
+                    const BasicBlock& block = cfg.block(index);
+                    if (!executable[index])
+                    {
+                        continue;
+                    }
+
+                    for (int32_t i = block.begin; i < block.end; ++i)
+                    {
+                        const Instruction& instruction = code[i];
+                        Opcode opcode = instruction.opcode;
+
+                        if ((opcode == Opcode::LOAD_INT || opcode == Opcode::LOAD_REAL)
+                            && loads[i].state == Lattice::State::CONSTANT && !ssa.maybeUnassigned(ssa.use(i)))
+                        {
+                            Value value = loads[i].value;
+                            rewrite.replace(i, {value.isInt()
+                                ? Instruction{Opcode::PUSH_INT, 0, value.asInt()}
+                                : Instruction{Opcode::PUSH_REAL, 0, m_program.internReal(value.asReal())}});
+                            ++m_constants;
+                        }
+                        else if (isJump(opcode) && opcode != Opcode::JUMP && conditions[i].state == Lattice::State::CONSTANT)
+                        {
+                            bool lazy   = (opcode == Opcode::JUMP_FALSE_LAZY || opcode == Opcode::JUMP_TRUE_LAZY);
+                            bool onTrue = (opcode == Opcode::JUMP_TRUE || opcode == Opcode::JUMP_TRUE_LAZY);
+                            bool taken  = (conditions[i].value.asInt() != 0) == onTrue;
+
+                            std::vector<Instruction> replacement{};
+                            if (!lazy)
+                            {
+                                replacement.push_back(Instruction{Opcode::POP, 0, 0});
+                            }
+                            if (taken)
+                            {
+                                replacement.push_back(Instruction{Opcode::JUMP, 0, instruction.operand});
+                            }
+                            rewrite.replace(i, replacement);
+                            ++m_constants;
+                        }
+                    }
+                }
+
+                rewrite.apply(m_program);
+                return rewrite.changed();
+            }
+
+            // Dominator-based value numbering: an expression computed again in a block its first
+            // occurrence dominates is replaced by a load of a temporary stored at that occurrence.
+            bool numberValues()
+            {
+                ControlFlowGraph cfg{m_program};
+                SsaForm ssa{cfg};
+                Verifier verifier{m_program};
+                verifier.verify();
+                ExpressionTrees trees{cfg, ssa, verifier.depths()};
+
+                std::vector<std::vector<Expression>> created(cfg.blocks().size());
+                for (int32_t block : cfg.reversePostorder())
+                {
+                    created[block] = trees.build(block);
+                }
+
+                Rewrite rewrite{m_program};
+                std::vector<Occurrence> occurrences{};
+                std::map<int32_t, int32_t> available{};
+
+                auto visit = [&](auto& a_self, int32_t a_block) -> void
+                {
+                    std::vector<Expression>& nodes = created[a_block];
+                    std::sort(nodes.begin(), nodes.end(), [](const Expression& a_left, const Expression& a_right)
+                    {
+                        return a_left.begin != a_right.begin ? a_left.begin < a_right.begin : a_left.end > a_right.end;
+                    });
+
+                    std::vector<std::pair<int32_t, int32_t>> shadowed{};
+                    int32_t replacedEnd = -1;
+
+                    for (const Expression& node : nodes)
+                    {
+                        if (!node.replaceable || node.end - node.begin < 3 || node.begin < replacedEnd)
+                        {
+                            continue;
+                        }
+
+                        auto found = available.find(node.number);
+                        if (found != available.end() && occurrences[found->second].end <= node.begin)
+                        {
+                            Occurrence& occurrence = occurrences[found->second];
+                            if (occurrence.slot == -1)
+                            {
+                                occurrence.slot = m_program.declare("gvn" + std::to_string(m_temporaries++), occurrence.type).slot;
+                                rewrite.insertAfter(occurrence.end - 1,
+                                    Instruction{typedOpcode(Opcode::STORE_KEEP_INT, occurrence.type), 0, occurrence.slot});
+                            }
+
+                            rewrite.replace(node.begin, {Instruction{typedOpcode(Opcode::LOAD_INT, occurrence.type), 0, occurrence.slot}});
+                            for (int32_t i = node.begin + 1; i < node.end; ++i)
+                            {
+                                rewrite.remove(i);
+                            }
+                            replacedEnd = node.end;
+                            ++m_redundant;
+                        }
+                        else if (found == available.end())
+                        {
+                            available[node.number] = occurrences.size();
+                            occurrences.push_back(Occurrence{node.end, node.type, -1});
+                            shadowed.push_back({node.number, -1});
+                        }
+                    }
+
+                    for (int32_t child : cfg.block(a_block).children)
+                    {
+                        a_self(a_self, child);
+                    }
+
+                    for (auto& [number, previous] : shadowed)
+                    {
+                        available.erase(number);
+                    }
+                };
+                visit(visit, 0);
+
+                rewrite.apply(m_program);
+                return rewrite.changed();
+            }
+
+            // Stores whose SSA value nobody reads are dropped; the stored expression goes too when
+            // evaluating it can neither fail nor have effects.
+            bool eliminateDeadStores()
+            {
+                ControlFlowGraph cfg{m_program};
+                SsaForm ssa{cfg};
+                Verifier verifier{m_program};
+                verifier.verify();
+                ExpressionTrees trees{cfg, ssa, verifier.depths()};
+
+                const std::vector<Instruction>& code = m_program.code();
+                const std::vector<SsaValue>& values  = ssa.values();
+
+                std::vector<bool> live(values.size());
+                std::vector<int32_t> worklist{};
+                for (size_t i = 0; i < code.size(); ++i)
+                {
+                    if (ssa.use(i) != -1 && !live[ssa.use(i)])
+                    {
+                        live[ssa.use(i)] = true;
+                        worklist.push_back(ssa.use(i));
+                    }
+                }
+                while (!worklist.empty())
+                {
+                    int32_t value = worklist.back();
+                    worklist.pop_back();
+
+                    for (int32_t operand : values[value].operands)
+                    {
+                        if (operand != -1 && !live[operand])
+                        {
+                            live[operand] = true;
+                            worklist.push_back(operand);
+                        }
+                    }
+                }
+
+                Rewrite rewrite{m_program};
+                for (int32_t block : cfg.reversePostorder())
+                {
+                    trees.build(block, [&](int32_t a_index, const std::vector<Expression>& a_operands)
+                    {
+                        Opcode opcode = code[a_index].opcode;
+                        if (ssa.def(a_index) == -1 || live[ssa.def(a_index)])
+                        {
+                            return;
+                        }
+
+                        if (opcode == Opcode::STORE_KEEP_INT || opcode == Opcode::STORE_KEEP_REAL || opcode == Opcode::STORE_KEEP_STRING)
+                        {
+                            rewrite.remove(a_index);
+                            ++m_deadStores;
+                        }
+                        else if (opcode == Opcode::STORE_INT || opcode == Opcode::STORE_REAL || opcode == Opcode::STORE_STRING)
+                        {
+                            const Expression& stored = a_operands.back();
+                            if (stored.removable && !rewrite.replaced(stored.begin))
+                            {
+                                for (int32_t i = stored.begin; i <= a_index; ++i)
+                                {
+                                    rewrite.remove(i);
+                                }
+                            }
+                            else
+                            {
+                                rewrite.replace(a_index, {Instruction{Opcode::POP, 0, 0}});
+                            }
+                            ++m_deadStores;
+                        }
+                    });
+                }
+
+                rewrite.apply(m_program);
+                return rewrite.changed();
+            }
+
+        public:
+
+            GlobalOptimizer(const Program& a_program)
+                : m_program(a_program)
+            {
+            }
+
+            Program optimize()
+            {
+                for (int round = 0; round < 4; ++round)
+                {
+                    bool changed = propagateConstants();
+                    changed |= numberValues();
+                    changed |= eliminateDeadStores();
+
+                    m_program = Optimizer(m_program).optimize();
+                    if (!changed)
+                    {
+                        break;
+                    }
+                }
+
+                m_program.setMaxDepth(Verifier(m_program).verify());
+                return m_program;
+            }
+
+            size_t constants() const
+            {
+                return m_constants;
+            }
+
+            size_t redundant() const
+            {
+                return m_redundant;
+            }
+
+            size_t deadStores() const
+            {
+                return m_deadStores;
+            }
+    };
+}
+
+#endif // GLOBAL_OPTIMIZER_HPP
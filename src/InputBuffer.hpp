@@ -0,0 +1,262 @@
+#ifndef INPUT_BUFFER_HPP
+#define INPUT_BUFFER_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "OutputBuffer.hpp"
+
+namespace mli {
+
+    // The input of `read`: stdin is mapped when it is a regular file and read in large blocks
+    // otherwise, and values are parsed with std::from_chars. Accepts and rejects exactly what
+    // std::cin >> does in the C locale: a value that does not parse reads as 0 (or "") and so
+    // does every later one. Output is flushed before blocking on stdin, as cin's tie to cout did.
+    class InputBuffer
+    {
+        public:
+            static constexpr size_t s_blockSize = 1 << 16;
+
+        private:
+            std::vector<char> m_block;
+            const char*       m_next{};
+            const char*       m_end{};
+            void*             m_mapping{};
+            size_t            m_mappingSize{};
+            bool              m_eof{};
+            bool              m_failed{};
+
+            void map()
+            {
+                struct stat info{};
+                off_t offset = lseek(STDIN_FILENO, 0, SEEK_CUR);
+                if (fstat(STDIN_FILENO, &info) != 0 || !S_ISREG(info.st_mode) || offset < 0 || info.st_size <= offset)
+                {
+                    return;
+                }
+
+                void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, STDIN_FILENO, 0);
+                if (mapping == MAP_FAILED)
+                {
+                    return;
+                }
+
+                madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+                m_mapping     = mapping;
+                m_mappingSize = info.st_size;
+                m_next        = static_cast<const char*>(mapping) + offset;
+                m_end         = static_cast<const char*>(mapping) + info.st_size;
+            }
+
+            // Keeps the token at m_next and reads the next block behind it.
+            bool extend()
+            {
+                if (m_mapping || m_eof)
+                {
+                    return false;
+                }
+
+                OutputBuffer::standard().flush();
+
+                size_t kept = m_end - m_next;
+                if (kept && m_next != m_block.data())
+                {
+                    std::memmove(m_block.data(), m_next, kept);
+                }
+                if (m_block.size() < kept + s_blockSize)
+                {
+                    m_block.resize(kept + s_blockSize);
+                }
+
+                ssize_t count{};
+                do
+                {
+                    count = ::read(STDIN_FILENO, m_block.data() + kept, s_blockSize);
+                }
+                while (count < 0 && errno == EINTR);
+
+                m_next = m_block.data();
+                m_end  = m_block.data() + kept + std::max<ssize_t>(count, 0);
+                m_eof  = (count <= 0);
+                return !m_eof;
+            }
+
+            // The character a_offset bytes into the current token, or -1 at the end of the input.
+            int at(size_t a_offset)
+            {
+                while (m_next + a_offset >= m_end)
+                {
+                    if (!extend())
+                    {
+                        return -1;
+                    }
+                }
+                return static_cast<unsigned char>(m_next[a_offset]);
+            }
+
+            static bool isSpace(int a_char)
+            {
+                return a_char == ' ' || (a_char >= '\t' && a_char <= '\r');
+            }
+
+            static bool isDigit(int a_char)
+            {
+                return a_char >= '0' && a_char <= '9';
+            }
+
+            static bool isSign(int a_char)
+            {
+                return a_char == '+' || a_char == '-';
+            }
+
+            size_t digits(size_t a_offset)
+            {
+                while (isDigit(at(a_offset)))
+                {
+                    ++a_offset;
+                }
+                return a_offset;
+            }
+
+            void skipSpace()
+            {
+                while (isSpace(at(0)))
+                {
+                    ++m_next;
+                }
+            }
+
+            // Consumes a number of a_length bytes; from_chars takes no leading '+'.
+            std::pair<const char*, const char*> take(size_t a_length)
+            {
+                const char* begin = m_next + (a_length && *m_next == '+');
+                m_next += a_length;
+                return {begin, m_next};
+            }
+
+        public:
+
+            InputBuffer()
+            {
+                map();
+            }
+
+            InputBuffer(const InputBuffer&) = delete;
+            InputBuffer& operator=(const InputBuffer&) = delete;
+
+            ~InputBuffer()
+            {
+                if (m_mapping)
+                {
+                    munmap(m_mapping, m_mappingSize);
+                }
+            }
+
+            static InputBuffer& standard()
+            {
+                static InputBuffer s_input{};
+                return s_input;
+            }
+
+            int32_t readInt()
+            {
+                if (m_failed)
+                {
+                    return 0;
+                }
+
+                skipSpace();
+                auto [begin, end] = take(digits(isSign(at(0))));
+
+                int32_t value{};
+                auto [last, error] = std::from_chars(begin, end, value);
+                if (error == std::errc::result_out_of_range)
+                {
+                    m_failed = true;
+                    return (*begin == '-') ? std::numeric_limits<int32_t>::min() : std::numeric_limits<int32_t>::max();
+                }
+                if (error != std::errc{})
+                {
+                    m_failed = true;
+                    return 0;
+                }
+                return value;
+            }
+
+            double readReal()
+            {
+                if (m_failed)
+                {
+                    return 0.0;
+                }
+
+                skipSpace();
+                size_t sign   = isSign(at(0));
+                size_t length = digits(sign);
+                if (at(length) == '.')
+                {
+                    length = digits(length + 1);
+                }
+                if (length > sign + (at(sign) == '.') && (at(length) == 'e' || at(length) == 'E'))
+                {
+                    length = digits(length + 1 + isSign(at(length + 1)));
+                }
+                auto [begin, end] = take(length);
+
+                // The whole token has to be a number; out of range values go through strtod,
+                // which tells overflow (a failure) from underflow (a denormal or zero).
+                double value{};
+                auto [last, error] = std::from_chars(begin, end, value);
+                if (error == std::errc::result_out_of_range)
+                {
+                    value = std::strtod(std::string(begin, end).c_str(), nullptr);
+                    if (value == std::numeric_limits<double>::infinity() || value == -std::numeric_limits<double>::infinity())
+                    {
+                        m_failed = true;
+                        return (value > 0) ? std::numeric_limits<double>::max() : -std::numeric_limits<double>::max();
+                    }
+                    return value;
+                }
+                if (error != std::errc{} || last != end)
+                {
+                    m_failed = true;
+                    return 0.0;
+                }
+                return value;
+            }
+
+            std::string readString()
+            {
+                if (m_failed)
+                {
+                    return {};
+                }
+
+                skipSpace();
+                size_t length = 0;
+                while (at(length) != -1 && !isSpace(at(length)))
+                {
+                    ++length;
+                }
+
+                m_failed = (length == 0);
+                m_next += length;
+                return std::string(m_next - length, m_next);
+            }
+    };
+}
+
+#endif // INPUT_BUFFER_HPP
@@ -0,0 +1,1071 @@
+#ifndef JIT_HPP
+#define JIT_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Bytecode.hpp"
+#include "InputBuffer.hpp"
+#include "OutputBuffer.hpp"
+#include "StringHeap.hpp"
+#include "Value.hpp"
+#include "VirtualMachine.hpp"
+#include "X86Assembler.hpp"
+
+#if defined(__x86_64__) && defined(__linux__)
+#define MLI_JIT_AVAILABLE
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace mli {
+
+    class JitRuntime
+    {
+        private:
+            StringHeap            m_heap;
+            std::vector<uint32_t> m_constants;
+            std::vector<uint64_t> m_block;
+            std::exception_ptr    m_error;
+
+            int32_t m_intOffset{};
+            int32_t m_realOffset{};
+            int32_t m_stringOffset{};
+            int32_t m_intFlagOffset{};
+            int32_t m_realFlagOffset{};
+            int32_t m_stringFlagOffset{};
+
+            uint8_t* block()
+            {
+                return reinterpret_cast<uint8_t*>(m_block.data());
+            }
+
+            int32_t& intAt(int64_t a_slot)
+            {
+                return *reinterpret_cast<int32_t*>(block() + m_intOffset + 4 * a_slot);
+            }
+
+            double& realAt(int64_t a_slot)
+            {
+                return *reinterpret_cast<double*>(block() + m_realOffset + 8 * a_slot);
+            }
+
+            uint32_t& stringAt(int64_t a_slot)
+            {
+                return *reinterpret_cast<uint32_t*>(block() + m_stringOffset + 4 * a_slot);
+            }
+
+            uint8_t& assigned(int32_t a_flagOffset, int64_t a_slot)
+            {
+                return block()[a_flagOffset + a_slot];
+            }
+
+            void storeString(int64_t a_slot, uint32_t a_handle)
+            {
+                if (assigned(m_stringFlagOffset, a_slot))
+                {
+                    m_heap.release(stringAt(a_slot));
+                }
+
+                stringAt(a_slot) = a_handle;
+                assigned(m_stringFlagOffset, a_slot) = true;
+            }
+
+            void release(Value a_value)
+            {
+                if (a_value.isString())
+                {
+                    m_heap.release(a_value.asString());
+                }
+            }
+
+            uint32_t concatenate(uint32_t a_head, const Value* a_tail, size_t a_count)
+            {
+                size_t length = m_heap.get(a_head).size();
+                for (size_t i = 0; i < a_count; ++i)
+                {
+                    length += m_heap.get(a_tail[i].asString()).size();
+                }
+
+                uint32_t result = a_head;
+                if (!m_heap.isUnique(a_head))
+                {
+                    std::string copy{};
+                    copy.reserve(length);
+                    copy += m_heap.get(a_head);
+                    m_heap.release(a_head);
+                    result = m_heap.allocate(std::move(copy));
+                }
+
+                std::string& target = m_heap.edit(result);
+                if (target.capacity() < length)
+                {
+                    target.reserve(std::max(length, 2 * target.capacity()));
+                }
+
+                for (size_t i = 0; i < a_count; ++i)
+                {
+                    target += m_heap.get(a_tail[i].asString());
+                    m_heap.release(a_tail[i].asString());
+                }
+
+                return result;
+            }
+
+            Value* pushString(Value* a_top, int64_t a_constant)
+            {
+                m_heap.retain(m_constants[a_constant]);
+                *a_top = Value::fromString(m_constants[a_constant]);
+                return a_top + 1;
+            }
+
+            Value* loadString(Value* a_top, int64_t a_slot)
+            {
+                m_heap.retain(stringAt(a_slot));
+                *a_top = Value::fromString(stringAt(a_slot));
+                return a_top + 1;
+            }
+
+            Value* popString(Value* a_top, int64_t a_slot)
+            {
+                storeString(a_slot, a_top[-1].asString());
+                return a_top - 1;
+            }
+
+            Value* keepString(Value* a_top, int64_t a_slot)
+            {
+                m_heap.retain(a_top[-1].asString());
+                storeString(a_slot, a_top[-1].asString());
+                return a_top;
+            }
+
+            Value* readInt(Value* a_top, int64_t a_slot)
+            {
+                intAt(a_slot) = InputBuffer::standard().readInt();
+                assigned(m_intFlagOffset, a_slot) = true;
+                return a_top;
+            }
+
+            Value* readReal(Value* a_top, int64_t a_slot)
+            {
+                realAt(a_slot) = InputBuffer::standard().readReal();
+                assigned(m_realFlagOffset, a_slot) = true;
+                return a_top;
+            }
+
+            Value* readString(Value* a_top, int64_t a_slot)
+            {
+                storeString(a_slot, m_heap.allocate(InputBuffer::standard().readString()));
+                return a_top;
+            }
+
+            Value* append(Value* a_top, int64_t a_operand)
+            {
+                int64_t slot  = a_operand & 0xFFFFFFFF;
+                int64_t arity = a_operand >> 32;
+
+                stringAt(slot) = concatenate(stringAt(slot), a_top - arity, arity);
+                return a_top - arity;
+            }
+
+            Value* concat(Value* a_top, int64_t a_count)
+            {
+                Value* operands = a_top - a_count;
+                operands[0] = Value::fromString(concatenate(operands[0].asString(), operands + 1, a_count - 1));
+                return operands + 1;
+            }
+
+            Value* write(Value* a_top, int64_t)
+            {
+                Value value = a_top[-1];
+
+                if (value.isString())
+                {
+                    OutputBuffer::standard().write(m_heap.get(value.asString()));
+                    m_heap.release(value.asString());
+                }
+                else if (value.isReal())
+                {
+                    OutputBuffer::standard().write(value.asReal());
+                }
+                else
+                {
+                    OutputBuffer::standard().write(value.asInt());
+                }
+
+                return a_top - 1;
+            }
+
+            Value* pop(Value* a_top, int64_t)
+            {
+                release(a_top[-1]);
+                return a_top - 1;
+            }
+
+            Value* compareStrings(Value* a_top, int64_t a_comparison)
+            {
+                const std::string& left  = m_heap.get(a_top[-2].asString());
+                const std::string& right = m_heap.get(a_top[-1].asString());
+
+                bool result{};
+                switch (a_comparison)
+                {
+                    case 0:  result = left == right; break;
+                    case 1:  result = left != right; break;
+                    case 2:  result = left < right;  break;
+                    case 3:  result = left > right;  break;
+                    case 4:  result = left <= right; break;
+                    default: result = left >= right; break;
+                }
+
+                m_heap.release(a_top[-2].asString());
+                m_heap.release(a_top[-1].asString());
+                a_top[-2] = Value::fromInt(result);
+                return a_top - 1;
+            }
+
+            template<Value* (JitRuntime::*t_method)(Value*, int64_t)>
+            static Value* entry(JitRuntime* a_runtime, Value* a_top, int64_t a_operand) noexcept
+            {
+                try
+                {
+                    return (a_runtime->*t_method)(a_top, a_operand);
+                }
+                catch (...)
+                {
+                    a_runtime->m_error = std::current_exception();
+                    return nullptr;
+                }
+            }
+
+            friend class JitCompiler;
+            friend class ElfEmitter;
+
+        public:
+
+            void layout(const Program& a_program)
+            {
+                auto align = [](int32_t a_offset) { return (a_offset + 7) & ~7; };
+
+                m_intOffset        = 0;
+                m_realOffset       = align(m_intOffset + 4 * a_program.intSlots());
+                m_stringOffset     = align(m_realOffset + 8 * a_program.realSlots());
+                m_intFlagOffset    = m_stringOffset + 4 * a_program.stringSlots();
+                m_realFlagOffset   = m_intFlagOffset + a_program.intSlots();
+                m_stringFlagOffset = m_realFlagOffset + a_program.realSlots();
+            }
+
+            void reset(const Program& a_program)
+            {
+                m_block.assign((m_stringFlagOffset + a_program.stringSlots() + 7) / 8 + 1, 0);
+                m_error = nullptr;
+
+                m_heap.clear();
+                m_constants.clear();
+                for (auto& string : a_program.strings())
+                {
+                    m_constants.push_back(m_heap.allocate(std::string(string)));
+                }
+            }
+
+            void import(const VariableState& a_state)
+            {
+                for (size_t slot = 0; slot < a_state.ints.size(); ++slot)
+                {
+                    intAt(slot) = a_state.ints[slot];
+                    assigned(m_intFlagOffset, slot) = a_state.intAssigned[slot];
+                }
+
+                for (size_t slot = 0; slot < a_state.reals.size(); ++slot)
+                {
+                    realAt(slot) = a_state.reals[slot];
+                    assigned(m_realFlagOffset, slot) = a_state.realAssigned[slot];
+                }
+
+                for (size_t slot = 0; slot < a_state.strings.size(); ++slot)
+                {
+                    if (a_state.stringAssigned[slot])
+                    {
+                        storeString(slot, m_heap.allocate(std::string(a_state.strings[slot])));
+                    }
+                }
+            }
+
+            uint8_t* variables()
+            {
+                return block();
+            }
+
+            const StringHeap& heap() const
+            {
+                return m_heap;
+            }
+
+            void rethrow()
+            {
+                if (m_error)
+                {
+                    std::rethrow_exception(m_error);
+                }
+            }
+    };
+
+    class JitCompiler
+    {
+        private:
+            using Helper   = Value* (*)(JitRuntime*, Value*, int64_t);
+            using Override = std::function<bool(X86Assembler&, const Instruction&)>;
+
+            static constexpr uint64_t s_signMask = 0x8000000000000000ull;
+
+            const Program&      m_program;
+            const JitRuntime&   m_runtime;
+            X86Assembler        m_assembler;
+            Override            m_override;
+            size_t              m_entry{};
+            std::vector<size_t> m_offsets;
+            std::vector<std::pair<size_t, int32_t>> m_jumps;
+            std::vector<size_t> m_unassigned;
+            std::vector<size_t> m_divisionByZero;
+            std::vector<size_t> m_failed;
+            std::vector<size_t> m_halts;
+            std::string         m_reason;
+
+            static uint64_t intTag()
+            {
+                return Value::fromInt(0).bits();
+            }
+
+            void jumpTo(size_t a_fixup, int32_t a_target)
+            {
+                m_jumps.emplace_back(a_fixup, a_target);
+            }
+
+            void checkAssigned(int32_t a_flagOffset, const Instruction& a_load)
+            {
+                if (a_load.arity & Instruction::s_checked)
+                {
+                    checkAssigned(a_flagOffset, a_load.operand);
+                }
+            }
+
+            void checkAssigned(int32_t a_flagOffset, int32_t a_slot)
+            {
+                m_assembler.cmpByte(s_variables, a_flagOffset + a_slot, 0);
+                m_unassigned.push_back(m_assembler.jcc(Condition::E));
+            }
+
+            void callHelper(Helper a_helper, int64_t a_operand)
+            {
+                m_assembler.mov(Reg::RDI, s_runtime);
+                m_assembler.mov(Reg::RSI, s_stack);
+                m_assembler.movImm(Reg::RDX, a_operand);
+                m_assembler.movImm(Reg::RAX, reinterpret_cast<uint64_t>(a_helper));
+                m_assembler.call(Reg::RAX);
+                m_assembler.test64(Reg::RAX, Reg::RAX);
+                m_failed.push_back(m_assembler.jcc(Condition::E));
+                m_assembler.mov(s_stack, Reg::RAX);
+            }
+
+            void pushRax()
+            {
+                m_assembler.store64(s_stack, 0, Reg::RAX);
+                m_assembler.addImm(s_stack, 8);
+            }
+
+            void tagAndStore(int32_t a_displacement)
+            {
+                m_assembler.movzxByte(Reg::RAX, Reg::RAX);
+                m_assembler.or64(Reg::RAX, s_intTag);
+                m_assembler.store64(s_stack, a_displacement, Reg::RAX);
+            }
+
+            void canonicalize()
+            {
+                m_assembler.ucomisd(Xmm::XMM0, Xmm::XMM0);
+                size_t ordered = m_assembler.jcc(Condition::NP);
+                m_assembler.movImm(Reg::RAX, Value::fromReal(std::nan("")).bits());
+                m_assembler.movqToXmm(Xmm::XMM0, Reg::RAX);
+                m_assembler.patch(ordered, m_assembler.size());
+            }
+
+            static Condition intCondition(int a_comparison)
+            {
+                static const Condition s_conditions[] = {
+                    Condition::E, Condition::NE, Condition::L, Condition::G, Condition::LE, Condition::GE
+                };
+                return s_conditions[a_comparison];
+            }
+
+            static Condition inverse(Condition a_condition)
+            {
+                return static_cast<Condition>(static_cast<uint8_t>(a_condition) ^ 1);
+            }
+
+            void realArithmetic(Opcode a_opcode)
+            {
+                m_assembler.subImm(s_stack, 8);
+                m_assembler.movsdLoad(Xmm::XMM0, s_stack, -8);
+                switch (a_opcode)
+                {
+                    case Opcode::ADD_REAL: m_assembler.addsd(Xmm::XMM0, s_stack, 0); break;
+                    case Opcode::SUB_REAL: m_assembler.subsd(Xmm::XMM0, s_stack, 0); break;
+                    case Opcode::MUL_REAL: m_assembler.mulsd(Xmm::XMM0, s_stack, 0); break;
+                    default:               m_assembler.divsd(Xmm::XMM0, s_stack, 0); break;
+                }
+                canonicalize();
+                m_assembler.movsdStore(s_stack, -8, Xmm::XMM0);
+            }
+
+            void realComparison(int a_comparison)
+            {
+                m_assembler.subImm(s_stack, 8);
+
+                bool swapped = (a_comparison == 2 || a_comparison == 4);
+                m_assembler.movsdLoad(Xmm::XMM0, s_stack, swapped ? 0 : -8);
+                m_assembler.ucomisd(Xmm::XMM0, s_stack, swapped ? -8 : 0);
+
+                switch (a_comparison)
+                {
+                    case 0:
+                        m_assembler.setcc(Condition::E, Reg::RAX);
+                        m_assembler.setcc(Condition::NP, Reg::RCX);
+                        m_assembler.and8(Reg::RAX, Reg::RCX);
+                        break;
+                    case 1:
+                        m_assembler.setcc(Condition::NE, Reg::RAX);
+                        m_assembler.setcc(Condition::P, Reg::RCX);
+                        m_assembler.or8(Reg::RAX, Reg::RCX);
+                        break;
+                    case 2:
+                    case 3:
+                        m_assembler.setcc(Condition::A, Reg::RAX);
+                        break;
+                    default:
+                        m_assembler.setcc(Condition::AE, Reg::RAX);
+                        break;
+                }
+
+                tagAndStore(-8);
+            }
+
+            void logical(bool a_and)
+            {
+                m_assembler.subImm(s_stack, 8);
+                m_assembler.load32(Reg::RCX, s_stack, 0);
+                m_assembler.test32(Reg::RCX, Reg::RCX);
+                m_assembler.setcc(Condition::NE, Reg::RCX);
+                m_assembler.load32(Reg::RAX, s_stack, -8);
+                m_assembler.test32(Reg::RAX, Reg::RAX);
+                m_assembler.setcc(Condition::NE, Reg::RAX);
+                if (a_and)
+                {
+                    m_assembler.and8(Reg::RAX, Reg::RCX);
+                }
+                else
+                {
+                    m_assembler.or8(Reg::RAX, Reg::RCX);
+                }
+                tagAndStore(-8);
+            }
+
+            bool translate(const Instruction& a_instruction)
+            {
+                const JitRuntime& rt = m_runtime;
+                int32_t operand = a_instruction.operand;
+
+                switch (a_instruction.opcode)
+                {
+                    case Opcode::PUSH_INT:
+                        m_assembler.movImm(Reg::RAX, Value::fromInt(operand).bits());
+                        pushRax();
+                        break;
+
+                    case Opcode::PUSH_REAL:
+                        m_assembler.movImm(Reg::RAX, Value::fromReal(m_program.reals()[operand]).bits());
+                        pushRax();
+                        break;
+
+                    case Opcode::PUSH_STRING:
+                        callHelper(&JitRuntime::entry<&JitRuntime::pushString>, operand);
+                        break;
+
+                    case Opcode::LOAD_INT:
+                        checkAssigned(rt.m_intFlagOffset, a_instruction);
+                        m_assembler.load32(Reg::RAX, s_variables, rt.m_intOffset + 4 * operand);
+                        m_assembler.or64(Reg::RAX, s_intTag);
+                        pushRax();
+                        break;
+
+                    case Opcode::LOAD_REAL:
+                        checkAssigned(rt.m_realFlagOffset, a_instruction);
+                        m_assembler.load64(Reg::RAX, s_variables, rt.m_realOffset + 8 * operand);
+                        pushRax();
+                        break;
+
+                    case Opcode::LOAD_STRING:
+                        checkAssigned(rt.m_stringFlagOffset, a_instruction);
+                        callHelper(&JitRuntime::entry<&JitRuntime::loadString>, operand);
+                        break;
+
+                    case Opcode::STORE_INT:
+                    case Opcode::STORE_KEEP_INT:
+                    {
+                        bool keep = (a_instruction.opcode == Opcode::STORE_KEEP_INT);
+                        if (!keep)
+                        {
+                            m_assembler.subImm(s_stack, 8);
+                        }
+                        m_assembler.load32(Reg::RAX, s_stack, keep ? -8 : 0);
+                        m_assembler.store32(s_variables, rt.m_intOffset + 4 * operand, Reg::RAX);
+                        m_assembler.storeByte(s_variables, rt.m_intFlagOffset + operand, 1);
+                        break;
+                    }
+
+                    case Opcode::STORE_REAL:
+                    case Opcode::STORE_KEEP_REAL:
+                    {
+                        bool keep = (a_instruction.opcode == Opcode::STORE_KEEP_REAL);
+                        if (!keep)
+                        {
+                            m_assembler.subImm(s_stack, 8);
+                        }
+                        m_assembler.load64(Reg::RAX, s_stack, keep ? -8 : 0);
+                        m_assembler.store64(s_variables, rt.m_realOffset + 8 * operand, Reg::RAX);
+                        m_assembler.storeByte(s_variables, rt.m_realFlagOffset + operand, 1);
+                        break;
+                    }
+
+                    case Opcode::STORE_STRING:
+                        callHelper(&JitRuntime::entry<&JitRuntime::popString>, operand);
+                        break;
+
+                    case Opcode::STORE_KEEP_STRING:
+                        callHelper(&JitRuntime::entry<&JitRuntime::keepString>, operand);
+                        break;
+
+                    case Opcode::READ_INT:
+                        callHelper(&JitRuntime::entry<&JitRuntime::readInt>, operand);
+                        break;
+
+                    case Opcode::READ_REAL:
+                        callHelper(&JitRuntime::entry<&JitRuntime::readReal>, operand);
+                        break;
+
+                    case Opcode::READ_STRING:
+                        callHelper(&JitRuntime::entry<&JitRuntime::readString>, operand);
+                        break;
+
+                    case Opcode::APPEND_STRING:
+                        checkAssigned(rt.m_stringFlagOffset, operand);
+                        callHelper(&JitRuntime::entry<&JitRuntime::append>, operand | (int64_t(a_instruction.arity) << 32));
+                        break;
+
+                    case Opcode::CONCAT:
+                        callHelper(&JitRuntime::entry<&JitRuntime::concat>, operand);
+                        break;
+
+                    case Opcode::WRITE:
+                        callHelper(&JitRuntime::entry<&JitRuntime::write>, 0);
+                        break;
+
+                    case Opcode::POP:
+                        callHelper(&JitRuntime::entry<&JitRuntime::pop>, 0);
+                        break;
+
+                    case Opcode::TO_INT:
+                        m_assembler.cvttsd2si(Reg::RAX, s_stack, -8);
+                        m_assembler.or64(Reg::RAX, s_intTag);
+                        m_assembler.store64(s_stack, -8, Reg::RAX);
+                        break;
+
+                    case Opcode::TO_REAL:
+                    case Opcode::TO_REAL_SECOND:
+                    {
+                        int32_t displacement = (a_instruction.opcode == Opcode::TO_REAL) ? -8 : -16;
+                        m_assembler.cvtsi2sd(Xmm::XMM0, s_stack, displacement);
+                        m_assembler.movsdStore(s_stack, displacement, Xmm::XMM0);
+                        break;
+                    }
+
+                    case Opcode::ADD_INT:
+                    case Opcode::SUB_INT:
+                        m_assembler.subImm(s_stack, 8);
+                        m_assembler.load32(Reg::RAX, s_stack, 0);
+                        if (a_instruction.opcode == Opcode::ADD_INT)
+                        {
+                            m_assembler.addTo32(s_stack, -8, Reg::RAX);
+                        }
+                        else
+                        {
+                            m_assembler.subFrom32(s_stack, -8, Reg::RAX);
+                        }
+                        break;
+
+                    case Opcode::MUL_INT:
+                        m_assembler.subImm(s_stack, 8);
+                        m_assembler.load32(Reg::RAX, s_stack, -8);
+                        m_assembler.imul32(Reg::RAX, s_stack, 0);
+                        m_assembler.store32(s_stack, -8, Reg::RAX);
+                        break;
+
+                    case Opcode::DIV_INT:
+                        m_assembler.subImm(s_stack, 8);
+                        m_assembler.loadSigned32(Reg::RAX, s_stack, -8);
+                        m_assembler.loadSigned32(Reg::RCX, s_stack, 0);
+                        if (a_instruction.arity & Instruction::s_checked)
+                        {
+                            m_assembler.test32(Reg::RCX, Reg::RCX);
+                            m_divisionByZero.push_back(m_assembler.jcc(Condition::E));
+                        }
+                        // INT_MIN / -1 only fits the 64-bit divide.
+                        if (a_instruction.arity & Instruction::s_exact)
+                        {
+                            m_assembler.cdq();
+                            m_assembler.idiv32(Reg::RCX);
+                        }
+                        else
+                        {
+                            m_assembler.cqo();
+                            m_assembler.idiv64(Reg::RCX);
+                        }
+                        m_assembler.store32(s_stack, -8, Reg::RAX);
+                        break;
+
+                    case Opcode::ADD_REAL:
+                    case Opcode::SUB_REAL:
+                    case Opcode::MUL_REAL:
+                    case Opcode::DIV_REAL:
+                        realArithmetic(a_instruction.opcode);
+                        break;
+
+                    case Opcode::NEG_INT:
+                        m_assembler.neg32(s_stack, -8);
+                        break;
+
+                    case Opcode::NEG_REAL:
+                        m_assembler.load64(Reg::RAX, s_stack, -8);
+                        m_assembler.movImm(Reg::RCX, s_signMask);
+                        m_assembler.xor64(Reg::RAX, Reg::RCX);
+                        m_assembler.movqToXmm(Xmm::XMM0, Reg::RAX);
+                        canonicalize();
+                        m_assembler.movsdStore(s_stack, -8, Xmm::XMM0);
+                        break;
+
+                    case Opcode::NOT:
+                        m_assembler.cmpDword(s_stack, -8, 0);
+                        m_assembler.setcc(Condition::E, Reg::RAX);
+                        tagAndStore(-8);
+                        break;
+
+                    case Opcode::EQ_INT:
+                    case Opcode::NEQ_INT:
+                    case Opcode::LESS_INT:
+                    case Opcode::GREATER_INT:
+                    case Opcode::LEQ_INT:
+                    case Opcode::GEQ_INT:
+                        m_assembler.subImm(s_stack, 8);
+                        m_assembler.load32(Reg::RAX, s_stack, -8);
+                        m_assembler.cmp32(Reg::RAX, s_stack, 0);
+                        m_assembler.setcc(intCondition(static_cast<int>(a_instruction.opcode) - static_cast<int>(Opcode::EQ_INT)), Reg::RAX);
+                        tagAndStore(-8);
+                        break;
+
+                    case Opcode::EQ_REAL:
+                    case Opcode::NEQ_REAL:
+                    case Opcode::LESS_REAL:
+                    case Opcode::GREATER_REAL:
+                    case Opcode::LEQ_REAL:
+                    case Opcode::GEQ_REAL:
+                        realComparison(static_cast<int>(a_instruction.opcode) - static_cast<int>(Opcode::EQ_REAL));
+                        break;
+
+                    case Opcode::EQ_STRING:
+                    case Opcode::NEQ_STRING:
+                    case Opcode::LESS_STRING:
+                    case Opcode::GREATER_STRING:
+                    case Opcode::LEQ_STRING:
+                    case Opcode::GEQ_STRING:
+                        callHelper(&JitRuntime::entry<&JitRuntime::compareStrings>,
+                            static_cast<int>(a_instruction.opcode) - static_cast<int>(Opcode::EQ_STRING));
+                        break;
+
+                    case Opcode::AND:
+                    case Opcode::OR:
+                        logical(a_instruction.opcode == Opcode::AND);
+                        break;
+
+                    case Opcode::JUMP:
+                        jumpTo(m_assembler.jmp(), operand);
+                        break;
+
+                    case Opcode::JUMP_FALSE:
+                    case Opcode::JUMP_TRUE:
+                        m_assembler.subImm(s_stack, 8);
+                        m_assembler.cmpDword(s_stack, 0, 0);
+                        jumpTo(m_assembler.jcc(a_instruction.opcode == Opcode::JUMP_FALSE ? Condition::E : Condition::NE), operand);
+                        break;
+
+                    case Opcode::JUMP_FALSE_LAZY:
+                    case Opcode::JUMP_TRUE_LAZY:
+                        m_assembler.cmpDword(s_stack, -8, 0);
+                        jumpTo(m_assembler.jcc(a_instruction.opcode == Opcode::JUMP_FALSE_LAZY ? Condition::E : Condition::NE), operand);
+                        break;
+
+                    case Opcode::HALT:
+                        m_halts.push_back(m_assembler.jmp());
+                        break;
+
+                    case Opcode::INC_INT:
+                        m_assembler.addImmTo32(s_variables, rt.m_intOffset + 4 * a_instruction.arity, operand);
+                        break;
+
+                    case Opcode::LOAD_INT_PUSH_INT:
+                        m_assembler.load32(Reg::RAX, s_variables, rt.m_intOffset + 4 * a_instruction.arity);
+                        m_assembler.or64(Reg::RAX, s_intTag);
+                        pushRax();
+                        m_assembler.movImm(Reg::RAX, Value::fromInt(operand).bits());
+                        pushRax();
+                        break;
+
+                    case Opcode::EQ_INT_JUMP_FALSE:
+                    case Opcode::NEQ_INT_JUMP_FALSE:
+                    case Opcode::LESS_INT_JUMP_FALSE:
+                    case Opcode::GREATER_INT_JUMP_FALSE:
+                    case Opcode::LEQ_INT_JUMP_FALSE:
+                    case Opcode::GEQ_INT_JUMP_FALSE:
+                    {
+                        Condition condition = intCondition(static_cast<int>(a_instruction.opcode) - static_cast<int>(Opcode::EQ_INT_JUMP_FALSE));
+                        m_assembler.subImm(s_stack, 16);
+                        m_assembler.load32(Reg::RAX, s_stack, 0);
+                        m_assembler.cmp32(Reg::RAX, s_stack, 8);
+                        jumpTo(m_assembler.jcc(inverse(condition)), operand);
+                        break;
+                    }
+
+                    default:
+                        m_reason = "unsupported opcode " + std::to_string(static_cast<int>(a_instruction.opcode));
+                        return false;
+                }
+
+                return true;
+            }
+
+            void prologue()
+            {
+                m_assembler.push(Reg::RBX);
+                m_assembler.push(Reg::R12);
+                m_assembler.push(Reg::R13);
+                m_assembler.push(Reg::R14);
+                m_assembler.push(Reg::R15);
+                m_assembler.push(Reg::RBP);
+                m_assembler.subImm(Reg::RSP, 8);
+
+                m_assembler.mov(s_runtime, Reg::RDI);
+                m_assembler.mov(s_stack, Reg::RSI);
+                m_assembler.mov(s_variables, Reg::RDX);
+                m_assembler.movImm(s_intTag, intTag());
+                m_assembler.jmp(Reg::RCX);
+            }
+
+            void epilogue(size_t a_exit)
+            {
+                m_assembler.patch(a_exit, m_assembler.size());
+                m_assembler.addImm(Reg::RSP, 8);
+                m_assembler.pop(Reg::RBP);
+                m_assembler.pop(Reg::R15);
+                m_assembler.pop(Reg::R14);
+                m_assembler.pop(Reg::R13);
+                m_assembler.pop(Reg::R12);
+                m_assembler.pop(Reg::RBX);
+                m_assembler.ret();
+            }
+
+            size_t status(const std::vector<size_t>& a_fixups, uint64_t a_status)
+            {
+                for (size_t fixup : a_fixups)
+                {
+                    m_assembler.patch(fixup, m_assembler.size());
+                }
+
+                m_assembler.movImm(Reg::RAX, a_status);
+                return m_assembler.jmp();
+            }
+
+        public:
+
+            static constexpr Reg s_runtime   = Reg::RBX;
+            static constexpr Reg s_stack     = Reg::R12;
+            static constexpr Reg s_variables = Reg::R13;
+            static constexpr Reg s_intTag    = Reg::R15;
+
+            static constexpr uint64_t s_finished       = 0;
+            static constexpr uint64_t s_unassigned     = 1;
+            static constexpr uint64_t s_failed         = 2;
+            static constexpr uint64_t s_divisionByZero = 3;
+
+            JitCompiler(const Program& a_program, const JitRuntime& a_runtime, X86Assembler a_prefix = {}, Override a_override = {})
+                : m_program(a_program), m_runtime(a_runtime), m_assembler(std::move(a_prefix)), m_override(std::move(a_override))
+            {
+            }
+
+            bool compile()
+            {
+                const std::vector<Instruction>& code = m_program.code();
+
+                m_entry = m_assembler.size();
+                prologue();
+
+                m_offsets.resize(code.size());
+                for (size_t i = 0; i < code.size(); ++i)
+                {
+                    m_offsets[i] = m_assembler.size();
+                    if (m_override && m_override(m_assembler, code[i]))
+                    {
+                        continue;
+                    }
+                    if (!translate(code[i]))
+                    {
+                        return false;
+                    }
+                }
+
+                for (auto& [fixup, target] : m_jumps)
+                {
+                    m_assembler.patch(fixup, m_offsets[target]);
+                }
+
+                size_t finished   = status(m_halts, s_finished);
+                size_t unassigned = status(m_unassigned, s_unassigned);
+                size_t failed     = status(m_failed, s_failed);
+                size_t division   = status(m_divisionByZero, s_divisionByZero);
+
+                m_assembler.patch(unassigned, m_assembler.size());
+                m_assembler.patch(failed, m_assembler.size());
+                m_assembler.patch(division, m_assembler.size());
+                epilogue(finished);
+
+                return true;
+            }
+
+            const std::vector<uint8_t>& code() const
+            {
+                return m_assembler.code();
+            }
+
+            const std::vector<size_t>& offsets() const
+            {
+                return m_offsets;
+            }
+
+            size_t entry() const
+            {
+                return m_entry;
+            }
+
+            const std::string& reason() const
+            {
+                return m_reason;
+            }
+    };
+
+    class JitMachine
+    {
+        private:
+            using Entry = uint64_t (*)(JitRuntime*, Value*, uint8_t*, const void*);
+
+            JitRuntime           m_runtime;
+            std::vector<Value>   m_stack;
+            std::vector<size_t>  m_offsets;
+            std::vector<int32_t> m_depths;
+            std::string          m_reason;
+            uint8_t*             m_memory{};
+            size_t               m_size{};
+            const Program*       m_program{};
+
+            void release()
+            {
+#ifdef MLI_JIT_AVAILABLE
+                if (m_memory)
+                {
+                    munmap(m_memory, m_size);
+                }
+#endif
+                m_memory = nullptr;
+                m_size   = 0;
+            }
+
+            bool fail(const std::string& a_reason)
+            {
+                m_reason = a_reason;
+                return false;
+            }
+
+            void enter(size_t a_entry)
+            {
+                Entry entry = reinterpret_cast<Entry>(m_memory);
+                uint64_t status = entry(&m_runtime, m_stack.data(), m_runtime.variables(), m_memory + m_offsets[a_entry]);
+
+                if (status == JitCompiler::s_unassigned)
+                {
+                    throw std::runtime_error("variable is not assigned");
+                }
+                if (status == JitCompiler::s_failed)
+                {
+                    m_runtime.rethrow();
+                }
+                if (status == JitCompiler::s_divisionByZero)
+                {
+                    throw std::runtime_error("division by zero");
+                }
+            }
+
+        public:
+
+            JitMachine() = default;
+            JitMachine(const JitMachine&) = delete;
+            JitMachine& operator=(const JitMachine&) = delete;
+
+            ~JitMachine()
+            {
+                release();
+            }
+
+            bool compile(const Program& a_program)
+            {
+#ifdef MLI_JIT_AVAILABLE
+                release();
+
+                Verifier verifier{a_program};
+                int32_t maxDepth = verifier.verify();
+                m_depths = verifier.depths();
+
+                m_runtime.layout(a_program);
+
+                JitCompiler compiler{a_program, m_runtime};
+                if (!compiler.compile())
+                {
+                    return fail(compiler.reason());
+                }
+
+                size_t pageSize = sysconf(_SC_PAGESIZE);
+                m_size = (compiler.code().size() + pageSize - 1) / pageSize * pageSize;
+
+                void* memory = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (memory == MAP_FAILED)
+                {
+                    m_size = 0;
+                    return fail("cannot map executable memory");
+                }
+
+                m_memory = static_cast<uint8_t*>(memory);
+                std::copy(compiler.code().begin(), compiler.code().end(), m_memory);
+
+                if (mprotect(m_memory, m_size, PROT_READ | PROT_EXEC) != 0)
+                {
+                    release();
+                    return fail("cannot make generated code executable");
+                }
+
+                m_offsets = compiler.offsets();
+                m_stack.assign(maxDepth + 1, Value{});
+                m_program = &a_program;
+                return true;
+#else
+                (void)a_program;
+                return fail("x86-64 code generation is not available on this platform");
+#endif
+            }
+
+            const std::string& reason() const
+            {
+                return m_reason;
+            }
+
+            const StringHeap& heap() const
+            {
+                return m_runtime.heap();
+            }
+
+            bool canEnter(size_t a_index) const
+            {
+                return m_memory && m_depths[a_index] == 0;
+            }
+
+            void execute()
+            {
+                assert(m_memory && "execute without compiled code");
+
+                m_runtime.reset(*m_program);
+                enter(0);
+                OutputBuffer::standard().flush();
+            }
+
+            void resume(const VariableState& a_state, size_t a_entry)
+            {
+                assert(canEnter(a_entry) && "resume at an instruction with a live operand stack");
+
+                m_runtime.reset(*m_program);
+                m_runtime.import(a_state);
+                enter(a_entry);
+                OutputBuffer::standard().flush();
+            }
+
+            void writePerfMap(const std::string& a_name) const
+            {
+#ifdef MLI_JIT_AVAILABLE
+                std::ofstream map{"/tmp/perf-" + std::to_string(getpid()) + ".map", std::ios::app};
+                const std::vector<Instruction>& code = m_program->code();
+
+                std::vector<bool> leaders(code.size());
+                leaders[0] = true;
+                for (size_t i = 0; i < code.size(); ++i)
+                {
+                    if (isJump(code[i].opcode))
+                    {
+                        leaders[code[i].operand] = true;
+                        if (i + 1 < code.size())
+                        {
+                            leaders[i + 1] = true;
+                        }
+                    }
+                }
+
+                map << std::hex;
+                map << reinterpret_cast<uintptr_t>(m_memory) << " " << m_offsets[0] << " mli_jit::entry\n";
+
+                for (size_t i = 0; i < code.size(); ++i)
+                {
+                    if (!leaders[i])
+                    {
+                        continue;
+                    }
+
+                    size_t end = i + 1;
+                    while (end < code.size() && !leaders[end])
+                    {
+                        ++end;
+                    }
+
+                    size_t start = m_offsets[i];
+                    size_t stop  = (end < code.size()) ? m_offsets[end] : m_offsets.back() + 5;
+                    map << reinterpret_cast<uintptr_t>(m_memory + start) << " " << stop - start
+                        << " mli_jit::" << a_name << "::" << std::dec << i << std::hex << "\n";
+                }
+#else
+                (void)a_name;
+#endif
+            }
+    };
+}
+
+#endif // JIT_HPP
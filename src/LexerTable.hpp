@@ -0,0 +1,201 @@
+#ifndef LEXER_TABLE_HPP
+#define LEXER_TABLE_HPP
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+
+#include "Token.hpp"
+
+#undef NULL
+
+namespace mli {
+
+    // The lexer's DFA, generated at compile time from Token's spellings. Bytes fall into a few
+    // fixed classes plus one for each character a delimeter is spelled with; from START the
+    // delimeters form a trie and words, numbers, strings and comments have states of their own.
+    // A state without a transition for the next byte ends the token, as its Accept says.
+    class LexerTable
+    {
+        public:
+            static constexpr size_t s_maxClasses = 32;
+            static constexpr size_t s_maxStates  = 48;
+
+            enum ByteClass : uint8_t
+            {
+                OTHER, SPACE, NEWLINE, ALPHA, DIGIT, DOT, END,
+                FIRST_DELIMETER_CLASS
+            };
+
+            enum Fixed : uint8_t
+            {
+                START, WORD, NUMBER, REAL, STRING, CLOSED_STRING, COMMENT, COMMENT_STAR, BAD_NUMBER,
+                FIRST_DELIMETER_STATE,
+                STOP = 0xFF
+            };
+
+            enum class Accept : uint8_t
+            {
+                FINISH,           // at the end of the source; anything else is unexpected
+                WORD, INT, REAL, STRING, DELIMETER,
+                UNEXPECTED_LAST,  // the byte just read cannot follow the rest
+                UNEXPECTED_FIRST, // a delimeter prefix nothing completes, like a lone '!'
+                UNEXPECTED_EOF
+            };
+
+            std::array<uint8_t, 256>                                   classes{};
+            std::array<std::array<uint8_t, s_maxClasses>, s_maxStates> next{};
+            std::array<Accept, s_maxStates>                            accepts{};
+            std::array<Token::Type, s_maxStates>                       types{};
+            std::array<bool, s_maxStates>                              countsLines{};
+            size_t                                                     classCount{FIRST_DELIMETER_CLASS};
+            size_t                                                     stateCount{FIRST_DELIMETER_STATE};
+
+            static const LexerTable s_table;
+
+        private:
+
+            constexpr uint8_t& classOf(char a_char)
+            {
+                return classes[static_cast<unsigned char>(a_char)];
+            }
+
+            constexpr uint8_t delimeterClass(char a_char)
+            {
+                uint8_t& byteClass = classOf(a_char);
+                if (byteClass == OTHER)
+                {
+                    if (classCount == s_maxClasses)
+                    {
+                        throw std::logic_error("[LexerTable]: too many delimeter characters");
+                    }
+                    byteClass = classCount++;
+                }
+                if (byteClass < FIRST_DELIMETER_CLASS)
+                {
+                    throw std::logic_error("[LexerTable]: a delimeter is spelled with a word or space character");
+                }
+                return byteClass;
+            }
+
+            constexpr void addDelimeter(std::string_view a_spelling, Token::Type a_type)
+            {
+                uint8_t state = START;
+                for (char character : a_spelling)
+                {
+                    uint8_t& target = next[state][delimeterClass(character)];
+                    if (target == STOP)
+                    {
+                        if (stateCount == s_maxStates)
+                        {
+                            throw std::logic_error("[LexerTable]: too many delimeter states");
+                        }
+                        accepts[stateCount] = Accept::UNEXPECTED_FIRST;
+                        types[stateCount]   = Token::Type::NULL;
+                        target = stateCount++;
+                    }
+                    state = target;
+                }
+
+                accepts[state] = Accept::DELIMETER;
+                types[state]   = a_type;
+            }
+
+            // Every class but END moves a_state to a_target.
+            constexpr void anyByte(uint8_t a_state, uint8_t a_target)
+            {
+                for (size_t byteClass = 0; byteClass < classCount; ++byteClass)
+                {
+                    next[a_state][byteClass] = (byteClass == END) ? STOP : a_target;
+                }
+            }
+
+        public:
+
+            static constexpr LexerTable build()
+            {
+                LexerTable table{};
+                for (auto& row : table.next)
+                {
+                    row.fill(STOP);
+                }
+
+                for (char space : {' ', '\t', '\v', '\f', '\r'})
+                {
+                    table.classOf(space) = SPACE;
+                }
+                table.classOf('\n') = NEWLINE;
+                for (char letter = 'a'; letter <= 'z'; ++letter)
+                {
+                    table.classOf(letter) = ALPHA;
+                    table.classOf(letter - 'a' + 'A') = ALPHA;
+                }
+                for (char digit = '0'; digit <= '9'; ++digit)
+                {
+                    table.classOf(digit) = DIGIT;
+                }
+                table.classOf('.') = DOT;
+
+                table.accepts[START]         = Accept::FINISH;
+                table.accepts[WORD]          = Accept::WORD;
+                table.accepts[NUMBER]        = Accept::INT;
+                table.accepts[REAL]          = Accept::REAL;
+                table.accepts[STRING]        = Accept::UNEXPECTED_EOF;
+                table.accepts[CLOSED_STRING] = Accept::STRING;
+                table.accepts[COMMENT]       = Accept::UNEXPECTED_EOF;
+                table.accepts[COMMENT_STAR]  = Accept::UNEXPECTED_EOF;
+                table.accepts[BAD_NUMBER]    = Accept::UNEXPECTED_LAST;
+
+                for (auto& [spelling, type] : Token::s_delimeterSpellings)
+                {
+                    if (!spelling.empty())
+                    {
+                        table.addDelimeter(spelling, type);
+                    }
+                }
+
+                uint8_t quote = table.delimeterClass('"');
+                uint8_t star  = table.delimeterClass('*');
+                uint8_t slash = table.delimeterClass('/');
+
+                table.next[START][SPACE]   = START;
+                table.next[START][NEWLINE] = START;
+                table.next[START][ALPHA]   = WORD;
+                table.next[START][DIGIT]   = NUMBER;
+                table.next[START][quote]   = STRING;
+                table.countsLines[START]   = true;
+
+                table.next[WORD][ALPHA] = WORD;
+                table.next[WORD][DIGIT] = WORD;
+
+                table.next[NUMBER][DIGIT] = NUMBER;
+                table.next[NUMBER][DOT]   = REAL;
+                table.next[NUMBER][ALPHA] = BAD_NUMBER;
+                table.next[REAL][DIGIT]   = REAL;
+                table.next[REAL][ALPHA]   = BAD_NUMBER;
+
+                // Newlines inside a string literal have never been counted.
+                table.anyByte(STRING, STRING);
+                table.next[STRING][quote] = CLOSED_STRING;
+
+                // A '*' takes the byte after it along, so "**/" does not close a comment.
+                if (table.next[START][slash] == STOP)
+                {
+                    throw std::logic_error("[LexerTable]: comments need '/' to be a delimeter");
+                }
+                table.next[table.next[START][slash]][star] = COMMENT;
+                table.anyByte(COMMENT, COMMENT);
+                table.next[COMMENT][star] = COMMENT_STAR;
+                table.anyByte(COMMENT_STAR, COMMENT);
+                table.next[COMMENT_STAR][slash] = START;
+                table.countsLines[COMMENT]      = true;
+                table.countsLines[COMMENT_STAR] = true;
+
+                return table;
+            }
+    };
+
+    constexpr LexerTable LexerTable::s_table = LexerTable::build();
+}
+
+#endif // LEXER_TABLE_HPP
@@ -0,0 +1,620 @@
+#ifndef LOOP_OPTIMIZER_HPP
+#define LOOP_OPTIMIZER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "Bytecode.hpp"
+#include "ControlFlow.hpp"
+#include "Expressions.hpp"
+#include "Optimizer.hpp"
+#include "Ssa.hpp"
+
+namespace mli {
+
+    // Loop-invariant code motion and strength reduction of induction variables, then loop inversion
+    // and unrolling; an unroll factor of 1 only inverts and 0 does neither. The first two put their
+    // setup code in a preheader: instructions inserted in front of the loop header that only the
+    // fallthrough entry runs, so loops entered by a jump from outside are skipped.
+    class LoopOptimizer
+    {
+        public:
+            static constexpr int32_t s_defaultUnrollFactor = 4;
+
+            // Negates the conditional jump at the end of a_code. An int comparison right before it in
+            // the same block is inverted instead, so the fuser still makes a compare-and-jump of the pair.
+            static void negate(std::vector<Instruction>& a_code, bool a_compared)
+            {
+                Instruction& jump = a_code.back();
+                Opcode comparison = a_compared ? a_code[a_code.size() - 2].opcode : Opcode::HALT;
+
+                if (comparison >= Opcode::EQ_INT && comparison <= Opcode::GEQ_INT)
+                {
+                    static const Opcode s_inverse[] = {
+                        Opcode::NEQ_INT, Opcode::EQ_INT, Opcode::GEQ_INT, Opcode::LEQ_INT, Opcode::GREATER_INT, Opcode::LESS_INT
+                    };
+                    a_code[a_code.size() - 2].opcode = s_inverse[static_cast<int>(comparison) - static_cast<int>(Opcode::EQ_INT)];
+                }
+                else
+                {
+                    jump.opcode = (jump.opcode == Opcode::JUMP_FALSE) ? Opcode::JUMP_TRUE : Opcode::JUMP_FALSE;
+                }
+            }
+
+        private:
+            static constexpr int32_t s_inversionLimit = 16;
+            static constexpr int32_t s_unrollBudget   = 64;
+
+            // scale * variable + offset in wrapping int arithmetic; variable -1 is a constant.
+            struct Affine
+            {
+                int32_t variable{-1};
+                int32_t scale{};
+                int32_t offset{};
+            };
+
+            // An update variable = variable + step, as LOAD, PUSH_INT, ADD_INT or SUB_INT, STORE.
+            struct Update
+            {
+                int32_t store{};
+                int32_t step{};
+            };
+
+            Program m_program;
+            int32_t m_unrollFactor;
+            size_t  m_loops{};
+            size_t  m_hoisted{};
+            size_t  m_reduced{};
+            size_t  m_inverted{};
+            size_t  m_unrolled{};
+            int32_t m_temporaries{};
+
+            static int32_t wrap(uint32_t a_value)
+            {
+                return static_cast<int32_t>(a_value);
+            }
+
+            bool hasPreheader(const ControlFlowGraph& a_cfg, const Verifier& a_verifier, const Loop& a_loop) const
+            {
+                const BasicBlock& header = a_cfg.block(a_loop.header);
+                if (a_verifier.depths()[header.begin] != 0)
+                {
+                    return false;
+                }
+
+                for (int32_t predecessor : header.predecessors)
+                {
+                    if (std::binary_search(a_loop.blocks.begin(), a_loop.blocks.end(), predecessor))
+                    {
+                        continue;
+                    }
+
+                    const Instruction& last = m_program.code()[a_cfg.block(predecessor).end - 1];
+                    if (a_cfg.block(predecessor).end != header.begin || (isJump(last.opcode) && last.operand == header.begin))
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            int32_t temporary(const std::string& a_prefix, Token::Type a_type)
+            {
+                return m_program.declare(a_prefix + std::to_string(m_temporaries++), a_type).slot;
+            }
+
+            // Moves expressions that only read variables assigned outside the loop to the preheader.
+            bool hoist(const ControlFlowGraph& a_cfg, const SsaForm& a_ssa, ExpressionTrees& a_trees, const Loop& a_loop, Rewrite& a_rewrite)
+            {
+                const std::vector<Instruction>& code = m_program.code();
+                const std::vector<SsaValue>& values  = a_ssa.values();
+
+                auto inLoop = [&](int32_t a_block)
+                {
+                    return std::binary_search(a_loop.blocks.begin(), a_loop.blocks.end(), a_block);
+                };
+                auto invariant = [&](const Expression& a_expression)
+                {
+                    return std::all_of(a_expression.loads.begin(), a_expression.loads.end(), [&](int32_t a_value)
+                    {
+                        const SsaValue& value = values[a_value];
+                        return value.kind == SsaValue::Kind::ENTRY
+                            || !inLoop(value.kind == SsaValue::Kind::PHI ? value.site : a_cfg.blockOf(value.site));
+                    });
+                };
+
+                std::vector<Instruction> preheader{};
+                std::map<int32_t, int32_t> hoisted{};
+
+                for (int32_t block : a_loop.blocks)
+                {
+                    std::vector<Expression> nodes = a_trees.build(block);
+                    std::sort(nodes.begin(), nodes.end(), [](const Expression& a_left, const Expression& a_right)
+                    {
+                        return a_left.begin != a_right.begin ? a_left.begin < a_right.begin : a_left.end > a_right.end;
+                    });
+
+                    int32_t replacedEnd = -1;
+                    for (const Expression& node : nodes)
+                    {
+                        if (!node.removable || node.end - node.begin < 3 || node.begin < replacedEnd || !invariant(node))
+                        {
+                            continue;
+                        }
+
+                        auto [found, inserted] = hoisted.emplace(node.number, 0);
+                        if (inserted)
+                        {
+                            found->second = temporary("licm", node.type);
+                            preheader.insert(preheader.end(), code.begin() + node.begin, code.begin() + node.end);
+                            preheader.push_back(Instruction{typedOpcode(Opcode::STORE_INT, node.type), 0, found->second});
+                            ++m_hoisted;
+                        }
+
+                        a_rewrite.replace(node.begin, {Instruction{typedOpcode(Opcode::LOAD_INT, node.type), 0, found->second}});
+                        for (int32_t i = node.begin + 1; i < node.end; ++i)
+                        {
+                            a_rewrite.remove(i);
+                        }
+                        replacedEnd = node.end;
+                    }
+                }
+
+                a_rewrite.insertBefore(a_cfg.block(a_loop.header).begin, preheader);
+                return a_rewrite.changed();
+            }
+
+            // Basic induction variables: int variables whose every assignment in the loop adds a constant.
+            std::map<int32_t, std::vector<Update>> inductionVariables(const ControlFlowGraph& a_cfg, const SsaForm& a_ssa, const Loop& a_loop) const
+            {
+                const std::vector<Instruction>& code = m_program.code();
+                const BasicBlock& header = a_cfg.block(a_loop.header);
+                std::map<int32_t, std::vector<Update>> result{};
+
+                for (int32_t phi : a_ssa.phis(a_loop.header))
+                {
+                    const SsaValue& value = a_ssa.values()[phi];
+                    if (a_ssa.typeOf(value.variable) != Token::Type::INT)
+                    {
+                        continue;
+                    }
+
+                    bool assigned = true;
+                    for (size_t k = 0; k < header.predecessors.size(); ++k)
+                    {
+                        if (!std::binary_search(a_loop.blocks.begin(), a_loop.blocks.end(), header.predecessors[k]))
+                        {
+                            assigned = assigned && value.operands[k] != -1 && !a_ssa.maybeUnassigned(value.operands[k]);
+                        }
+                    }
+                    if (assigned)
+                    {
+                        result[value.variable] = {};
+                    }
+                }
+
+                for (int32_t block : a_loop.blocks)
+                {
+                    for (int32_t i = a_cfg.block(block).begin; i < a_cfg.block(block).end; ++i)
+                    {
+                        auto found = result.find(a_ssa.defined(code[i]));
+                        if (found == result.end())
+                        {
+                            continue;
+                        }
+
+                        int32_t first = i - 3;
+                        bool update = code[i].opcode == Opcode::STORE_INT && first >= a_cfg.block(block).begin
+                            && (code[i - 1].opcode == Opcode::ADD_INT || code[i - 1].opcode == Opcode::SUB_INT);
+
+                        int32_t load = first;
+                        if (update && code[i - 1].opcode == Opcode::ADD_INT && code[first].opcode == Opcode::PUSH_INT)
+                        {
+                            load = first + 1;
+                        }
+                        int32_t step = (load == first) ? first + 1 : first;
+
+                        if (update && code[load].opcode == Opcode::LOAD_INT && code[load].operand == code[i].operand
+                            && code[step].opcode == Opcode::PUSH_INT)
+                        {
+                            uint32_t amount = static_cast<uint32_t>(code[step].operand);
+                            found->second.push_back(Update{i, wrap(code[i - 1].opcode == Opcode::ADD_INT ? amount : 0u - amount)});
+                        }
+                        else
+                        {
+                            result.erase(found);
+                        }
+                    }
+                }
+
+                return result;
+            }
+
+            // Replaces multiplications of an induction variable by a constant with a temporary
+            // that is bumped next to every update of the variable.
+            bool reduce(const ControlFlowGraph& a_cfg, const SsaForm& a_ssa, ExpressionTrees& a_trees, const Loop& a_loop, Rewrite& a_rewrite)
+            {
+                std::map<int32_t, std::vector<Update>> variables = inductionVariables(a_cfg, a_ssa, a_loop);
+                if (variables.empty())
+                {
+                    return false;
+                }
+
+                const std::vector<Instruction>& code = m_program.code();
+                std::vector<Instruction> preheader{};
+                std::map<std::tuple<int32_t, int32_t, int32_t>, int32_t> reduced{};
+
+                for (int32_t block : a_loop.blocks)
+                {
+                    std::map<int32_t, Affine> affine{};
+                    std::vector<Expression> nodes = a_trees.build(block, [&](int32_t a_index, const std::vector<Expression>& a_operands)
+                    {
+                        const Instruction& instruction = code[a_index];
+                        std::vector<Affine> operands{};
+                        for (const Expression& operand : a_operands)
+                        {
+                            auto found = affine.find(operand.end);
+                            if (found == affine.end() || operand.type != Token::Type::INT)
+                            {
+                                return;
+                            }
+                            operands.push_back(found->second);
+                        }
+
+                        switch (instruction.opcode)
+                        {
+                            case Opcode::PUSH_INT:
+                                affine[a_index + 1] = Affine{-1, 0, instruction.operand};
+                                break;
+                            case Opcode::LOAD_INT:
+                                if (variables.contains(a_ssa.usedVariable(instruction)))
+                                {
+                                    affine[a_index + 1] = Affine{a_ssa.usedVariable(instruction), 1, 0};
+                                }
+                                break;
+                            case Opcode::NEG_INT:
+                                affine[a_index + 1] = Affine{operands[0].variable, wrap(0u - static_cast<uint32_t>(operands[0].scale)),
+                                    wrap(0u - static_cast<uint32_t>(operands[0].offset))};
+                                break;
+                            case Opcode::ADD_INT:
+                            case Opcode::SUB_INT:
+                            {
+                                const Affine& left  = operands[0];
+                                const Affine& right = operands[1];
+                                if (left.variable != -1 && right.variable != -1 && left.variable != right.variable)
+                                {
+                                    break;
+                                }
+
+                                uint32_t sign = (instruction.opcode == Opcode::ADD_INT) ? 1u : 0u - 1u;
+                                affine[a_index + 1] = Affine{std::max(left.variable, right.variable),
+                                    wrap(static_cast<uint32_t>(left.scale) + sign * static_cast<uint32_t>(right.scale)),
+                                    wrap(static_cast<uint32_t>(left.offset) + sign * static_cast<uint32_t>(right.offset))};
+                                break;
+                            }
+                            case Opcode::MUL_INT:
+                            {
+                                const Affine& left  = operands[0];
+                                const Affine& right = operands[1];
+                                if (left.variable != -1 && right.variable != -1)
+                                {
+                                    break;
+                                }
+
+                                const Affine& constant = (left.variable == -1) ? left : right;
+                                const Affine& other    = (left.variable == -1) ? right : left;
+                                uint32_t factor = static_cast<uint32_t>(constant.offset);
+                                affine[a_index + 1] = Affine{other.variable, wrap(factor * static_cast<uint32_t>(other.scale)),
+                                    wrap(factor * static_cast<uint32_t>(other.offset))};
+                                break;
+                            }
+                            default:
+                                break;
+                        }
+                    });
+
+                    std::sort(nodes.begin(), nodes.end(), [](const Expression& a_left, const Expression& a_right)
+                    {
+                        return a_left.begin != a_right.begin ? a_left.begin < a_right.begin : a_left.end > a_right.end;
+                    });
+
+                    int32_t replacedEnd = -1;
+                    for (const Expression& node : nodes)
+                    {
+                        auto found = affine.find(node.end);
+                        if (!node.replaceable || node.end - node.begin < 3 || node.begin < replacedEnd || found == affine.end())
+                        {
+                            continue;
+                        }
+
+                        const Affine& form = found->second;
+                        if (form.variable == -1 || form.scale == 0 || form.scale == 1 || form.scale == -1)
+                        {
+                            continue;
+                        }
+
+                        auto [slot, inserted] = reduced.emplace(std::make_tuple(form.variable, form.scale, form.offset), 0);
+                        if (inserted)
+                        {
+                            slot->second = temporary("iv", Token::Type::INT);
+
+                            preheader.push_back(Instruction{Opcode::LOAD_INT, 0, form.variable});
+                            preheader.push_back(Instruction{Opcode::PUSH_INT, 0, form.scale});
+                            preheader.push_back(Instruction{Opcode::MUL_INT, 0, 0});
+                            if (form.offset != 0)
+                            {
+                                preheader.push_back(Instruction{Opcode::PUSH_INT, 0, form.offset});
+                                preheader.push_back(Instruction{Opcode::ADD_INT, 0, 0});
+                            }
+                            preheader.push_back(Instruction{Opcode::STORE_INT, 0, slot->second});
+
+                            for (const Update& update : variables[form.variable])
+                            {
+                                a_rewrite.insertAfter(update.store, Instruction{Opcode::LOAD_INT, 0, slot->second});
+                                a_rewrite.insertAfter(update.store, Instruction{Opcode::PUSH_INT, 0,
+                                    wrap(static_cast<uint32_t>(form.scale) * static_cast<uint32_t>(update.step))});
+                                a_rewrite.insertAfter(update.store, Instruction{Opcode::ADD_INT, 0, 0});
+                                a_rewrite.insertAfter(update.store, Instruction{Opcode::STORE_INT, 0, slot->second});
+                            }
+                            ++m_reduced;
+                        }
+
+                        a_rewrite.replace(node.begin, {Instruction{Opcode::LOAD_INT, 0, slot->second}});
+                        for (int32_t i = node.begin + 1; i < node.end; ++i)
+                        {
+                            a_rewrite.remove(i);
+                        }
+                        replacedEnd = node.end;
+                    }
+                }
+
+                a_rewrite.insertBefore(a_cfg.block(a_loop.header).begin, preheader);
+                return a_rewrite.changed();
+            }
+
+            bool transformOne()
+            {
+                ControlFlowGraph cfg{m_program};
+                SsaForm ssa{cfg};
+                Verifier verifier{m_program};
+                verifier.verify();
+                ExpressionTrees trees{cfg, ssa, verifier.depths()};
+
+                for (const Loop& loop : cfg.loops())
+                {
+                    if (!hasPreheader(cfg, verifier, loop))
+                    {
+                        continue;
+                    }
+
+                    Rewrite rewrite{m_program};
+                    if (hoist(cfg, ssa, trees, loop, rewrite) || reduce(cfg, ssa, trees, loop, rewrite))
+                    {
+                        rewrite.apply(m_program);
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            // while (c) s compiles to c; JUMP_FALSE exit; s; JUMP top. A copy of the test replaces the
+            // back jump, so the loop body ends in c; JUMP_TRUE s and saves a dispatch per iteration.
+            bool invert()
+            {
+                ControlFlowGraph cfg{m_program};
+                Verifier verifier{m_program};
+                verifier.verify();
+
+                const std::vector<Instruction>& code = m_program.code();
+                Rewrite rewrite{m_program};
+
+                for (const Loop& loop : cfg.loops())
+                {
+                    const BasicBlock& header = cfg.block(loop.header);
+                    int32_t test  = header.end - 1;
+                    int32_t latch = cfg.block(loop.latches.front()).end - 1;
+                    Opcode opcode = code[test].opcode;
+
+                    if (loop.latches.size() != 1 || verifier.depths()[header.begin] != 0 || test - header.begin > s_inversionLimit
+                        || (opcode != Opcode::JUMP_FALSE && opcode != Opcode::JUMP_TRUE)
+                        || std::binary_search(loop.blocks.begin(), loop.blocks.end(), cfg.blockOf(code[test].operand))
+                        || code[latch].opcode != Opcode::JUMP)
+                    {
+                        continue;
+                    }
+
+                    std::vector<Instruction> bottom(code.begin() + header.begin, code.begin() + test);
+                    bottom.push_back(Instruction{opcode, 0, test + 1});
+                    negate(bottom, test > header.begin);
+                    if (code[test].operand != latch + 1)
+                    {
+                        bottom.push_back(Instruction{Opcode::JUMP, 0, code[test].operand});
+                    }
+
+                    rewrite.replace(latch, bottom);
+                    ++m_inverted;
+                }
+
+                rewrite.apply(m_program);
+                return rewrite.changed();
+            }
+
+            // Copies small bottom-tested innermost loops; every copy but the last leaves through the
+            // negated test, so only one iteration in the unroll factor jumps back. The factor shrinks
+            // with the body to keep each loop under s_unrollBudget instructions.
+            bool unroll()
+            {
+                if (m_unrollFactor < 2)
+                {
+                    return false;
+                }
+
+                ControlFlowGraph cfg{m_program};
+                Verifier verifier{m_program};
+                verifier.verify();
+
+                struct Range
+                {
+                    int32_t begin{};
+                    int32_t test{};
+                    int32_t copies{};
+                    bool    compared{};
+                };
+
+                const std::vector<Instruction>& code = m_program.code();
+                std::vector<Loop> loops = cfg.loops();
+                std::vector<Range> ranges{};
+
+                for (const Loop& loop : loops)
+                {
+                    bool innermost = std::none_of(loops.begin(), loops.end(), [&](const Loop& a_other)
+                    {
+                        return a_other.header != loop.header && std::binary_search(loop.blocks.begin(), loop.blocks.end(), a_other.header);
+                    });
+
+                    const BasicBlock& header = cfg.block(loop.header);
+                    int32_t latch = loop.latches.front();
+                    int32_t test  = cfg.block(latch).end - 1;
+                    Opcode opcode = code[test].opcode;
+
+                    if (!innermost || loop.latches.size() != 1 || verifier.depths()[header.begin] != 0
+                        || (opcode != Opcode::JUMP_FALSE && opcode != Opcode::JUMP_TRUE) || code[test].operand != header.begin
+                        || loop.blocks.front() != loop.header || loop.blocks.back() != latch
+                        || static_cast<int32_t>(loop.blocks.size()) != latch - loop.header + 1)
+                    {
+                        continue;
+                    }
+
+                    int32_t copies = std::min(m_unrollFactor, s_unrollBudget / (test - header.begin + 1));
+                    if (copies >= 2)
+                    {
+                        ranges.push_back(Range{header.begin, test, copies, test > cfg.block(latch).begin});
+                    }
+                }
+
+                if (ranges.empty())
+                {
+                    return false;
+                }
+
+                std::sort(ranges.begin(), ranges.end(), [](const Range& a_left, const Range& a_right)
+                {
+                    return a_left.begin < a_right.begin;
+                });
+
+                std::vector<int32_t> newIndex(code.size() + 1);
+                int32_t offset = 0;
+                for (size_t i = 0, r = 0; i <= code.size(); ++i)
+                {
+                    newIndex[i] = i + offset;
+                    if (r < ranges.size() && static_cast<int32_t>(i) == ranges[r].test)
+                    {
+                        offset += (ranges[r].copies - 1) * (ranges[r].test - ranges[r].begin + 1);
+                        ++r;
+                    }
+                }
+
+                std::vector<Instruction> result{};
+                for (size_t i = 0, r = 0; i < code.size(); ++i)
+                {
+                    if (r == ranges.size() || static_cast<int32_t>(i) != ranges[r].begin)
+                    {
+                        result.push_back(code[i]);
+                        if (isJump(code[i].opcode))
+                        {
+                            result.back().operand = newIndex[code[i].operand];
+                        }
+                        continue;
+                    }
+
+                    const Range& range = ranges[r++];
+                    int32_t length = range.test - range.begin + 1;
+                    for (int32_t copy = 0; copy < range.copies; ++copy)
+                    {
+                        for (int32_t j = range.begin; j <= range.test; ++j)
+                        {
+                            Instruction instruction = code[j];
+                            if (j == range.test && copy + 1 < range.copies)
+                            {
+                                result.push_back(Instruction{instruction.opcode, 0, newIndex[range.test + 1]});
+                                negate(result, range.compared);
+                                continue;
+                            }
+                            if (isJump(instruction.opcode) && instruction.operand > range.begin && instruction.operand <= range.test)
+                            {
+                                instruction.operand = newIndex[range.begin] + copy * length + (instruction.operand - range.begin);
+                            }
+                            else if (isJump(instruction.opcode))
+                            {
+                                instruction.operand = newIndex[instruction.operand];
+                            }
+                            result.push_back(instruction);
+                        }
+                    }
+
+                    m_unrolled += range.copies - 1;
+                    i = range.test;
+                }
+
+                m_program.code() = std::move(result);
+                return true;
+            }
+
+        public:
+
+            LoopOptimizer(const Program& a_program, int32_t a_unrollFactor = s_defaultUnrollFactor)
+                : m_program(a_program), m_unrollFactor(a_unrollFactor)
+            {
+            }
+
+            Program optimize()
+            {
+                m_loops = ControlFlowGraph(m_program).loops().size();
+
+                for (size_t round = 0; round < 16 * m_loops && transformOne(); ++round)
+                {
+                }
+
+                if (m_unrollFactor > 0)
+                {
+                    invert();
+                    unroll();
+                }
+
+                m_program = Optimizer(m_program).optimize();
+                m_program.setMaxDepth(Verifier(m_program).verify());
+                return m_program;
+            }
+
+            size_t loops() const
+            {
+                return m_loops;
+            }
+
+            size_t hoisted() const
+            {
+                return m_hoisted;
+            }
+
+            size_t reduced() const
+            {
+                return m_reduced;
+            }
+
+            size_t inverted() const
+            {
+                return m_inverted;
+            }
+
+            size_t unrolled() const
+            {
+                return m_unrolled;
+            }
+    };
+}
+
+#endif // LOOP_OPTIMIZER_HPP
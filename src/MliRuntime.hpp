@@ -0,0 +1,81 @@
+#ifndef MLI_RUNTIME_HPP
+#define MLI_RUNTIME_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#include "InputBuffer.hpp"
+#include "OutputBuffer.hpp"
+
+namespace mli_rt {
+
+    [[noreturn]] inline void unassigned()
+    {
+        throw std::runtime_error("variable is not assigned");
+    }
+
+    [[noreturn]] inline void divisionByZero()
+    {
+        throw std::runtime_error("division by zero");
+    }
+
+    inline int32_t wrap(int64_t a_value)
+    {
+        return static_cast<int32_t>(static_cast<uint32_t>(a_value));
+    }
+
+    inline int32_t readInt()
+    {
+        return mli::InputBuffer::standard().readInt();
+    }
+
+    inline double readReal()
+    {
+        return mli::InputBuffer::standard().readReal();
+    }
+
+    inline std::string readString()
+    {
+        return mli::InputBuffer::standard().readString();
+    }
+
+    inline void write(int32_t a_value)
+    {
+        mli::OutputBuffer::standard().write(a_value);
+    }
+
+    inline void write(double a_value)
+    {
+        mli::OutputBuffer::standard().write(std::isnan(a_value) ? std::numeric_limits<double>::quiet_NaN() : a_value);
+    }
+
+    inline void write(const std::string& a_value)
+    {
+        mli::OutputBuffer::standard().write(a_value);
+    }
+
+    template<typename Program>
+    int run(Program a_program)
+    {
+        try
+        {
+            a_program();
+            mli::OutputBuffer::standard().flush();
+        }
+        catch (const std::exception& error)
+        {
+            mli::OutputBuffer::standard().flush();
+            std::cerr << error.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+}
+
+#endif // MLI_RUNTIME_HPP
@@ -0,0 +1,127 @@
+#ifndef OPCODE_PROFILE_HPP
+#define OPCODE_PROFILE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <vector>
+
+#include "Bytecode.hpp"
+
+namespace mli {
+
+    class OpcodeProfile
+    {
+        private:
+#define MLI_OPCODE_COUNT(name) + 1
+            static constexpr size_t s_opcodes = 0 MLI_OPCODES(MLI_OPCODE_COUNT);
+#undef MLI_OPCODE_COUNT
+
+            std::vector<uint64_t> m_pairs;
+            std::vector<uint64_t> m_singles;
+            std::vector<uint64_t> m_executed;
+            std::vector<uint64_t> m_taken;
+            uint64_t              m_dispatches{};
+            Opcode                m_previous{Opcode::HALT};
+            int32_t               m_previousIndex{};
+            bool                  m_hasPrevious{};
+
+        public:
+
+            OpcodeProfile()
+                : m_pairs(s_opcodes * s_opcodes), m_singles(s_opcodes)
+            {
+            }
+
+            void record(Opcode a_opcode, int32_t a_index)
+            {
+                ++m_dispatches;
+                ++m_singles[static_cast<size_t>(a_opcode)];
+
+                if (m_hasPrevious)
+                {
+                    ++m_pairs[static_cast<size_t>(m_previous) * s_opcodes + static_cast<size_t>(a_opcode)];
+                }
+
+                // A jump is taken when the next dispatch is not the instruction after it.
+                if (m_hasPrevious && isJump(m_previous))
+                {
+                    if (static_cast<size_t>(m_previousIndex) >= m_executed.size())
+                    {
+                        m_executed.resize(m_previousIndex + 1);
+                        m_taken.resize(m_previousIndex + 1);
+                    }
+                    ++m_executed[m_previousIndex];
+                    m_taken[m_previousIndex] += (a_index != m_previousIndex + 1);
+                }
+
+                m_previous      = a_opcode;
+                m_previousIndex = a_index;
+                m_hasPrevious   = true;
+            }
+
+            void endRun()
+            {
+                m_hasPrevious = false;
+            }
+
+            uint64_t dispatches() const
+            {
+                return m_dispatches;
+            }
+
+            uint64_t count(Opcode a_opcode) const
+            {
+                return m_singles[static_cast<size_t>(a_opcode)];
+            }
+
+            uint64_t executed(int32_t a_jump) const
+            {
+                return (static_cast<size_t>(a_jump) < m_executed.size()) ? m_executed[a_jump] : 0;
+            }
+
+            uint64_t taken(int32_t a_jump) const
+            {
+                return (static_cast<size_t>(a_jump) < m_taken.size()) ? m_taken[a_jump] : 0;
+            }
+
+            uint64_t pairCount(Opcode a_first, Opcode a_second) const
+            {
+                return m_pairs[static_cast<size_t>(a_first) * s_opcodes + static_cast<size_t>(a_second)];
+            }
+
+            void report(std::ostream& a_out, size_t a_top = SIZE_MAX) const
+            {
+                std::vector<size_t> order{};
+                for (size_t i = 0; i < m_pairs.size(); ++i)
+                {
+                    if (m_pairs[i])
+                    {
+                        order.push_back(i);
+                    }
+                }
+
+                std::sort(order.begin(), order.end(), [this](size_t a_left, size_t a_right)
+                {
+                    return m_pairs[a_left] > m_pairs[a_right];
+                });
+
+                a_out << "########### PROFILE ###########\n";
+                a_out << "dispatches: " << m_dispatches << "\n";
+
+                for (size_t i = 0; i < std::min(a_top, order.size()); ++i)
+                {
+                    Opcode first  = static_cast<Opcode>(order[i] / s_opcodes);
+                    Opcode second = static_cast<Opcode>(order[i] % s_opcodes);
+
+                    a_out << std::setw(12) << m_pairs[order[i]] << "  " << std::setw(6) << std::fixed << std::setprecision(2)
+                        << 100.0 * m_pairs[order[i]] / m_dispatches << std::defaultfloat << "%  "
+                        << opcodeName(first) << " -> " << opcodeName(second) << "\n";
+                }
+                a_out << "###############################\n";
+            }
+    };
+}
+
+#endif // OPCODE_PROFILE_HPP
@@ -0,0 +1,504 @@
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "Bytecode.hpp"
+
+namespace mli {
+
+    class Optimizer
+    {
+        private:
+            Program m_program;
+            size_t  m_before{};
+
+            static int32_t wrap(int64_t a_value)
+            {
+                return static_cast<int32_t>(static_cast<uint32_t>(a_value));
+            }
+
+            static bool isPush(Opcode a_opcode)
+            {
+                return a_opcode >= Opcode::PUSH_INT && a_opcode <= Opcode::LOAD_STRING;
+            }
+
+            Instruction pushReal(double a_value)
+            {
+                return Instruction{Opcode::PUSH_REAL, 0, m_program.internReal(a_value)};
+            }
+
+            Instruction pushString(const std::string& a_value)
+            {
+                return Instruction{Opcode::PUSH_STRING, 0, m_program.internString(a_value)};
+            }
+
+            // Folds the instructions at the end of a_code, which is the optimized prefix of the program.
+            // a_pinned marks jump targets; nothing is merged into an instruction that control can enter.
+            bool foldTail(std::vector<Instruction>& a_code, std::vector<bool>& a_pinned)
+            {
+                size_t size = a_code.size();
+
+                auto loose = [&](size_t a_count)
+                {
+                    if (size < a_count)
+                    {
+                        return false;
+                    }
+
+                    for (size_t i = size - a_count + 1; i < size; ++i)
+                    {
+                        if (a_pinned[i])
+                        {
+                            return false;
+                        }
+                    }
+
+                    return true;
+                };
+
+                auto collapse = [&](size_t a_count, Instruction a_result)
+                {
+                    a_code.resize(size - a_count + 1);
+                    a_pinned.resize(size - a_count + 1);
+                    a_code.back() = a_result;
+                };
+
+                auto drop = [&](size_t a_count)
+                {
+                    a_code.resize(size - a_count);
+                    a_pinned.resize(size - a_count);
+                };
+
+                const Instruction& last = a_code.back();
+                Opcode opcode = last.opcode;
+
+                if (size >= 3 && loose(3))
+                {
+                    const Instruction& left  = a_code[size - 3];
+                    const Instruction& right = a_code[size - 2];
+                    int32_t result{};
+
+                    if (left.opcode == Opcode::PUSH_INT && right.opcode == Opcode::PUSH_INT
+                        && evaluate(opcode, left.operand, right.operand, result))
+                    {
+                        collapse(3, Instruction{Opcode::PUSH_INT, 0, result});
+                        return true;
+                    }
+
+                    if (left.opcode == Opcode::PUSH_REAL && right.opcode == Opcode::PUSH_REAL)
+                    {
+                        double l = m_program.reals()[left.operand];
+                        double r = m_program.reals()[right.operand];
+
+                        switch (opcode)
+                        {
+                            case Opcode::ADD_REAL: collapse(3, pushReal(l + r)); return true;
+                            case Opcode::SUB_REAL: collapse(3, pushReal(l - r)); return true;
+                            case Opcode::MUL_REAL: collapse(3, pushReal(l * r)); return true;
+                            case Opcode::DIV_REAL: collapse(3, pushReal(l / r)); return true;
+                            default:
+                                if (compare(opcode, Opcode::EQ_REAL, l, r, result))
+                                {
+                                    collapse(3, Instruction{Opcode::PUSH_INT, 0, result});
+                                    return true;
+                                }
+                        }
+                    }
+
+                    if (left.opcode == Opcode::PUSH_STRING && right.opcode == Opcode::PUSH_STRING
+                        && compare(opcode, Opcode::EQ_STRING, m_program.strings()[left.operand], m_program.strings()[right.operand], result))
+                    {
+                        collapse(3, Instruction{Opcode::PUSH_INT, 0, result});
+                        return true;
+                    }
+
+                    if (opcode == Opcode::TO_REAL_SECOND && left.opcode == Opcode::PUSH_INT && isPush(right.opcode))
+                    {
+                        Instruction second = right;
+                        a_code[size - 3] = pushReal(left.operand);
+                        collapse(2, second);
+                        return true;
+                    }
+                }
+
+                if (size >= 2 && loose(2))
+                {
+                    const Instruction& operand = a_code[size - 2];
+
+                    if (operand.opcode == Opcode::PUSH_INT)
+                    {
+                        int32_t value = operand.operand;
+
+                        switch (opcode)
+                        {
+                            case Opcode::NEG_INT: collapse(2, Instruction{Opcode::PUSH_INT, 0, wrap(-int64_t(value))}); return true;
+                            case Opcode::NOT:     collapse(2, Instruction{Opcode::PUSH_INT, 0, !value}); return true;
+                            case Opcode::TO_REAL: collapse(2, pushReal(value)); return true;
+                            case Opcode::POP:     drop(2); return true;
+
+                            case Opcode::JUMP_FALSE:
+                            case Opcode::JUMP_TRUE:
+                                if ((opcode == Opcode::JUMP_TRUE) == (value != 0))
+                                {
+                                    collapse(2, Instruction{Opcode::JUMP, 0, last.operand});
+                                }
+                                else
+                                {
+                                    drop(2);
+                                }
+                                return true;
+
+                            case Opcode::JUMP_FALSE_LAZY:
+                            case Opcode::JUMP_TRUE_LAZY:
+                                if ((opcode == Opcode::JUMP_TRUE_LAZY) == (value != 0))
+                                {
+                                    a_code.back().opcode = Opcode::JUMP;
+                                }
+                                else
+                                {
+                                    drop(1);
+                                }
+                                return true;
+
+                            default:
+                                break;
+                        }
+                    }
+                    else if (operand.opcode == Opcode::PUSH_REAL)
+                    {
+                        double value = m_program.reals()[operand.operand];
+
+                        switch (opcode)
+                        {
+                            case Opcode::NEG_REAL: collapse(2, pushReal(-value)); return true;
+                            case Opcode::POP:      drop(2); return true;
+                            case Opcode::TO_INT:
+                                if (value > std::numeric_limits<int32_t>::min() - 1.0 && value < std::numeric_limits<int32_t>::max() + 1.0)
+                                {
+                                    collapse(2, Instruction{Opcode::PUSH_INT, 0, static_cast<int32_t>(value)});
+                                    return true;
+                                }
+                                break;
+                            default:
+                                break;
+                        }
+                    }
+                    else if (operand.opcode == Opcode::PUSH_STRING && opcode == Opcode::POP)
+                    {
+                        drop(2);
+                        return true;
+                    }
+                }
+
+                if ((opcode == Opcode::CONCAT || opcode == Opcode::APPEND_STRING) && !a_pinned[size - 1])
+                {
+                    // Operands that are single pushes can be told apart, so adjacent literals among them merge.
+                    size_t operands = (opcode == Opcode::CONCAT) ? last.operand : last.arity;
+                    size_t window = 0;
+                    while (window < operands && window + 1 < size && isPush(a_code[size - 2 - window].opcode)
+                        && (window == 0 || !a_pinned[size - 1 - window]))
+                    {
+                        ++window;
+                    }
+
+                    size_t first = size - 1 - window;
+                    std::vector<Instruction> merged{};
+                    for (size_t i = first; i < size - 1; ++i)
+                    {
+                        if (!merged.empty() && merged.back().opcode == Opcode::PUSH_STRING && a_code[i].opcode == Opcode::PUSH_STRING)
+                        {
+                            std::string text = m_program.strings()[merged.back().operand] + m_program.strings()[a_code[i].operand];
+                            merged.back() = pushString(text);
+                        }
+                        else
+                        {
+                            merged.push_back(a_code[i]);
+                        }
+                    }
+
+                    if (merged.size() == window)
+                    {
+                        return false;
+                    }
+
+                    Instruction combined = last;
+                    if (opcode == Opcode::CONCAT)
+                    {
+                        combined.operand -= window - merged.size();
+                    }
+                    else
+                    {
+                        combined.arity -= window - merged.size();
+                    }
+
+                    a_code.resize(first);
+                    a_code.insert(a_code.end(), merged.begin(), merged.end());
+                    if (opcode == Opcode::APPEND_STRING || combined.operand > 1)
+                    {
+                        a_code.push_back(combined);
+                    }
+                    a_pinned.resize(a_code.size());
+                    return true;
+                }
+
+                return false;
+            }
+
+            bool fold()
+            {
+                std::vector<Instruction>& code = m_program.code();
+                std::vector<bool> targets = m_program.jumpTargets();
+                std::vector<int32_t> newIndex(code.size() + 1);
+                std::vector<Instruction> result{};
+                std::vector<bool> pinned{};
+                bool changed{};
+
+                for (size_t i = 0; i < code.size(); ++i)
+                {
+                    newIndex[i] = result.size();
+                    result.push_back(code[i]);
+                    pinned.push_back(targets[i]);
+
+                    while (foldTail(result, pinned))
+                    {
+                        changed = true;
+                    }
+                }
+                newIndex[code.size()] = result.size();
+
+                for (auto& instruction : result)
+                {
+                    if (isJump(instruction.opcode))
+                    {
+                        instruction.operand = newIndex[instruction.operand];
+                    }
+                }
+
+                code = std::move(result);
+                return changed;
+            }
+
+            bool thread()
+            {
+                std::vector<Instruction>& code = m_program.code();
+                std::vector<bool> targets = m_program.jumpTargets();
+                std::vector<bool> removed(code.size() + 1);
+                bool changed{};
+
+                auto destination = [&](int32_t a_target)
+                {
+                    for (size_t hops = 0; code[a_target].opcode == Opcode::JUMP && hops < code.size(); ++hops)
+                    {
+                        a_target = code[a_target].operand;
+                    }
+                    return a_target;
+                };
+
+                for (size_t i = 0; i < code.size(); ++i)
+                {
+                    Instruction& instruction = code[i];
+                    if (!isJump(instruction.opcode))
+                    {
+                        continue;
+                    }
+
+                    int32_t target = destination(instruction.operand);
+                    if (target != instruction.operand)
+                    {
+                        instruction.operand = target;
+                        changed = true;
+                    }
+
+                    if (instruction.opcode != Opcode::JUMP)
+                    {
+                        continue;
+                    }
+
+                    const Instruction& next = code[target];
+                    if (next.opcode == Opcode::HALT)
+                    {
+                        instruction = next;
+                        changed = true;
+                    }
+                    else if (i > 0 && code[i - 1].opcode == Opcode::PUSH_INT && !targets[i] && !removed[i - 1] && isJump(next.opcode))
+                    {
+                        // A constant carried into a conditional jump decides it statically.
+                        bool value = code[i - 1].operand != 0;
+
+                        if (next.opcode == Opcode::JUMP_FALSE || next.opcode == Opcode::JUMP_TRUE)
+                        {
+                            bool taken = (next.opcode == Opcode::JUMP_TRUE) == value;
+                            instruction.operand = taken ? next.operand : target + 1;
+                            removed[i - 1] = true;
+                            changed = true;
+                        }
+                        else if (next.opcode == Opcode::JUMP_FALSE_LAZY || next.opcode == Opcode::JUMP_TRUE_LAZY)
+                        {
+                            bool taken = (next.opcode == Opcode::JUMP_TRUE_LAZY) == value;
+                            instruction.operand = taken ? next.operand : target + 1;
+                            changed = true;
+                        }
+                    }
+                }
+
+                if (changed)
+                {
+                    m_program.compact(removed);
+                }
+
+                return changed;
+            }
+
+            bool prune()
+            {
+                std::vector<Instruction>& code = m_program.code();
+                std::vector<bool> reachable(code.size());
+                std::vector<int32_t> worklist{0};
+                reachable[0] = true;
+
+                while (!worklist.empty())
+                {
+                    int32_t index = worklist.back();
+                    worklist.pop_back();
+
+                    const Instruction& instruction = code[index];
+                    auto flow = [&](int32_t a_successor)
+                    {
+                        if (!reachable[a_successor])
+                        {
+                            reachable[a_successor] = true;
+                            worklist.push_back(a_successor);
+                        }
+                    };
+
+                    if (instruction.opcode != Opcode::HALT && instruction.opcode != Opcode::JUMP)
+                    {
+                        flow(index + 1);
+                    }
+                    if (isJump(instruction.opcode))
+                    {
+                        flow(instruction.operand);
+                    }
+                }
+
+                std::vector<bool> removed(code.size() + 1);
+                bool changed{};
+
+                for (size_t i = code.size(); i-- > 0;)
+                {
+                    if (!reachable[i])
+                    {
+                        removed[i] = changed = true;
+                        continue;
+                    }
+
+                    size_t next = i + 1;
+                    while (next < code.size() && removed[next])
+                    {
+                        ++next;
+                    }
+
+                    Instruction& instruction = code[i];
+                    if (!isJump(instruction.opcode) || instruction.operand != static_cast<int32_t>(next))
+                    {
+                        continue;
+                    }
+
+                    // A jump to the following instruction only has its effect on the stack left.
+                    if (instruction.opcode == Opcode::JUMP_FALSE || instruction.opcode == Opcode::JUMP_TRUE)
+                    {
+                        instruction = Instruction{Opcode::POP, 0, 0};
+                    }
+                    else
+                    {
+                        removed[i] = true;
+                    }
+                    changed = true;
+                }
+
+                if (changed)
+                {
+                    m_program.compact(removed);
+                }
+
+                return changed;
+            }
+
+        public:
+
+            static bool evaluate(Opcode a_opcode, int32_t a_left, int32_t a_right, int32_t& a_result)
+            {
+                switch (a_opcode)
+                {
+                    case Opcode::ADD_INT:     a_result = wrap(int64_t(a_left) + a_right); return true;
+                    case Opcode::SUB_INT:     a_result = wrap(int64_t(a_left) - a_right); return true;
+                    case Opcode::MUL_INT:     a_result = wrap(int64_t(a_left) * a_right); return true;
+                    case Opcode::EQ_INT:      a_result = a_left == a_right; return true;
+                    case Opcode::NEQ_INT:     a_result = a_left != a_right; return true;
+                    case Opcode::LESS_INT:    a_result = a_left < a_right; return true;
+                    case Opcode::GREATER_INT: a_result = a_left > a_right; return true;
+                    case Opcode::LEQ_INT:     a_result = a_left <= a_right; return true;
+                    case Opcode::GEQ_INT:     a_result = a_left >= a_right; return true;
+                    case Opcode::AND:         a_result = a_left && a_right; return true;
+                    case Opcode::OR:          a_result = a_left || a_right; return true;
+                    case Opcode::DIV_INT:
+                        // Division by zero is left to the engines, which report it at run time.
+                        if (a_right == 0)
+                        {
+                            return false;
+                        }
+                        a_result = wrap(int64_t(a_left) / a_right);
+                        return true;
+                    default:
+                        return false;
+                }
+            }
+
+            template<typename T>
+            static bool compare(Opcode a_opcode, Opcode a_first, const T& a_left, const T& a_right, int32_t& a_result)
+            {
+                switch (static_cast<int>(a_opcode) - static_cast<int>(a_first))
+                {
+                    case 0:  a_result = a_left == a_right; return true;
+                    case 1:  a_result = a_left != a_right; return true;
+                    case 2:  a_result = a_left < a_right;  return true;
+                    case 3:  a_result = a_left > a_right;  return true;
+                    case 4:  a_result = a_left <= a_right; return true;
+                    case 5:  a_result = a_left >= a_right; return true;
+                    default: return false;
+                }
+            }
+
+            Optimizer(const Program& a_program)
+                : m_program(a_program)
+            {
+            }
+
+            Program optimize()
+            {
+                m_before = m_program.code().size();
+
+                bool changed = true;
+                while (changed)
+                {
+                    changed  = fold();
+                    changed |= thread();
+                    changed |= prune();
+                }
+
+                m_program.setMaxDepth(Verifier(m_program).verify());
+                return m_program;
+            }
+
+            size_t before() const
+            {
+                return m_before;
+            }
+    };
+}
+
+#endif // OPTIMIZER_HPP
@@ -0,0 +1,114 @@
+#ifndef OUTPUT_BUFFER_HPP
+#define OUTPUT_BUFFER_HPP
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string_view>
+
+#include <unistd.h>
+
+namespace mli {
+
+    // The output of `write`: every value is formatted with std::to_chars into an owned buffer,
+    // which goes to std::cout's stream buffer in large blocks, so it keeps its order with
+    // anything else printed there. On a terminal every line is flushed as it is written.
+    // Engines flush when the program ends; whoever reports an error flushes first.
+    class OutputBuffer
+    {
+        public:
+            static constexpr size_t s_capacity = 1 << 16;
+
+        private:
+            std::unique_ptr<char[]> m_buffer;
+            size_t                  m_size{};
+            bool                    m_lineBuffered;
+
+            void drain()
+            {
+                std::cout.rdbuf()->sputn(m_buffer.get(), m_size);
+                m_size = 0;
+            }
+
+            char* reserve(size_t a_length)
+            {
+                if (m_size + a_length > s_capacity)
+                {
+                    drain();
+                }
+                return m_buffer.get() + m_size;
+            }
+
+            void endLine(char* a_end)
+            {
+                *a_end++ = '\n';
+                m_size = a_end - m_buffer.get();
+
+                if (m_lineBuffered)
+                {
+                    flush();
+                }
+            }
+
+        public:
+
+            OutputBuffer(bool a_lineBuffered)
+                : m_buffer(new char[s_capacity]), m_lineBuffered(a_lineBuffered)
+            {
+            }
+
+            OutputBuffer(const OutputBuffer&) = delete;
+            OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+            ~OutputBuffer()
+            {
+                flush();
+            }
+
+            static OutputBuffer& standard()
+            {
+                static OutputBuffer s_output{isatty(STDOUT_FILENO) != 0};
+                return s_output;
+            }
+
+            void write(int32_t a_value)
+            {
+                char* begin = reserve(16);
+                endLine(std::to_chars(begin, begin + 16, a_value).ptr);
+            }
+
+            // Six significant digits in the shorter of fixed and scientific notation, the default
+            // format of std::ostream. Deliberately not the shortest round-trip form: the output has
+            // to stay byte-identical to the original interpreter and to the ELF runtime's formatter.
+            void write(double a_value)
+            {
+                char* begin = reserve(32);
+                endLine(std::to_chars(begin, begin + 32, a_value, std::chars_format::general, 6).ptr);
+            }
+
+            void write(std::string_view a_value)
+            {
+                if (a_value.size() + 1 > s_capacity)
+                {
+                    drain();
+                    std::cout.rdbuf()->sputn(a_value.data(), a_value.size());
+                    endLine(m_buffer.get());
+                    return;
+                }
+
+                char* begin = reserve(a_value.size() + 1);
+                std::memcpy(begin, a_value.data(), a_value.size());
+                endLine(begin + a_value.size());
+            }
+
+            void flush()
+            {
+                drain();
+                std::cout.flush();
+            }
+    };
+}
+
+#endif // OUTPUT_BUFFER_HPP
@@ -503,8 +503,8 @@ namespace mli {
 
         public:
 
-            Parser(const std::string& a_srcFileName)
-                : m_scanner(a_srcFileName)
+            Parser(const std::string& a_srcFileName, bool a_legacyScanner = false)
+                : m_scanner(a_srcFileName, a_legacyScanner)
             {
             }
 
@@ -513,6 +513,11 @@ namespace mli {
                 return m_poliz;
             }
 
+            const std::vector<Ident>& fetchVariables() const
+            {
+                return m_validator.fetchVariables();
+            }
+
             void dumpPoliz()
             {
                 std::cout << "########### POLIZ STACK ###########\n";
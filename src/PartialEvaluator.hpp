@@ -0,0 +1,488 @@
+#ifndef PARTIAL_EVALUATOR_HPP
+#define PARTIAL_EVALUATOR_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Bytecode.hpp"
+#include "Optimizer.hpp"
+#include "VirtualMachine.hpp"
+
+namespace mli {
+
+    // Runs the program at compile time until it halts, needs an input that was not supplied
+    // ahead of time, would fail at run time, spends its budget or would write more output than
+    // fits in one literal. A program that halts is replaced by its output; otherwise the residual program writes the output so far, stores
+    // the variables and jumps to the statement where evaluation stopped, reading the inputs
+    // after the supplied ones from stdin. The optimizers then specialize it to the stored values.
+    class PartialEvaluator
+    {
+        public:
+            static constexpr uint64_t s_defaultBudget      = 1 << 20;
+            static constexpr size_t   s_defaultOutputLimit = 1 << 16;
+
+        private:
+            struct Constant
+            {
+                Token::Type type{Token::Type::INT};
+                int32_t     integer{};
+                double      real{};
+                std::string string;
+            };
+
+            Program               m_program;
+            std::string           m_inputs;
+            uint64_t              m_budget;
+            size_t                m_outputLimit;
+
+            std::istringstream    m_in;
+            VariableState         m_variables;
+            std::vector<Constant> m_stack;
+            std::string           m_output;
+            int32_t               m_pc{};
+            uint64_t              m_steps{};
+            uint64_t              m_spent{};
+            uint64_t              m_clean{};
+            size_t                m_consumed{};
+            bool                  m_halted{};
+
+            static Constant integer(int32_t a_value)
+            {
+                return Constant{Token::Type::INT, a_value};
+            }
+
+            static Constant real(double a_value)
+            {
+                return Constant{Token::Type::REAL, 0, a_value};
+            }
+
+            static Constant string(std::string a_value)
+            {
+                return Constant{Token::Type::STRING, 0, 0.0, std::move(a_value)};
+            }
+
+            Constant pop()
+            {
+                Constant value = std::move(m_stack.back());
+                m_stack.pop_back();
+                return value;
+            }
+
+            template<typename T>
+            bool read(T& a_value)
+            {
+                if (!(m_in >> a_value))
+                {
+                    return false;
+                }
+                ++m_consumed;
+                return true;
+            }
+
+            // Executes one instruction; false leaves it for run time.
+            bool step(const Instruction& a_instruction)
+            {
+                Opcode  opcode  = a_instruction.opcode;
+                int32_t operand = a_instruction.operand;
+                int32_t next    = m_pc + 1;
+                int32_t result{};
+
+                switch (opcode)
+                {
+                    case Opcode::PUSH_INT:    m_stack.push_back(integer(operand)); break;
+                    case Opcode::PUSH_REAL:   m_stack.push_back(real(m_program.reals()[operand])); break;
+                    case Opcode::PUSH_STRING: m_stack.push_back(string(m_program.strings()[operand])); break;
+
+                    case Opcode::LOAD_INT:
+                        if (!m_variables.intAssigned[operand])
+                        {
+                            return false;
+                        }
+                        m_stack.push_back(integer(m_variables.ints[operand]));
+                        break;
+
+                    case Opcode::LOAD_REAL:
+                        if (!m_variables.realAssigned[operand])
+                        {
+                            return false;
+                        }
+                        m_stack.push_back(real(m_variables.reals[operand]));
+                        break;
+
+                    case Opcode::LOAD_STRING:
+                        if (!m_variables.stringAssigned[operand])
+                        {
+                            return false;
+                        }
+                        m_stack.push_back(string(m_variables.strings[operand]));
+                        m_spent += m_stack.back().string.size();
+                        break;
+
+                    case Opcode::STORE_INT:
+                    case Opcode::STORE_KEEP_INT:
+                        m_variables.ints[operand]        = m_stack.back().integer;
+                        m_variables.intAssigned[operand] = true;
+                        break;
+
+                    case Opcode::STORE_REAL:
+                    case Opcode::STORE_KEEP_REAL:
+                        m_variables.reals[operand]        = m_stack.back().real;
+                        m_variables.realAssigned[operand] = true;
+                        break;
+
+                    case Opcode::STORE_STRING:
+                    case Opcode::STORE_KEEP_STRING:
+                        m_variables.strings[operand]        = m_stack.back().string;
+                        m_variables.stringAssigned[operand] = true;
+                        break;
+
+                    case Opcode::READ_INT:
+                    {
+                        int value{};
+                        if (!read(value))
+                        {
+                            return false;
+                        }
+                        m_variables.ints[operand]        = value;
+                        m_variables.intAssigned[operand] = true;
+                        break;
+                    }
+
+                    case Opcode::READ_REAL:
+                    {
+                        double value{};
+                        if (!read(value))
+                        {
+                            return false;
+                        }
+                        m_variables.reals[operand]        = value;
+                        m_variables.realAssigned[operand] = true;
+                        break;
+                    }
+
+                    case Opcode::READ_STRING:
+                    {
+                        std::string value{};
+                        if (!read(value))
+                        {
+                            return false;
+                        }
+                        m_variables.strings[operand]        = std::move(value);
+                        m_variables.stringAssigned[operand] = true;
+                        break;
+                    }
+
+                    case Opcode::APPEND_STRING:
+                    {
+                        if (!m_variables.stringAssigned[operand])
+                        {
+                            return false;
+                        }
+                        std::string& target = m_variables.strings[operand];
+                        for (size_t i = m_stack.size() - a_instruction.arity; i < m_stack.size(); ++i)
+                        {
+                            target += m_stack[i].string;
+                        }
+                        m_stack.resize(m_stack.size() - a_instruction.arity);
+                        m_spent += target.size();
+                        break;
+                    }
+
+                    case Opcode::CONCAT:
+                    {
+                        size_t first = m_stack.size() - operand;
+                        for (size_t i = first + 1; i < m_stack.size(); ++i)
+                        {
+                            m_stack[first].string += m_stack[i].string;
+                        }
+                        m_stack.resize(first + 1);
+                        m_spent += m_stack.back().string.size();
+                        break;
+                    }
+
+                    case Opcode::WRITE:
+                    {
+                        const Constant& value = m_stack.back();
+                        std::ostringstream text{};
+                        if (value.type == Token::Type::STRING)
+                        {
+                            text << value.string;
+                        }
+                        else if (value.type == Token::Type::REAL)
+                        {
+                            text << Value::fromReal(value.real).asReal();
+                        }
+                        else
+                        {
+                            text << value.integer;
+                        }
+                        if (m_output.size() + text.str().size() + 1 > m_outputLimit)
+                        {
+                            return false;
+                        }
+                        m_stack.pop_back();
+                        m_output += text.str() + "\n";
+                        m_spent += text.str().size();
+                        break;
+                    }
+
+                    case Opcode::POP:
+                        m_stack.pop_back();
+                        break;
+
+                    case Opcode::TO_INT:
+                    {
+                        double value = m_stack.back().real;
+                        if (!(value > std::numeric_limits<int32_t>::min() - 1.0 && value < std::numeric_limits<int32_t>::max() + 1.0))
+                        {
+                            return false;
+                        }
+                        m_stack.back() = integer(static_cast<int32_t>(value));
+                        break;
+                    }
+
+                    case Opcode::TO_REAL:
+                        m_stack.back() = real(m_stack.back().integer);
+                        break;
+
+                    case Opcode::TO_REAL_SECOND:
+                        m_stack[m_stack.size() - 2] = real(m_stack[m_stack.size() - 2].integer);
+                        break;
+
+                    case Opcode::NEG_INT:
+                        m_stack.back().integer = static_cast<int32_t>(0u - static_cast<uint32_t>(m_stack.back().integer));
+                        break;
+
+                    case Opcode::NEG_REAL:
+                        m_stack.back().real = -m_stack.back().real;
+                        break;
+
+                    case Opcode::NOT:
+                        m_stack.back().integer = !m_stack.back().integer;
+                        break;
+
+                    case Opcode::ADD_REAL:
+                    case Opcode::SUB_REAL:
+                    case Opcode::MUL_REAL:
+                    case Opcode::DIV_REAL:
+                    {
+                        double right = pop().real;
+                        double& left = m_stack.back().real;
+                        left = (opcode == Opcode::ADD_REAL) ? left + right
+                            : (opcode == Opcode::SUB_REAL) ? left - right
+                            : (opcode == Opcode::MUL_REAL) ? left * right : left / right;
+                        break;
+                    }
+
+                    case Opcode::JUMP:
+                        next = operand;
+                        break;
+
+                    case Opcode::JUMP_FALSE:
+                    case Opcode::JUMP_TRUE:
+                        next = ((pop().integer != 0) == (opcode == Opcode::JUMP_TRUE)) ? operand : next;
+                        break;
+
+                    case Opcode::JUMP_FALSE_LAZY:
+                    case Opcode::JUMP_TRUE_LAZY:
+                        next = ((m_stack.back().integer != 0) == (opcode == Opcode::JUMP_TRUE_LAZY)) ? operand : next;
+                        break;
+
+                    default:
+                    {
+                        if (isFused(opcode))
+                        {
+                            throw std::runtime_error("[PartialEvaluator]: superinstructions must be evaluated before fusion");
+                        }
+
+                        // DIV_INT by zero is the only binary operation the optimizer refuses to fold.
+                        const Constant& left  = m_stack[m_stack.size() - 2];
+                        const Constant& right = m_stack.back();
+                        bool known = (opcode >= Opcode::EQ_REAL && opcode <= Opcode::GEQ_REAL)
+                            ? Optimizer::compare(opcode, Opcode::EQ_REAL, left.real, right.real, result)
+                            : (opcode >= Opcode::EQ_STRING && opcode <= Opcode::GEQ_STRING)
+                            ? Optimizer::compare(opcode, Opcode::EQ_STRING, left.string, right.string, result)
+                            : Optimizer::evaluate(opcode, left.integer, right.integer, result);
+
+                        if (!known)
+                        {
+                            return false;
+                        }
+                        m_stack.pop_back();
+                        m_stack.back() = integer(result);
+                        break;
+                    }
+                }
+
+                if (opcode >= Opcode::STORE_INT && opcode <= Opcode::STORE_STRING)
+                {
+                    m_stack.pop_back();
+                }
+
+                m_pc = next;
+                return true;
+            }
+
+            // Evaluates until the operand stack is empty after a_limit steps or the budget is
+            // spent, or until an instruction has to be left for run time.
+            void run(uint64_t a_limit)
+            {
+                const std::vector<Instruction>& code = m_program.code();
+
+                m_in.clear();
+                m_in.str(m_inputs);
+                m_variables = VariableState{
+                    std::vector<int32_t>(m_program.intSlots()), std::vector<double>(m_program.realSlots()),
+                    std::vector<std::string>(m_program.stringSlots()), std::vector<uint8_t>(m_program.intSlots()),
+                    std::vector<uint8_t>(m_program.realSlots()), std::vector<uint8_t>(m_program.stringSlots())
+                };
+                m_stack.clear();
+                m_output.clear();
+                m_pc     = 0;
+                m_halted = false;
+                m_steps  = m_spent = m_clean = m_consumed = 0;
+
+                for (;;)
+                {
+                    if (m_stack.empty())
+                    {
+                        m_clean = m_steps;
+                        if (m_steps >= a_limit || m_spent >= m_budget)
+                        {
+                            return;
+                        }
+                    }
+
+                    if (code[m_pc].opcode == Opcode::HALT)
+                    {
+                        m_halted = true;
+                        return;
+                    }
+                    if (!step(code[m_pc]))
+                    {
+                        return;
+                    }
+
+                    ++m_steps;
+                    ++m_spent;
+                }
+            }
+
+        public:
+
+            // a_inputs holds the first inputs of every run, in the format read from stdin.
+            PartialEvaluator(const Program& a_program, std::string a_inputs = {}, uint64_t a_budget = s_defaultBudget,
+                             size_t a_outputLimit = s_defaultOutputLimit)
+                : m_program(a_program), m_inputs(std::move(a_inputs)), m_budget(a_budget), m_outputLimit(a_outputLimit)
+            {
+            }
+
+            static std::string load(const std::string& a_fileName)
+            {
+                std::ifstream in{a_fileName};
+                if (!in)
+                {
+                    throw std::runtime_error("[PartialEvaluator]: cannot open " + a_fileName);
+                }
+                return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            }
+
+            Program evaluate()
+            {
+                // Residual code can only enter the program between statements, so a stop with
+                // operands on the stack is replayed up to the last point where it was empty.
+                run(std::numeric_limits<uint64_t>::max());
+                if (!m_stack.empty())
+                {
+                    run(m_clean);
+                }
+
+                if (m_steps == 0 && !m_halted)
+                {
+                    return m_program;
+                }
+
+                std::vector<Instruction> code{};
+                if (!m_output.empty())
+                {
+                    m_output.pop_back();
+                    code.push_back(Instruction{Opcode::PUSH_STRING, 0, m_program.internString(m_output)});
+                    code.push_back(Instruction{Opcode::WRITE});
+                }
+
+                if (m_halted)
+                {
+                    code.push_back(Instruction{Opcode::HALT});
+                    m_program.code() = std::move(code);
+                    m_program.setMaxDepth(Verifier(m_program).verify());
+                    return m_program;
+                }
+
+                for (int32_t slot = 0; slot < m_program.intSlots(); ++slot)
+                {
+                    if (m_variables.intAssigned[slot])
+                    {
+                        code.push_back(Instruction{Opcode::PUSH_INT, 0, m_variables.ints[slot]});
+                        code.push_back(Instruction{Opcode::STORE_INT, 0, slot});
+                    }
+                }
+                for (int32_t slot = 0; slot < m_program.realSlots(); ++slot)
+                {
+                    if (m_variables.realAssigned[slot])
+                    {
+                        code.push_back(Instruction{Opcode::PUSH_REAL, 0, m_program.internReal(m_variables.reals[slot])});
+                        code.push_back(Instruction{Opcode::STORE_REAL, 0, slot});
+                    }
+                }
+                for (int32_t slot = 0; slot < m_program.stringSlots(); ++slot)
+                {
+                    if (m_variables.stringAssigned[slot])
+                    {
+                        code.push_back(Instruction{Opcode::PUSH_STRING, 0, m_program.internString(m_variables.strings[slot])});
+                        code.push_back(Instruction{Opcode::STORE_STRING, 0, slot});
+                    }
+                }
+
+                int32_t offset = code.size() + 1;
+                code.push_back(Instruction{Opcode::JUMP, 0, m_pc + offset});
+                for (Instruction instruction : m_program.code())
+                {
+                    instruction.operand += isJump(instruction.opcode) ? offset : 0;
+                    code.push_back(instruction);
+                }
+
+                m_program.code() = std::move(code);
+                m_program.setMaxDepth(Verifier(m_program).verify());
+                return m_program;
+            }
+
+            uint64_t evaluated() const
+            {
+                return m_steps;
+            }
+
+            size_t consumed() const
+            {
+                return m_consumed;
+            }
+
+            bool folded() const
+            {
+                return m_halted;
+            }
+
+            // The instruction of the original program the residual program resumes at.
+            int32_t resumed() const
+            {
+                return m_pc;
+            }
+    };
+}
+
+#endif // PARTIAL_EVALUATOR_HPP
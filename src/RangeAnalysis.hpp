@@ -0,0 +1,475 @@
+#ifndef RANGE_ANALYSIS_HPP
+#define RANGE_ANALYSIS_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "Bytecode.hpp"
+#include "ControlFlow.hpp"
+#include "Ssa.hpp"
+
+namespace mli {
+
+    // A closed interval of int values, empty when low > high. A non-zero range
+    // also excludes 0 when it lies inside the bounds.
+    struct Range
+    {
+        int64_t low{1};
+        int64_t high{0};
+        bool    nonZero{};
+
+        static Range full()
+        {
+            return Range{INT32_MIN, INT32_MAX};
+        }
+
+        static Range point(int64_t a_value)
+        {
+            return Range{a_value, a_value};
+        }
+
+        bool empty() const
+        {
+            return low > high;
+        }
+
+        bool fits() const
+        {
+            return low >= INT32_MIN && high <= INT32_MAX;
+        }
+
+        bool mayBeZero() const
+        {
+            return !empty() && !nonZero && low <= 0 && high >= 0;
+        }
+
+        Range join(const Range& a_other) const
+        {
+            if (empty() || a_other.empty())
+            {
+                return empty() ? a_other : *this;
+            }
+            return Range{std::min(low, a_other.low), std::max(high, a_other.high), !mayBeZero() && !a_other.mayBeZero()};
+        }
+
+        Range meet(const Range& a_other) const
+        {
+            Range result{std::max(low, a_other.low), std::min(high, a_other.high), nonZero || a_other.nonZero};
+            if (result.nonZero && result.low == 0)
+            {
+                result.low = 1;
+            }
+            if (result.nonZero && result.high == 0)
+            {
+                result.high = -1;
+            }
+            return result;
+        }
+
+        bool operator==(const Range& a_other) const
+        {
+            return (empty() && a_other.empty())
+                || (low == a_other.low && high == a_other.high && mayBeZero() == a_other.mayBeZero());
+        }
+    };
+
+    // Interval analysis of the int variables over the SSA form. Integer comparisons narrow the
+    // variables they test on the blocks they dominate and the edges they leave by; values are
+    // widened until the ranges settle and narrowed again afterwards. Divisions whose divisor
+    // cannot be zero lose their check, and int arithmetic that provably never wraps is marked exact.
+    class RangeAnalysis
+    {
+        private:
+            struct Entry
+            {
+                Range   range;
+                int32_t value{-1};
+            };
+
+            struct Condition
+            {
+                Opcode opcode{Opcode::HALT};
+                Entry  left;
+                Entry  right;
+            };
+
+            using Facts = std::vector<std::pair<int32_t, Range>>;
+
+            static constexpr int32_t s_wideningUpdates = 3;
+            static constexpr int32_t s_narrowingPasses = 2;
+
+            Program                m_program;
+            std::vector<int64_t>   m_thresholds;
+            std::vector<Range>     m_ranges;
+            std::vector<int32_t>   m_updates;
+            std::vector<Facts>     m_facts;
+            std::vector<Condition> m_conditions;
+            bool                   m_widening{};
+            bool                   m_changed{};
+            size_t                 m_checked{};
+            size_t                 m_unchecked{};
+            size_t                 m_exact{};
+            size_t                 m_wrapping{};
+
+            void update(int32_t a_value, Range a_range)
+            {
+                Range& current = m_ranges[a_value];
+                if (m_widening)
+                {
+                    a_range = current.join(a_range);
+                    if (!current.empty() && ++m_updates[a_value] > s_wideningUpdates)
+                    {
+                        a_range.low  = (a_range.low < current.low) ? *--std::upper_bound(m_thresholds.begin(), m_thresholds.end(), a_range.low) : a_range.low;
+                        a_range.high = (a_range.high > current.high) ? *std::lower_bound(m_thresholds.begin(), m_thresholds.end(), a_range.high) : a_range.high;
+                    }
+                }
+
+                if (!(current == a_range))
+                {
+                    current   = a_range;
+                    m_changed = true;
+                }
+            }
+
+            Range rangeOf(int32_t a_value, const Facts& a_facts) const
+            {
+                Range range = m_ranges[a_value];
+                for (const auto& [value, fact] : a_facts)
+                {
+                    range = (value == a_value) ? range.meet(fact) : range;
+                }
+                return range;
+            }
+
+            // What a true comparison "a_value <op> a_other" says about a_value.
+            static Range constrain(Opcode a_opcode, const Range& a_other)
+            {
+                if (a_other.empty())
+                {
+                    return a_other;
+                }
+
+                switch (a_opcode)
+                {
+                    case Opcode::EQ_INT:      return a_other;
+                    case Opcode::LESS_INT:    return Range{INT32_MIN, a_other.high - 1};
+                    case Opcode::GREATER_INT: return Range{a_other.low + 1, INT32_MAX};
+                    case Opcode::LEQ_INT:     return Range{INT32_MIN, a_other.high};
+                    case Opcode::GEQ_INT:     return Range{a_other.low, INT32_MAX};
+                    default:
+                        return (a_other.low == 0 && a_other.high == 0) ? Range{INT32_MIN, INT32_MAX, true} : Range::full();
+                }
+            }
+
+            static Opcode negated(Opcode a_opcode)
+            {
+                switch (a_opcode)
+                {
+                    case Opcode::EQ_INT:      return Opcode::NEQ_INT;
+                    case Opcode::NEQ_INT:     return Opcode::EQ_INT;
+                    case Opcode::LESS_INT:    return Opcode::GEQ_INT;
+                    case Opcode::GREATER_INT: return Opcode::LEQ_INT;
+                    case Opcode::LEQ_INT:     return Opcode::GREATER_INT;
+                    default:                  return Opcode::LESS_INT;
+                }
+            }
+
+            static Opcode swapped(Opcode a_opcode)
+            {
+                switch (a_opcode)
+                {
+                    case Opcode::LESS_INT:    return Opcode::GREATER_INT;
+                    case Opcode::GREATER_INT: return Opcode::LESS_INT;
+                    case Opcode::LEQ_INT:     return Opcode::GEQ_INT;
+                    case Opcode::GEQ_INT:     return Opcode::LEQ_INT;
+                    default:                  return a_opcode;
+                }
+            }
+
+            // Facts that hold when control moves from a_from to a_to: those of a_from plus the
+            // outcome of the comparison that ends it.
+            Facts edge(const ControlFlowGraph& a_cfg, int32_t a_from, int32_t a_to) const
+            {
+                Facts facts = m_facts[a_from];
+                const BasicBlock& from = a_cfg.block(a_from);
+                const Condition& condition = m_conditions[a_from];
+                if (condition.opcode == Opcode::HALT || from.successors.size() != 2 || from.successors[0] == from.successors[1])
+                {
+                    return facts;
+                }
+
+                const Instruction& jump = m_program.code()[from.end - 1];
+                bool taken = (a_cfg.blockOf(jump.operand) == a_to);
+                Opcode opcode = (taken == (jump.opcode == Opcode::JUMP_TRUE)) ? condition.opcode : negated(condition.opcode);
+
+                if (condition.left.value != -1)
+                {
+                    facts.emplace_back(condition.left.value, constrain(opcode, condition.right.range));
+                }
+                if (condition.right.value != -1)
+                {
+                    facts.emplace_back(condition.right.value, constrain(swapped(opcode), condition.left.range));
+                }
+                return facts;
+            }
+
+            static Range divide(const Range& a_dividend, const Range& a_divisor)
+            {
+                Range result{};
+                for (Range part : {Range{a_divisor.low, -1}, Range{1, a_divisor.high}})
+                {
+                    part = part.meet(a_divisor);
+                    if (part.empty())
+                    {
+                        continue;
+                    }
+                    for (int64_t dividend : {a_dividend.low, a_dividend.high})
+                    {
+                        result = result.join(Range::point(dividend / part.low)).join(Range::point(dividend / part.high));
+                    }
+                }
+
+                // The corners miss dividends between them, which truncate to 0 unless every one
+                // outweighs every divisor.
+                int64_t smallest = a_dividend.mayBeZero() ? 0 : (a_dividend.low > 0) ? a_dividend.low : (a_dividend.high < 0) ? -a_dividend.high : 1;
+                result.nonZero = smallest >= std::max(-a_divisor.low, a_divisor.high);
+                return result;
+            }
+
+            Range arithmetic(Instruction& a_instruction, const Range& a_left, const Range& a_right, bool a_annotate)
+            {
+                Opcode opcode = a_instruction.opcode;
+                bool known = !a_left.empty() && !a_right.empty();
+                Range result{};
+
+                switch (known ? opcode : Opcode::HALT)
+                {
+                    case Opcode::ADD_INT:
+                        result = Range{a_left.low + a_right.low, a_left.high + a_right.high};
+                        break;
+                    case Opcode::SUB_INT:
+                        result = Range{a_left.low - a_right.high, a_left.high - a_right.low};
+                        break;
+                    case Opcode::MUL_INT:
+                    {
+                        int64_t products[] = {a_left.low * a_right.low, a_left.low * a_right.high,
+                                              a_left.high * a_right.low, a_left.high * a_right.high};
+                        result = Range{*std::min_element(products, products + 4), *std::max_element(products, products + 4),
+                                       !a_left.mayBeZero() && !a_right.mayBeZero()};
+                        break;
+                    }
+                    case Opcode::DIV_INT:
+                        result = divide(a_left, a_right);
+                        break;
+                    case Opcode::NEG_INT:
+                        result = Range{-a_right.high, -a_right.low, !a_right.mayBeZero()};
+                        break;
+                    default:
+                        break;
+                }
+
+                bool exact = known && result.fits();
+
+                if (a_annotate)
+                {
+                    a_instruction.arity = exact ? Instruction::s_exact : 0;
+                    ++(exact ? m_exact : m_wrapping);
+
+                    if (opcode == Opcode::DIV_INT)
+                    {
+                        bool checked = !known || a_right.mayBeZero();
+                        a_instruction.arity |= checked ? Instruction::s_checked : 0;
+                        ++(checked ? m_checked : m_unchecked);
+                    }
+                }
+
+                return (!known || exact) ? result : Range::full();
+            }
+
+            void simulate(const ControlFlowGraph& a_cfg, const SsaForm& a_ssa, const std::vector<int32_t>& a_depths,
+                int32_t a_block, bool a_annotate)
+            {
+                std::vector<Instruction>& code = m_program.code();
+                const std::vector<SsaValue>& values = a_ssa.values();
+                const BasicBlock& block = a_cfg.block(a_block);
+
+                // A block dominated by a single predecessor also knows which way its comparison went.
+                m_facts[a_block] = (a_block == 0) ? Facts{}
+                    : (block.predecessors.size() == 1) ? edge(a_cfg, block.predecessors[0], a_block) : m_facts[block.idom];
+
+                for (int32_t phi : a_ssa.phis(a_block))
+                {
+                    Range merged{};
+                    for (size_t k = 0; k < block.predecessors.size(); ++k)
+                    {
+                        int32_t operand = values[phi].operands[k];
+                        merged = (operand == -1) ? merged : merged.join(rangeOf(operand, edge(a_cfg, block.predecessors[k], a_block)));
+                    }
+                    update(phi, merged);
+                }
+
+                m_conditions[a_block] = Condition{};
+
+                std::vector<Entry> stack(a_depths[block.begin], Entry{Range::full()});
+                auto pop = [&]()
+                {
+                    Entry top = stack.back();
+                    stack.pop_back();
+                    return top;
+                };
+
+                for (int32_t i = block.begin; i < block.end; ++i)
+                {
+                    Instruction& instruction = code[i];
+                    Opcode opcode = instruction.opcode;
+
+                    switch (opcode)
+                    {
+                        case Opcode::PUSH_INT:
+                            stack.push_back(Entry{Range::point(instruction.operand)});
+                            break;
+                        case Opcode::LOAD_INT:
+                            stack.push_back(Entry{rangeOf(a_ssa.use(i), m_facts[a_block]), a_ssa.use(i)});
+                            break;
+                        case Opcode::STORE_INT:
+                            update(a_ssa.def(i), pop().range);
+                            break;
+                        case Opcode::STORE_KEEP_INT:
+                            update(a_ssa.def(i), stack.back().range);
+                            stack.back().value = a_ssa.def(i);
+                            break;
+                        case Opcode::READ_INT:
+                            update(a_ssa.def(i), Range::full());
+                            break;
+                        case Opcode::ADD_INT:
+                        case Opcode::SUB_INT:
+                        case Opcode::MUL_INT:
+                        case Opcode::DIV_INT:
+                        {
+                            Range right = pop().range;
+                            Range left  = pop().range;
+                            stack.push_back(Entry{arithmetic(instruction, left, right, a_annotate)});
+                            break;
+                        }
+                        case Opcode::NEG_INT:
+                            stack.back() = Entry{arithmetic(instruction, Range::point(0), stack.back().range, a_annotate)};
+                            break;
+                        case Opcode::TO_REAL_SECOND:
+                            stack[stack.size() - 2] = Entry{Range::full()};
+                            break;
+                        case Opcode::NOT:
+                            stack.back() = Entry{Range{0, 1}};
+                            break;
+                        case Opcode::JUMP_FALSE:
+                        case Opcode::JUMP_TRUE:
+                            pop();
+                            if (i > block.begin && code[i - 1].opcode >= Opcode::EQ_INT && code[i - 1].opcode <= Opcode::GEQ_INT)
+                            {
+                                m_conditions[a_block].opcode = code[i - 1].opcode;
+                            }
+                            break;
+                        default:
+                        {
+                            if (isFused(opcode))
+                            {
+                                throw std::runtime_error("[RangeAnalysis]: superinstructions must be analyzed before fusion");
+                            }
+                            if (opcode >= Opcode::EQ_INT && opcode <= Opcode::GEQ_INT)
+                            {
+                                m_conditions[a_block].left  = stack[stack.size() - 2];
+                                m_conditions[a_block].right = stack.back();
+                            }
+
+                            int32_t pushes = Verifier::pushes(instruction);
+                            stack.resize(stack.size() - Verifier::pops(instruction));
+                            for (int32_t k = 0; k < pushes; ++k)
+                            {
+                                stack.push_back(Entry{isComparison(opcode) || opcode == Opcode::AND || opcode == Opcode::OR
+                                    ? Range{0, 1} : Range::full()});
+                            }
+                            break;
+                        }
+                    }
+                }
+            }
+
+        public:
+
+            RangeAnalysis(const Program& a_program)
+                : m_program(a_program)
+            {
+            }
+
+            Program analyze()
+            {
+                ControlFlowGraph cfg{m_program};
+                SsaForm ssa{cfg};
+                Verifier verifier{m_program};
+                verifier.verify();
+
+                // Growing bounds are widened to the next constant of the program, so a counter
+                // tested against a limit settles at that limit instead of the int range.
+                m_thresholds = {INT32_MIN, INT32_MAX};
+                for (const Instruction& instruction : m_program.code())
+                {
+                    if (instruction.opcode == Opcode::PUSH_INT)
+                    {
+                        for (int64_t delta : {-1, 0, 1})
+                        {
+                            m_thresholds.push_back(std::clamp<int64_t>(int64_t(instruction.operand) + delta, INT32_MIN, INT32_MAX));
+                        }
+                    }
+                }
+                std::sort(m_thresholds.begin(), m_thresholds.end());
+
+                m_ranges.assign(ssa.values().size(), Range{});
+                m_updates.assign(ssa.values().size(), 0);
+                m_facts.assign(cfg.blocks().size(), Facts{});
+                m_conditions.assign(cfg.blocks().size(), Condition{});
+
+                for (m_widening = m_changed = true; m_changed; )
+                {
+                    m_changed = false;
+                    for (int32_t block : cfg.reversePostorder())
+                    {
+                        simulate(cfg, ssa, verifier.depths(), block, false);
+                    }
+                }
+
+                m_widening = false;
+                for (int32_t pass = 1; pass <= s_narrowingPasses; ++pass)
+                {
+                    for (int32_t block : cfg.reversePostorder())
+                    {
+                        simulate(cfg, ssa, verifier.depths(), block, pass == s_narrowingPasses);
+                    }
+                }
+
+                return m_program;
+            }
+
+            size_t checked() const
+            {
+                return m_checked;
+            }
+
+            size_t unchecked() const
+            {
+                return m_unchecked;
+            }
+
+            size_t exact() const
+            {
+                return m_exact;
+            }
+
+            size_t wrapping() const
+            {
+                return m_wrapping;
+            }
+    };
+}
+
+#endif // RANGE_ANALYSIS_HPP
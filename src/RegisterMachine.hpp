@@ -0,0 +1,969 @@
+#ifndef REGISTER_MACHINE_HPP
+#define REGISTER_MACHINE_HPP
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#include "Bytecode.hpp"
+#include "InputBuffer.hpp"
+#include "OutputBuffer.hpp"
+#include "StringHeap.hpp"
+#include "Value.hpp"
+
+#if defined(__GNUC__)
+#define MLI_THREADED_DISPATCH
+#endif
+
+namespace mli {
+
+#define MLI_REGISTER_OPCODES(X) \
+    X(MOVE)                     \
+    X(MOVE_INT)                 \
+    X(MOVE_REAL)                \
+    X(CHECK)                    \
+    X(READ_INT)                 \
+    X(READ_REAL)                \
+    X(READ_STRING)              \
+    X(WRITE)                    \
+    X(ADD_INT)                  \
+    X(SUB_INT)                  \
+    X(MUL_INT)                  \
+    X(DIV_INT)                  \
+    X(ADD_REAL)                 \
+    X(SUB_REAL)                 \
+    X(MUL_REAL)                 \
+    X(DIV_REAL)                 \
+    X(NEG_INT)                  \
+    X(NEG_REAL)                 \
+    X(NOT)                      \
+    X(EQ_INT)                   \
+    X(NEQ_INT)                  \
+    X(LESS_INT)                 \
+    X(GREATER_INT)              \
+    X(LEQ_INT)                  \
+    X(GEQ_INT)                  \
+    X(EQ_REAL)                  \
+    X(NEQ_REAL)                 \
+    X(LESS_REAL)                \
+    X(GREATER_REAL)             \
+    X(LEQ_REAL)                 \
+    X(GEQ_REAL)                 \
+    X(EQ_STRING)                \
+    X(NEQ_STRING)               \
+    X(LESS_STRING)              \
+    X(GREATER_STRING)           \
+    X(LEQ_STRING)               \
+    X(GEQ_STRING)               \
+    X(AND)                      \
+    X(OR)                       \
+    X(CONCAT)                   \
+    X(APPEND)                   \
+    X(JUMP)                     \
+    X(JUMP_FALSE)               \
+    X(JUMP_TRUE)                \
+    X(HALT)
+
+    enum class RegisterOpcode : uint8_t
+    {
+#define MLI_OPCODE_ENUM(name) name,
+        MLI_REGISTER_OPCODES(MLI_OPCODE_ENUM)
+#undef MLI_OPCODE_ENUM
+    };
+
+    inline const char* opcodeName(RegisterOpcode a_opcode)
+    {
+        static const char* s_names[] = {
+#define MLI_OPCODE_NAME(name) #name,
+            MLI_REGISTER_OPCODES(MLI_OPCODE_NAME)
+#undef MLI_OPCODE_NAME
+        };
+
+        return s_names[static_cast<int>(a_opcode)];
+    }
+
+    struct RegisterInstruction
+    {
+        RegisterOpcode opcode{RegisterOpcode::HALT};
+        uint16_t       arity{};
+        int32_t        dst{};
+        int32_t        a{};
+        int32_t        b{};
+    };
+
+    class RegisterProgram
+    {
+        private:
+            std::vector<RegisterInstruction> m_code;
+            std::vector<Value>               m_constants;
+            std::vector<std::string>         m_strings;
+            int32_t                          m_variables{};
+            int32_t                          m_registers{};
+
+        public:
+
+            std::vector<RegisterInstruction>& code()
+            {
+                return m_code;
+            }
+
+            const std::vector<RegisterInstruction>& code() const
+            {
+                return m_code;
+            }
+
+            const std::vector<Value>& constants() const
+            {
+                return m_constants;
+            }
+
+            const std::vector<std::string>& strings() const
+            {
+                return m_strings;
+            }
+
+            int32_t variables() const
+            {
+                return m_variables;
+            }
+
+            int32_t registers() const
+            {
+                return m_registers;
+            }
+
+            int32_t constantBase() const
+            {
+                return m_variables;
+            }
+
+            int32_t temporaryBase() const
+            {
+                return m_variables + m_constants.size();
+            }
+
+            void setVariables(int32_t a_count)
+            {
+                m_variables = a_count;
+            }
+
+            void setRegisters(int32_t a_count)
+            {
+                m_registers = a_count;
+            }
+
+            int32_t addConstant(Value a_value)
+            {
+                for (size_t i = 0; i < m_constants.size(); ++i)
+                {
+                    if (m_constants[i].bits() == a_value.bits())
+                    {
+                        return constantBase() + i;
+                    }
+                }
+
+                m_constants.push_back(a_value);
+                return constantBase() + m_constants.size() - 1;
+            }
+
+            int32_t addString(const std::string& a_value)
+            {
+                m_strings.push_back(a_value);
+                return m_strings.size() - 1;
+            }
+
+            size_t emit(RegisterOpcode a_opcode, int32_t a_dst = 0, int32_t a_a = 0, int32_t a_b = 0)
+            {
+                m_code.push_back(RegisterInstruction{a_opcode, 0, a_dst, a_a, a_b});
+                return m_code.size() - 1;
+            }
+
+            void dump(std::ostream& a_out) const
+            {
+                a_out << "########### REGISTERS ###########\n";
+                a_out << "variables: r0..r" << m_variables - 1 << ", constants: r" << constantBase()
+                    << "..r" << temporaryBase() - 1 << ", temporaries: r" << temporaryBase() << "..r" << m_registers - 1 << "\n";
+                for (size_t i = 0; i < m_code.size(); ++i)
+                {
+                    const RegisterInstruction& instruction = m_code[i];
+                    a_out << std::setw(4) << i << ":  " << opcodeName(instruction.opcode)
+                        << " " << instruction.dst << ", " << instruction.a << ", " << instruction.b;
+                    if (instruction.arity)
+                    {
+                        a_out << " +" << instruction.arity;
+                    }
+                    a_out << "\n";
+                }
+                a_out << "#################################\n";
+            }
+    };
+
+    class RegisterTranslator
+    {
+        private:
+            struct Operand
+            {
+                int32_t     reg{};
+                Token::Type type{};
+            };
+
+            const Program&       m_program;
+            RegisterProgram      m_result;
+            std::vector<Operand> m_stack;
+            std::vector<int32_t> m_variableBase;
+            int32_t              m_lastResult{-1};
+            int32_t              m_maxDepth{};
+
+            int32_t temporary(size_t a_depth)
+            {
+                m_maxDepth = std::max<int32_t>(m_maxDepth, a_depth + 1);
+                return m_result.temporaryBase() + a_depth;
+            }
+
+            int32_t variableRegister(Opcode a_opcode, int32_t a_slot) const
+            {
+                Token::Type type = slotType(a_opcode);
+                int index = (type == Token::Type::REAL) ? 1 : (type == Token::Type::STRING) ? 2 : 0;
+                return m_variableBase[index] + a_slot;
+            }
+
+            void materialize(size_t a_depth)
+            {
+                int32_t canonical = temporary(a_depth);
+
+                if (m_stack[a_depth].reg != canonical)
+                {
+                    m_result.emit(RegisterOpcode::MOVE, canonical, m_stack[a_depth].reg);
+                    m_stack[a_depth].reg = canonical;
+                }
+            }
+
+            void materializeAll()
+            {
+                for (size_t depth = 0; depth < m_stack.size(); ++depth)
+                {
+                    materialize(depth);
+                }
+
+                m_lastResult = -1;
+            }
+
+            void materializeReferences(int32_t a_register)
+            {
+                for (size_t depth = 0; depth < m_stack.size(); ++depth)
+                {
+                    if (m_stack[depth].reg == a_register)
+                    {
+                        materialize(depth);
+                    }
+                }
+            }
+
+            Operand pop()
+            {
+                Operand operand = m_stack.back();
+                m_stack.pop_back();
+                return operand;
+            }
+
+            void pushResult(RegisterOpcode a_opcode, Token::Type a_type, int32_t a_a, int32_t a_b = 0)
+            {
+                int32_t dst = temporary(m_stack.size());
+                m_lastResult = m_result.emit(a_opcode, dst, a_a, a_b);
+                m_stack.push_back(Operand{dst, a_type});
+            }
+
+            void store(int32_t a_register, Token::Type a_type)
+            {
+                Operand source = pop();
+
+                size_t before = m_result.code().size();
+                materializeReferences(a_register);
+                if (m_result.code().size() != before)
+                {
+                    m_lastResult = -1;
+                }
+
+                RegisterOpcode move = (a_type == Token::Type::INT && source.type != Token::Type::INT) ? RegisterOpcode::MOVE_INT
+                    : (a_type == Token::Type::REAL && source.type != Token::Type::REAL) ? RegisterOpcode::MOVE_REAL : RegisterOpcode::MOVE;
+
+                bool retarget = move == RegisterOpcode::MOVE && m_lastResult >= 0
+                    && m_result.code()[m_lastResult].dst == source.reg;
+
+                if (retarget)
+                {
+                    m_result.code()[m_lastResult].dst = a_register;
+                }
+                else if (source.reg != a_register || move != RegisterOpcode::MOVE)
+                {
+                    m_result.emit(move, a_register, source.reg);
+                }
+
+                m_lastResult = -1;
+            }
+
+            // The typed operators ADD_INT..OR are laid out as in the bytecode.
+            static RegisterOpcode typedOpcode(Opcode a_opcode)
+            {
+                static_assert(static_cast<int>(RegisterOpcode::OR) - static_cast<int>(RegisterOpcode::ADD_INT)
+                    == static_cast<int>(Opcode::OR) - static_cast<int>(Opcode::ADD_INT));
+
+                return static_cast<RegisterOpcode>(static_cast<int>(RegisterOpcode::ADD_INT) + static_cast<int>(a_opcode) - static_cast<int>(Opcode::ADD_INT));
+            }
+
+            static Token::Type resultType(Opcode a_opcode)
+            {
+                return (a_opcode >= Opcode::ADD_REAL && a_opcode <= Opcode::DIV_REAL) ? Token::Type::REAL : Token::Type::INT;
+            }
+
+        public:
+
+            RegisterTranslator(const Program& a_program)
+                : m_program(a_program)
+            {
+            }
+
+            RegisterProgram translate()
+            {
+                const std::vector<Instruction>& code = m_program.code();
+
+                m_variableBase = { 0, m_program.intSlots(), m_program.intSlots() + m_program.realSlots() };
+                m_result.setVariables(m_program.intSlots() + m_program.realSlots() + m_program.stringSlots());
+
+                for (auto& string : m_program.strings())
+                {
+                    m_result.addString(string);
+                }
+
+                for (auto& instruction : code)
+                {
+                    if (instruction.opcode == Opcode::PUSH_INT)
+                    {
+                        m_result.addConstant(Value::fromInt(instruction.operand));
+                    }
+                    else if (instruction.opcode == Opcode::PUSH_REAL)
+                    {
+                        m_result.addConstant(Value::fromReal(m_program.reals()[instruction.operand]));
+                    }
+                    else if (instruction.opcode == Opcode::PUSH_STRING)
+                    {
+                        m_result.addConstant(Value::fromString(instruction.operand));
+                    }
+                }
+
+                std::vector<bool> isTarget(code.size());
+                for (auto& instruction : code)
+                {
+                    if (isJump(instruction.opcode))
+                    {
+                        isTarget[instruction.operand] = true;
+                    }
+                }
+
+                std::vector<int32_t> codeToRegister(code.size());
+
+                for (size_t i = 0; i < code.size(); ++i)
+                {
+                    const Instruction& instruction = code[i];
+
+                    if (isTarget[i])
+                    {
+                        materializeAll();
+                    }
+                    codeToRegister[i] = m_result.code().size();
+
+                    switch (instruction.opcode)
+                    {
+                        case Opcode::PUSH_INT:
+                            m_stack.push_back(Operand{m_result.addConstant(Value::fromInt(instruction.operand)), Token::Type::INT});
+                            break;
+
+                        case Opcode::PUSH_REAL:
+                            m_stack.push_back(Operand{m_result.addConstant(Value::fromReal(m_program.reals()[instruction.operand])), Token::Type::REAL});
+                            break;
+
+                        case Opcode::PUSH_STRING:
+                            m_stack.push_back(Operand{m_result.addConstant(Value::fromString(instruction.operand)), Token::Type::STRING});
+                            break;
+
+                        case Opcode::LOAD_INT:
+                        case Opcode::LOAD_REAL:
+                        case Opcode::LOAD_STRING:
+                        {
+                            int32_t reg = variableRegister(instruction.opcode, instruction.operand);
+                            if (instruction.arity & Instruction::s_checked)
+                            {
+                                m_result.emit(RegisterOpcode::CHECK, 0, reg);
+                            }
+                            m_stack.push_back(Operand{reg, slotType(instruction.opcode)});
+                            m_lastResult = -1;
+                            break;
+                        }
+
+                        case Opcode::STORE_INT:
+                        case Opcode::STORE_REAL:
+                        case Opcode::STORE_STRING:
+                            store(variableRegister(instruction.opcode, instruction.operand), slotType(instruction.opcode));
+                            break;
+
+                        case Opcode::STORE_KEEP_INT:
+                        case Opcode::STORE_KEEP_REAL:
+                        case Opcode::STORE_KEEP_STRING:
+                        {
+                            int32_t reg = variableRegister(instruction.opcode, instruction.operand);
+                            store(reg, slotType(instruction.opcode));
+                            m_stack.push_back(Operand{reg, slotType(instruction.opcode)});
+                            break;
+                        }
+
+                        case Opcode::READ_INT:
+                        case Opcode::READ_REAL:
+                        case Opcode::READ_STRING:
+                        {
+                            int32_t reg = variableRegister(instruction.opcode, instruction.operand);
+                            materializeReferences(reg);
+                            RegisterOpcode read = (instruction.opcode == Opcode::READ_INT) ? RegisterOpcode::READ_INT
+                                : (instruction.opcode == Opcode::READ_REAL) ? RegisterOpcode::READ_REAL : RegisterOpcode::READ_STRING;
+                            m_result.emit(read, reg);
+                            m_lastResult = -1;
+                            break;
+                        }
+
+                        case Opcode::APPEND_STRING:
+                        {
+                            int32_t reg = variableRegister(instruction.opcode, instruction.operand);
+                            size_t first = m_stack.size() - instruction.arity;
+                            for (size_t depth = first; depth < m_stack.size(); ++depth)
+                            {
+                                materialize(depth);
+                            }
+                            materializeReferences(reg);
+                            m_result.emit(RegisterOpcode::CHECK, 0, reg);
+                            size_t index = m_result.emit(RegisterOpcode::APPEND, reg, temporary(first));
+                            m_result.code()[index].arity = instruction.arity;
+                            m_stack.resize(first);
+                            m_lastResult = -1;
+                            break;
+                        }
+
+                        case Opcode::CONCAT:
+                        {
+                            size_t first = m_stack.size() - instruction.operand;
+                            for (size_t depth = first; depth < m_stack.size(); ++depth)
+                            {
+                                materialize(depth);
+                            }
+                            m_stack.resize(first);
+                            pushResult(RegisterOpcode::CONCAT, Token::Type::STRING, temporary(first));
+                            m_result.code()[m_lastResult].arity = instruction.operand;
+                            break;
+                        }
+
+                        case Opcode::WRITE:
+                            m_result.emit(RegisterOpcode::WRITE, 0, pop().reg);
+                            m_lastResult = -1;
+                            break;
+
+                        case Opcode::POP:
+                            pop();
+                            m_lastResult = -1;
+                            break;
+
+                        case Opcode::TO_INT:
+                            pushResult(RegisterOpcode::MOVE_INT, Token::Type::INT, pop().reg);
+                            break;
+
+                        case Opcode::TO_REAL:
+                            pushResult(RegisterOpcode::MOVE_REAL, Token::Type::REAL, pop().reg);
+                            break;
+
+                        case Opcode::TO_REAL_SECOND:
+                        {
+                            size_t depth = m_stack.size() - 2;
+                            m_result.emit(RegisterOpcode::MOVE_REAL, temporary(depth), m_stack[depth].reg);
+                            m_stack[depth] = Operand{temporary(depth), Token::Type::REAL};
+                            m_lastResult = -1;
+                            break;
+                        }
+
+                        case Opcode::NEG_INT:
+                        case Opcode::NEG_REAL:
+                        {
+                            Operand operand = pop();
+                            pushResult(typedOpcode(instruction.opcode), operand.type, operand.reg);
+                            break;
+                        }
+
+                        case Opcode::NOT:
+                            pushResult(RegisterOpcode::NOT, Token::Type::INT, pop().reg);
+                            break;
+
+                        case Opcode::JUMP:
+                            materializeAll();
+                            m_result.emit(RegisterOpcode::JUMP, instruction.operand);
+                            break;
+
+                        case Opcode::JUMP_FALSE:
+                        case Opcode::JUMP_TRUE:
+                        {
+                            Operand condition = pop();
+                            materializeAll();
+                            RegisterOpcode jump = (instruction.opcode == Opcode::JUMP_FALSE) ? RegisterOpcode::JUMP_FALSE : RegisterOpcode::JUMP_TRUE;
+                            m_result.emit(jump, instruction.operand, condition.reg);
+                            break;
+                        }
+
+                        case Opcode::JUMP_FALSE_LAZY:
+                        case Opcode::JUMP_TRUE_LAZY:
+                        {
+                            materializeAll();
+                            RegisterOpcode jump = (instruction.opcode == Opcode::JUMP_FALSE_LAZY) ? RegisterOpcode::JUMP_FALSE : RegisterOpcode::JUMP_TRUE;
+                            m_result.emit(jump, instruction.operand, m_stack.back().reg);
+                            break;
+                        }
+
+                        case Opcode::HALT:
+                            m_result.emit(RegisterOpcode::HALT);
+                            break;
+
+                        case Opcode::INC_INT:
+                        case Opcode::LOAD_INT_PUSH_INT:
+                        case Opcode::EQ_INT_JUMP_FALSE:
+                        case Opcode::NEQ_INT_JUMP_FALSE:
+                        case Opcode::LESS_INT_JUMP_FALSE:
+                        case Opcode::GREATER_INT_JUMP_FALSE:
+                        case Opcode::LEQ_INT_JUMP_FALSE:
+                        case Opcode::GEQ_INT_JUMP_FALSE:
+                            throw std::runtime_error("[RegisterTranslator]: superinstructions must be translated before fusion");
+
+                        default:
+                        {
+                            Operand right = pop();
+                            Operand left  = pop();
+                            pushResult(typedOpcode(instruction.opcode), resultType(instruction.opcode), left.reg, right.reg);
+                            if (instruction.opcode == Opcode::DIV_INT)
+                            {
+                                m_result.code()[m_lastResult].arity = instruction.arity & Instruction::s_checked;
+                            }
+                            break;
+                        }
+                    }
+                }
+
+                for (auto& instruction : m_result.code())
+                {
+                    if (instruction.opcode >= RegisterOpcode::JUMP && instruction.opcode <= RegisterOpcode::JUMP_TRUE)
+                    {
+                        instruction.dst = codeToRegister[instruction.dst];
+                    }
+                }
+
+                m_result.setRegisters(m_result.temporaryBase() + m_maxDepth);
+                return m_result;
+            }
+    };
+
+    class RegisterMachine
+    {
+        private:
+            std::vector<Value>    m_registers;
+            std::vector<uint8_t>  m_assigned;
+            StringHeap            m_heap;
+            std::vector<uint32_t> m_constants;
+
+            void set(int32_t a_register, Value a_value)
+            {
+                Value old = m_registers[a_register];
+                m_registers[a_register] = a_value;
+                m_assigned[a_register]  = true;
+
+                if (old.isString())
+                {
+                    m_heap.release(old.asString());
+                }
+            }
+
+            void copy(int32_t a_dst, Value a_value)
+            {
+                if (a_value.isString())
+                {
+                    m_heap.retain(a_value.asString());
+                }
+
+                set(a_dst, a_value);
+            }
+
+            static int32_t wrap(int64_t a_value)
+            {
+                return static_cast<int32_t>(static_cast<uint32_t>(a_value));
+            }
+
+            template<typename Compare>
+            Value compareStrings(Value a_left, Value a_right, Compare a_compare)
+            {
+                return Value::fromInt(a_compare(m_heap.get(a_left.asString()), m_heap.get(a_right.asString())));
+            }
+
+            void write(Value a_value)
+            {
+                if (a_value.isString())
+                {
+                    OutputBuffer::standard().write(m_heap.get(a_value.asString()));
+                }
+                else if (a_value.isReal())
+                {
+                    OutputBuffer::standard().write(a_value.asReal());
+                }
+                else
+                {
+                    OutputBuffer::standard().write(a_value.asInt());
+                }
+            }
+
+            void append(int32_t a_register, const Value* a_tail, size_t a_count)
+            {
+                uint32_t head = m_registers[a_register].asString();
+
+                size_t length = m_heap.get(head).size();
+                for (size_t i = 0; i < a_count; ++i)
+                {
+                    length += m_heap.get(a_tail[i].asString()).size();
+                }
+
+                if (!m_heap.isUnique(head))
+                {
+                    std::string copy{};
+                    copy.reserve(length);
+                    copy += m_heap.get(head);
+                    set(a_register, Value::fromString(m_heap.allocate(std::move(copy))));
+                    head = m_registers[a_register].asString();
+                }
+
+                std::string& target = m_heap.edit(head);
+                if (target.capacity() < length)
+                {
+                    target.reserve(std::max(length, 2 * target.capacity()));
+                }
+
+                for (size_t i = 0; i < a_count; ++i)
+                {
+                    target += m_heap.get(a_tail[i].asString());
+                }
+            }
+
+        public:
+
+            const StringHeap& heap() const
+            {
+                return m_heap;
+            }
+
+            void execute(const RegisterProgram& a_program)
+            {
+                const RegisterInstruction* code = a_program.code().data();
+                const RegisterInstruction* pc   = code;
+
+                m_heap.clear();
+                m_constants.clear();
+                for (auto& string : a_program.strings())
+                {
+                    m_constants.push_back(m_heap.allocate(std::string(string)));
+                }
+
+                m_registers.assign(a_program.registers(), Value::fromInt(0));
+                m_assigned.assign(a_program.registers(), false);
+
+                for (size_t i = 0; i < a_program.constants().size(); ++i)
+                {
+                    Value constant = a_program.constants()[i];
+                    if (constant.isString())
+                    {
+                        constant = Value::fromString(m_constants[constant.asString()]);
+                    }
+                    copy(a_program.constantBase() + i, constant);
+                }
+
+                Value* r = m_registers.data();
+
+#ifdef MLI_THREADED_DISPATCH
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+                static void* s_dispatchTable[] = {
+#define MLI_DISPATCH_LABEL(name) &&op_##name,
+                    MLI_REGISTER_OPCODES(MLI_DISPATCH_LABEL)
+#undef MLI_DISPATCH_LABEL
+                };
+
+#define MLI_CASE(name) op_##name:
+#define MLI_NEXT()     goto *s_dispatchTable[static_cast<int>((++pc)->opcode)]
+#define MLI_JUMP()     goto *s_dispatchTable[static_cast<int>((pc = code + pc->dst)->opcode)]
+
+                goto *s_dispatchTable[static_cast<int>(pc->opcode)];
+#else
+#define MLI_CASE(name) case RegisterOpcode::name:
+#define MLI_NEXT()     ++pc; continue
+#define MLI_JUMP()     pc = code + pc->dst; continue
+
+                for (;;)
+                {
+                    switch (pc->opcode)
+                    {
+#endif
+                MLI_CASE(MOVE)
+                {
+                    copy(pc->dst, r[pc->a]);
+                    MLI_NEXT();
+                }
+                MLI_CASE(MOVE_INT)
+                {
+                    set(pc->dst, Value::fromInt(r[pc->a].toInt()));
+                    MLI_NEXT();
+                }
+                MLI_CASE(MOVE_REAL)
+                {
+                    set(pc->dst, Value::fromReal(r[pc->a].toReal()));
+                    MLI_NEXT();
+                }
+                MLI_CASE(CHECK)
+                {
+                    if (!m_assigned[pc->a])
+                    {
+                        throw std::runtime_error("variable is not assigned");
+                    }
+                    MLI_NEXT();
+                }
+                MLI_CASE(READ_INT)
+                {
+                    set(pc->dst, Value::fromInt(InputBuffer::standard().readInt()));
+                    MLI_NEXT();
+                }
+                MLI_CASE(READ_REAL)
+                {
+                    set(pc->dst, Value::fromReal(InputBuffer::standard().readReal()));
+                    MLI_NEXT();
+                }
+                MLI_CASE(READ_STRING)
+                {
+                    set(pc->dst, Value::fromString(m_heap.allocate(InputBuffer::standard().readString())));
+                    MLI_NEXT();
+                }
+                MLI_CASE(WRITE)
+                {
+                    write(r[pc->a]);
+                    MLI_NEXT();
+                }
+                MLI_CASE(ADD_INT)
+                {
+                    set(pc->dst, Value::fromInt(wrap(int64_t(r[pc->a].asInt()) + r[pc->b].asInt())));
+                    MLI_NEXT();
+                }
+                MLI_CASE(SUB_INT)
+                {
+                    set(pc->dst, Value::fromInt(wrap(int64_t(r[pc->a].asInt()) - r[pc->b].asInt())));
+                    MLI_NEXT();
+                }
+                MLI_CASE(MUL_INT)
+                {
+                    set(pc->dst, Value::fromInt(wrap(int64_t(r[pc->a].asInt()) * r[pc->b].asInt())));
+                    MLI_NEXT();
+                }
+                MLI_CASE(DIV_INT)
+                {
+                    if ((pc->arity & Instruction::s_checked) && r[pc->b].asInt() == 0)
+                    {
+                        throw std::runtime_error("division by zero");
+                    }
+                    set(pc->dst, Value::fromInt(wrap(int64_t(r[pc->a].asInt()) / r[pc->b].asInt())));
+                    MLI_NEXT();
+                }
+                MLI_CASE(ADD_REAL)
+                {
+                    set(pc->dst, Value::fromReal(r[pc->a].asReal() + r[pc->b].asReal()));
+                    MLI_NEXT();
+                }
+                MLI_CASE(SUB_REAL)
+                {
+                    set(pc->dst, Value::fromReal(r[pc->a].asReal() - r[pc->b].asReal()));
+                    MLI_NEXT();
+                }
+                MLI_CASE(MUL_REAL)
+                {
+                    set(pc->dst, Value::fromReal(r[pc->a].asReal() * r[pc->b].asReal()));
+                    MLI_NEXT();
+                }
+                MLI_CASE(DIV_REAL)
+                {
+                    set(pc->dst, Value::fromReal(r[pc->a].asReal() / r[pc->b].asReal()));
+                    MLI_NEXT();
+                }
+                MLI_CASE(NEG_INT)
+                {
+                    set(pc->dst, Value::fromInt(wrap(-int64_t(r[pc->a].asInt()))));
+                    MLI_NEXT();
+                }
+                MLI_CASE(NEG_REAL)
+                {
+                    set(pc->dst, Value::fromReal(-r[pc->a].asReal()));
+                    MLI_NEXT();
+                }
+                MLI_CASE(NOT)
+                {
+                    set(pc->dst, Value::fromInt(!r[pc->a].asInt()));
+                    MLI_NEXT();
+                }
+                MLI_CASE(EQ_INT)
+                {
+                    set(pc->dst, Value::fromInt(r[pc->a].asInt() == r[pc->b].asInt()));
+                    MLI_NEXT();
+                }
+                MLI_CASE(NEQ_INT)
+                {
+                    set(pc->dst, Value::fromInt(r[pc->a].asInt() != r[pc->b].asInt()));
+                    MLI_NEXT();
+                }
+                MLI_CASE(LESS_INT)
+                {
+                    set(pc->dst, Value::fromInt(r[pc->a].asInt() < r[pc->b].asInt()));
+                    MLI_NEXT();
+                }
+                MLI_CASE(GREATER_INT)
+                {
+                    set(pc->dst, Value::fromInt(r[pc->a].asInt() > r[pc->b].asInt()));
+                    MLI_NEXT();
+                }
+                MLI_CASE(LEQ_INT)
+                {
+                    set(pc->dst, Value::fromInt(r[pc->a].asInt() <= r[pc->b].asInt()));
+                    MLI_NEXT();
+                }
+                MLI_CASE(GEQ_INT)
+                {
+                    set(pc->dst, Value::fromInt(r[pc->a].asInt() >= r[pc->b].asInt()));
+                    MLI_NEXT();
+                }
+                MLI_CASE(EQ_REAL)
+                {
+                    set(pc->dst, Value::fromInt(r[pc->a].asReal() == r[pc->b].asReal()));
+                    MLI_NEXT();
+                }
+                MLI_CASE(NEQ_REAL)
+                {
+                    set(pc->dst, Value::fromInt(r[pc->a].asReal() != r[pc->b].asReal()));
+                    MLI_NEXT();
+                }
+                MLI_CASE(LESS_REAL)
+                {
+                    set(pc->dst, Value::fromInt(r[pc->a].asReal() < r[pc->b].asReal()));
+                    MLI_NEXT();
+                }
+                MLI_CASE(GREATER_REAL)
+                {
+                    set(pc->dst, Value::fromInt(r[pc->a].asReal() > r[pc->b].asReal()));
+                    MLI_NEXT();
+                }
+                MLI_CASE(LEQ_REAL)
+                {
+                    set(pc->dst, Value::fromInt(r[pc->a].asReal() <= r[pc->b].asReal()));
+                    MLI_NEXT();
+                }
+                MLI_CASE(GEQ_REAL)
+                {
+                    set(pc->dst, Value::fromInt(r[pc->a].asReal() >= r[pc->b].asReal()));
+                    MLI_NEXT();
+                }
+                MLI_CASE(EQ_STRING)
+                {
+                    set(pc->dst, compareStrings(r[pc->a], r[pc->b], [](const auto& l, const auto& r) { return l == r; }));
+                    MLI_NEXT();
+                }
+                MLI_CASE(NEQ_STRING)
+                {
+                    set(pc->dst, compareStrings(r[pc->a], r[pc->b], [](const auto& l, const auto& r) { return l != r; }));
+                    MLI_NEXT();
+                }
+                MLI_CASE(LESS_STRING)
+                {
+                    set(pc->dst, compareStrings(r[pc->a], r[pc->b], [](const auto& l, const auto& r) { return l < r; }));
+                    MLI_NEXT();
+                }
+                MLI_CASE(GREATER_STRING)
+                {
+                    set(pc->dst, compareStrings(r[pc->a], r[pc->b], [](const auto& l, const auto& r) { return l > r; }));
+                    MLI_NEXT();
+                }
+                MLI_CASE(LEQ_STRING)
+                {
+                    set(pc->dst, compareStrings(r[pc->a], r[pc->b], [](const auto& l, const auto& r) { return l <= r; }));
+                    MLI_NEXT();
+                }
+                MLI_CASE(GEQ_STRING)
+                {
+                    set(pc->dst, compareStrings(r[pc->a], r[pc->b], [](const auto& l, const auto& r) { return l >= r; }));
+                    MLI_NEXT();
+                }
+                MLI_CASE(AND)
+                {
+                    set(pc->dst, Value::fromInt(r[pc->a].asInt() && r[pc->b].asInt()));
+                    MLI_NEXT();
+                }
+                MLI_CASE(OR)
+                {
+                    set(pc->dst, Value::fromInt(r[pc->a].asInt() || r[pc->b].asInt()));
+                    MLI_NEXT();
+                }
+                MLI_CASE(CONCAT)
+                {
+                    std::string result{};
+                    for (int32_t i = 0; i < pc->arity; ++i)
+                    {
+                        result += m_heap.get(r[pc->a + i].asString());
+                    }
+                    set(pc->dst, Value::fromString(m_heap.allocate(std::move(result))));
+                    MLI_NEXT();
+                }
+                MLI_CASE(APPEND)
+                {
+                    append(pc->dst, r + pc->a, pc->arity);
+                    MLI_NEXT();
+                }
+                MLI_CASE(JUMP)
+                {
+                    MLI_JUMP();
+                }
+                MLI_CASE(JUMP_FALSE)
+                {
+                    if (!r[pc->a].asInt())
+                    {
+                        MLI_JUMP();
+                    }
+                    MLI_NEXT();
+                }
+                MLI_CASE(JUMP_TRUE)
+                {
+                    if (r[pc->a].asInt())
+                    {
+                        MLI_JUMP();
+                    }
+                    MLI_NEXT();
+                }
+                MLI_CASE(HALT)
+                {
+                    OutputBuffer::standard().flush();
+                    return;
+                }
+#ifdef MLI_THREADED_DISPATCH
+#pragma GCC diagnostic pop
+#else
+                    }
+                }
+#endif
+
+#undef MLI_CASE
+#undef MLI_NEXT
+#undef MLI_JUMP
+            }
+    };
+}
+
+#endif // REGISTER_MACHINE_HPP
@@ -2,15 +2,28 @@
 #define SCANNER_HPP
 
 #include <unordered_map>
+#include <array>
 #include <filesystem>
 #include <fstream>
+#include <iterator>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cmath>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "Token.hpp"
 #include "Ident.hpp"
+#include "LexerTable.hpp"
 #include "LexicalError.hpp"
+#include "SymbolTable.hpp"
+
+#undef NULL
 
 namespace fs = std::filesystem;
 
@@ -45,11 +58,12 @@ namespace mli {
 
             virtual State* determineToken() = 0;
 
-            void setSrcFile(std::ifstream* a_pSrcFile)
+            void setSource(std::string_view a_source)
             {
-                s_charBuffer = "";
-                s_numBuffer  = 0;
-                s_pSrcFile   = a_pSrcFile;
+                s_source    = a_source;
+                s_position  = 0;
+                s_lexeme    = 0;
+                s_numBuffer = 0;
             }
 
             void setStateMachine(Machine a_stateMachine)
@@ -62,6 +76,48 @@ namespace mli {
                 return s_token;
             }
 
+            // A word keeps the meaning it got the first time it was met: a reserved word,
+            // a variable, or a goto mark when a ':' follows it.
+            static Token word(std::string_view a_name, bool a_beforeColon)
+            {
+                if (const Token* word = s_words.find(a_name))
+                {
+                    return Token(word->getType(), s_currentLine, word->getValue());
+                }
+
+                Token token{};
+                if (a_beforeColon)
+                {
+                    auto mark = s_gotoMarks.emplace(a_name, Mark(std::string(a_name))).first;
+                    token = Token(Token::Type::GOTO_MARK, s_currentLine, mark->second.getID());
+                }
+                else
+                {
+                    auto ident = s_TID.emplace(a_name, Ident(std::string(a_name))).first;
+                    token = Token(Token::Type::ID, s_currentLine, ident->second.getID());
+                }
+                s_words.insert(a_name, token);
+                return token;
+            }
+
+            // Equal literals share one entry of s_strings.
+            static Token literal(std::string_view a_text)
+            {
+                int index = s_literals.insert(a_text, s_strings.size());
+                if (index == static_cast<int>(s_strings.size()))
+                {
+                    s_strings.emplace_back(a_text);
+                }
+                return Token(Token::Type::STRING_CONST, s_currentLine, index);
+            }
+
+            // a_digits holds every digit of the literal, a_fraction of them after the point.
+            static Token real(uint32_t a_digits, size_t a_fraction)
+            {
+                s_realNumbers.push_back(static_cast<double>(a_digits * std::pow(0.1, a_fraction)));
+                return Token(Token::Type::REAL_CONST, s_currentLine, s_realNumbers.size() - 1);
+            }
+
             static std::unordered_map<std::string, Ident> s_TID;
             static std::unordered_map<std::string, Mark> s_gotoMarks;
             static std::vector<std::string>               s_strings;
@@ -70,28 +126,139 @@ namespace mli {
             static int                                    s_currentLine;
 
         protected:
-            static std::string    s_charBuffer;
-            static uint32_t       s_numBuffer;
-            static std::ifstream* s_pSrcFile;
-            static Machine        s_stateMachine;
+            static std::string_view s_source;
+            static size_t           s_position;
+            static size_t           s_lexeme;
+            static uint32_t         s_numBuffer;
+            static Machine          s_stateMachine;
+
+            // Every word met so far with its token, starting with the reserved words,
+            // and the index of every distinct string literal in s_strings.
+            static SymbolTable<Token> s_words;
+            static SymbolTable<int>   s_literals;
 
             static Token s_token;
 
             char m_currentChar;
 
+            // Reading past the end gives '\0' and sets eof(), as a failed read of the stream did.
             char getChar()
             {
-                *s_pSrcFile >> std::noskipws >> m_currentChar;
+                m_currentChar = (s_position < s_source.size()) ? s_source[s_position] : '\0';
+                ++s_position;
                 return m_currentChar;
             }
+
+            int peek() const
+            {
+                return (s_position < s_source.size()) ? static_cast<unsigned char>(s_source[s_position]) : EOF;
+            }
+
+            void unget()
+            {
+                --s_position;
+            }
+
+            bool eof() const
+            {
+                return s_position > s_source.size();
+            }
+
+            // The C locale classes, without a call per character.
+            static bool isSpace(int a_char)
+            {
+                return a_char == ' ' || (a_char >= '\t' && a_char <= '\r');
+            }
+
+            static bool isAlpha(char a_char)
+            {
+                return (a_char >= 'a' && a_char <= 'z') || (a_char >= 'A' && a_char <= 'Z');
+            }
+
+            static bool isDigit(char a_char)
+            {
+                return a_char >= '0' && a_char <= '9';
+            }
+
+            // Moves past the run of characters a_accept takes.
+            template<typename Predicate>
+            void skip(Predicate a_accept)
+            {
+                size_t position = s_position;
+                while (position < s_source.size() && a_accept(s_source[position]))
+                {
+                    ++position;
+                }
+                s_position = position;
+            }
+
+            // Moves past a run of digits, appending them to s_numBuffer; returns how many there were.
+            size_t digits()
+            {
+                size_t   position = s_position;
+                uint32_t number   = s_numBuffer;
+                for (; position < s_source.size() && isDigit(s_source[position]); ++position)
+                {
+                    number = number * 10 + (s_source[position] - '0');
+                }
+
+                size_t count = position - s_position;
+                s_numBuffer = number;
+                s_position  = position;
+                return count;
+            }
+
+            // The source read since the current token started.
+            std::string_view lexeme() const
+            {
+                return s_source.substr(s_lexeme, s_position - s_lexeme);
+            }
+
+            // The delimeter spelled by the lexeme, or NULL; one character ones come from a table.
+            Token::Type delimeter() const
+            {
+                static const std::array<Token::Type, 256> s_singles = []()
+                {
+                    std::array<Token::Type, 256> singles{};
+                    for (auto& [spelling, type] : Token::s_delimeters)
+                    {
+                        if (spelling.size() == 1)
+                        {
+                            singles[static_cast<unsigned char>(spelling[0])] = type;
+                        }
+                    }
+                    return singles;
+                }();
+
+                std::string_view spelling = lexeme();
+                if (spelling.size() == 1)
+                {
+                    return s_singles[static_cast<unsigned char>(spelling[0])];
+                }
+
+                auto found = Token::s_delimeters.find(spelling);
+                return (found != Token::s_delimeters.end()) ? found->second : Token::Type::NULL;
+            }
     };
 
-    std::string    State::s_charBuffer{};
-    uint32_t       State::s_numBuffer{};
-    std::ifstream* State::s_pSrcFile{nullptr};
-    State::Machine State::s_stateMachine{};
-    Token          State::s_token{};
-    int            State::s_currentLine{1};
+    std::string_view State::s_source{};
+    size_t           State::s_position{};
+    size_t           State::s_lexeme{};
+    uint32_t         State::s_numBuffer{};
+    State::Machine   State::s_stateMachine{};
+    Token            State::s_token{};
+    int              State::s_currentLine{1};
+
+    SymbolTable<Token> State::s_words = []()
+    {
+        SymbolTable<Token> words{};
+        for (auto& [spelling, type] : Token::s_reservedWords)
+        {
+            words.insert(spelling, Token(type));
+        }
+        return words;
+    }();
+    SymbolTable<int> State::s_literals{};
 
     std::unordered_map<std::string, Ident> State::s_TID;
     std::unordered_map<std::string, Mark> State::s_gotoMarks;
@@ -104,26 +271,27 @@ namespace mli {
 
             State* determineToken()
             {
-                getChar();
-
-                s_charBuffer = std::string("");
-                s_numBuffer  = uint32_t(0);
-                s_token      = Token::Type::NULL;
+                s_numBuffer = uint32_t(0);
+                s_token     = Token::Type::NULL;
 
-                if (s_pSrcFile->eof())
+                for (int next = peek(); isSpace(next); next = peek())
                 {
-                    s_token = Token(Token::Type::FINISH, s_currentLine);
+                    s_currentLine += (next == '\n');
+                    ++s_position;
                 }
-                else if (std::isspace(m_currentChar))
+
+                s_lexeme = s_position;
+                getChar();
+
+                if (eof())
                 {
-                    s_currentLine += (m_currentChar == '\n');
+                    s_token = Token(Token::Type::FINISH, s_currentLine);
                 }
-                else if (std::isalpha(m_currentChar))
+                else if (isAlpha(m_currentChar))
                 {
-                    s_charBuffer.push_back(m_currentChar);
                     return reinterpret_cast<State*>(s_stateMachine.pIdentState);
                 }
-                else if (std::isdigit(m_currentChar))
+                else if (isDigit(m_currentChar))
                 {
                     s_numBuffer = m_currentChar - '0';
                     return reinterpret_cast<State*>(s_stateMachine.pNumberState);
@@ -134,30 +302,26 @@ namespace mli {
                 }
                 else if (m_currentChar == '/')
                 {
-                    s_charBuffer.push_back(m_currentChar);
                     return reinterpret_cast<State*>(s_stateMachine.pCommentState);
                 }
                 else if (m_currentChar == '<' || m_currentChar == '>')
                 {
-                    s_charBuffer.push_back(m_currentChar);
                     return reinterpret_cast<State*>(s_stateMachine.pLessGreaterState);
                 }
                 else if (m_currentChar == '!')
                 {
-                    s_charBuffer.push_back(m_currentChar);
                     return reinterpret_cast<State*>(s_stateMachine.pNotEqualState);
                 }
                 else if (m_currentChar == '=')
                 {
-                    s_charBuffer.push_back(m_currentChar);
                     return reinterpret_cast<State*>(s_stateMachine.pAssignOrEqual);
                 }
                 else
                 {
-                    s_charBuffer.push_back(m_currentChar);
-                    if (Token::Token::s_delimeters.contains(s_charBuffer))
+                    Token::Type type = delimeter();
+                    if (type != Token::Type::NULL)
                     {
-                        s_token = Token(Token::s_delimeters[s_charBuffer], s_currentLine);
+                        s_token = Token(type, s_currentLine);
                     }
                     else
                     {
@@ -175,38 +339,9 @@ namespace mli {
 
             State* determineToken() override
             {
-                getChar();
-
-                if (std::isalpha(m_currentChar) || std::isdigit(m_currentChar))
-                {
-                    s_charBuffer.push_back(m_currentChar);
-                    return this;
-                }
-
-                if (Token::s_reservedWords.contains(s_charBuffer))
-                {
-                    s_token = Token(Token::s_reservedWords[s_charBuffer], s_currentLine);
-                }
-                else if (s_TID.contains(s_charBuffer))
-                {
-                    s_token = Token(Token::Type::ID, s_currentLine, s_TID[s_charBuffer].getID());
-                }
-                else if (s_gotoMarks.contains(s_charBuffer))
-                {
-                    s_token = Token(Token::Type::GOTO_MARK, s_currentLine, s_gotoMarks[s_charBuffer].getID());
-                }
-                else if (m_currentChar == ':')
-                {
-                    s_gotoMarks[s_charBuffer] = Mark(s_charBuffer);
-                    s_token = Token(Token::Type::GOTO_MARK, s_currentLine, s_gotoMarks[s_charBuffer].getID());
-                }
-                else
-                {
-                    s_TID[s_charBuffer] = Ident(s_charBuffer);
-                    s_token = Token(Token::Type::ID, s_currentLine, s_TID[s_charBuffer].getID());
-                }
+                skip([](char a_char) { return isAlpha(a_char) || isDigit(a_char); });
+                s_token = word(lexeme(), peek() == ':');
 
-                s_pSrcFile->unget();
                 return reinterpret_cast<State*>(s_stateMachine.pInitialState);
             }
     };
@@ -217,28 +352,22 @@ namespace mli {
 
             State* determineToken()
             {
+                digits();
                 getChar();
 
-                if (std::isdigit(m_currentChar))
-                {
-                    s_numBuffer *= 10;
-                    s_numBuffer += m_currentChar - '0';
-                    return this;
-                }
-
                 if (m_currentChar == '.')
                 {
                     return reinterpret_cast<State*>(s_stateMachine.pRealState);
                 }
 
-                if (std::isalpha(m_currentChar))
+                if (isAlpha(m_currentChar))
                 {
                     throw LexicalError(s_currentLine, m_currentChar);
                 }
 
                 s_token = Token(Token::Type::INT_CONST, s_currentLine, s_numBuffer);
 
-                s_pSrcFile->unget();
+                unget();
                 return reinterpret_cast<State*>(s_stateMachine.pInitialState);
             }
     };
@@ -249,66 +378,47 @@ namespace mli {
 
             State* determineToken()
             {
-                if (s_pSrcFile->eof())
+                size_t quote = s_source.find('"', s_position);
+                if (quote == std::string_view::npos)
                 {
+                    s_position = s_source.size() + 1;
                     throw LexicalError(s_currentLine, 0);
                 }
 
-                getChar();
-
-                if (m_currentChar != '"')
-                {
-                    s_charBuffer.push_back(m_currentChar);
-                    return this;
-                }
-
-                s_strings.push_back(s_charBuffer);
-                s_token = Token(Token::Type::STRING_CONST, s_currentLine, s_strings.size() - 1);
+                std::string_view text = s_source.substr(s_position, quote - s_position);
+                s_position = quote + 1;
+                s_token = literal(text);
 
                 return reinterpret_cast<State*>(s_stateMachine.pInitialState);
             }
     };
 
+    // A '*' in a comment takes the character after it along, so an even run of stars
+    // before the '/' (as in "**/") does not close it.
     class CommentState : public State
     {
         public:
 
             State* determineToken() override
             {
-                if (s_pSrcFile->eof())
+                if (getChar() != '*')
                 {
-                    throw LexicalError(s_currentLine, 0);
+                    unget();
+                    s_token = Token(delimeter(), s_currentLine);
+                    return reinterpret_cast<State*>(s_stateMachine.pInitialState);
                 }
 
-                getChar();
-
-                if (s_charBuffer == "/")
+                while (!eof())
                 {
-                    if (m_currentChar == '*')
-                    {
-                        s_currentLine += (m_currentChar == '\n');
-                        s_charBuffer = "";
-                    }
-                    else
+                    if (getChar() == '*' && getChar() == '/')
                     {
-                        s_token = Token(Token::s_delimeters[s_charBuffer], s_currentLine);
-
-                        s_pSrcFile->unget();
                         return reinterpret_cast<State*>(s_stateMachine.pInitialState);
                     }
 
-                }
-                else if (m_currentChar == '*')
-                {
-                    getChar();
-                    if (m_currentChar == '/')
-                    {
-                        return reinterpret_cast<State*>(s_stateMachine.pInitialState);
-                    }
+                    s_currentLine += (m_currentChar == '\n');
                 }
 
-                s_currentLine += (m_currentChar == '\n');
-                return this;
+                throw LexicalError(s_currentLine, 0);
             }
     };
 
@@ -318,19 +428,13 @@ namespace mli {
 
             State* determineToken() override
             {
-                getChar();
-
-                if (m_currentChar == '=')
+                if (getChar() != '=')
                 {
-                    s_charBuffer.push_back(m_currentChar);
-                    s_token = Token(Token::s_delimeters[s_charBuffer], s_currentLine);
-                }
-                else
-                {
-                    s_pSrcFile->unget();
-                    s_token = Token(Token::s_delimeters[s_charBuffer], s_currentLine);
+                    unget();
                 }
 
+                s_token = Token(delimeter(), s_currentLine);
+
                 return reinterpret_cast<State*>(s_stateMachine.pInitialState);
             }
     };
@@ -348,8 +452,7 @@ namespace mli {
                     throw LexicalError(s_currentLine, '!');
                 }
 
-                s_charBuffer.push_back(m_currentChar);
-                s_token = Token(Token::s_delimeters[s_charBuffer], s_currentLine);
+                s_token = Token(delimeter(), s_currentLine);
 
                 return reinterpret_cast<State*>(s_stateMachine.pInitialState);
             }
@@ -361,19 +464,13 @@ namespace mli {
 
             State* determineToken() override
             {
-                getChar();
-
-                if (m_currentChar == '=')
+                if (getChar() != '=')
                 {
-                    s_charBuffer.push_back(m_currentChar);
-                    s_token = Token(Token::s_delimeters[s_charBuffer], s_currentLine);
-                }
-                else
-                {
-                    s_pSrcFile->unget();
-                    s_token = Token(Token::s_delimeters[s_charBuffer], s_currentLine);
+                    unget();
                 }
 
+                s_token = Token(delimeter(), s_currentLine);
+
                 return reinterpret_cast<State*>(s_stateMachine.pInitialState);
             }
     };
@@ -384,34 +481,142 @@ namespace mli {
 
             State* determineToken() override
             {
+                size_t fraction = digits();
                 getChar();
 
-                if (std::isalpha(m_currentChar))
+                if (isAlpha(m_currentChar))
                 {
                     throw LexicalError(s_currentLine, m_currentChar);
                 }
 
-                if (std::isdigit(m_currentChar))
-                {
-                    s_numBuffer *= 10;
-                    s_numBuffer += m_currentChar - '0';
-                    s_charBuffer.push_back(m_currentChar);
-                    return this;
+                s_token = real(s_numBuffer, fraction);
+
+                unget();
+                return reinterpret_cast<State*>(s_stateMachine.pInitialState);
+            }
+    };
+
+    // Runs LexerTable over the source: a table lookup per byte in a plain loop, and the
+    // token built once the DFA stops. Meant to read exactly what the State machine reads.
+    class Lexer
+    {
+        private:
+            std::string_view m_source;
+            size_t           m_position{};
+
+        public:
+
+            void setSource(std::string_view a_source)
+            {
+                m_source   = a_source;
+                m_position = 0;
+            }
+
+            Token getToken()
+            {
+                const LexerTable& table = LexerTable::s_table;
+                const char* source = m_source.data();
+                size_t size     = m_source.size();
+                size_t position = m_position;
+                size_t begin    = position;
+                int    line     = State::s_currentLine;
+                uint8_t state   = LexerTable::START;
+
+                while (true)
+                {
+                    uint8_t byteClass = (position < size) ? table.classes[static_cast<unsigned char>(source[position])] : LexerTable::END;
+                    uint8_t next = table.next[state][byteClass];
+                    if (next == LexerTable::STOP)
+                    {
+                        break;
+                    }
+
+                    line  += table.countsLines[state] && byteClass == LexerTable::NEWLINE;
+                    begin  = (state == LexerTable::START) ? position : begin;
+                    state  = next;
+                    ++position;
+
+                    // Runs of a state looping on itself (spaces, words, numbers, literals, comments)
+                    // need not wait on the previous lookup for the next one.
+                    const auto& row = table.next[state];
+                    bool countsLines = table.countsLines[state];
+                    while (position < size)
+                    {
+                        byteClass = table.classes[static_cast<unsigned char>(source[position])];
+                        if (row[byteClass] != state)
+                        {
+                            break;
+                        }
+                        line += countsLines && byteClass == LexerTable::NEWLINE;
+                        ++position;
+                    }
                 }
 
-                double real = static_cast<double>(s_numBuffer * std::pow(0.1, s_charBuffer.size()));
-                s_realNumbers.push_back(real);
-                s_token = Token(Token::Type::REAL_CONST, s_currentLine, s_realNumbers.size() - 1);
+                m_position = position;
+                State::s_currentLine = line;
+                std::string_view lexeme(source + begin, position - begin);
 
-                s_pSrcFile->unget();
-                return reinterpret_cast<State*>(s_stateMachine.pInitialState);
+                switch (table.accepts[state])
+                {
+                    case LexerTable::Accept::FINISH:
+                        if (position < size)
+                        {
+                            throw LexicalError(line, source[position]);
+                        }
+                        return Token(Token::Type::FINISH, line);
+
+                    case LexerTable::Accept::WORD:
+                        return State::word(lexeme, position < size && source[position] == ':');
+
+                    case LexerTable::Accept::INT:
+                    case LexerTable::Accept::REAL:
+                    {
+                        uint32_t digits = 0;
+                        size_t fraction = 0;
+                        for (size_t i = 0; i < lexeme.size(); ++i)
+                        {
+                            if (lexeme[i] == '.')
+                            {
+                                fraction = lexeme.size() - i - 1;
+                                continue;
+                            }
+                            digits = digits * 10 + (lexeme[i] - '0');
+                        }
+
+                        return (table.accepts[state] == LexerTable::Accept::INT) ? Token(Token::Type::INT_CONST, line, digits) : State::real(digits, fraction);
+                    }
+
+                    case LexerTable::Accept::STRING:
+                        return State::literal(lexeme.substr(1, lexeme.size() - 2));
+
+                    case LexerTable::Accept::DELIMETER:
+                        return Token(table.types[state], line);
+
+                    case LexerTable::Accept::UNEXPECTED_LAST:
+                        throw LexicalError(line, source[position - 1]);
+
+                    case LexerTable::Accept::UNEXPECTED_FIRST:
+                        throw LexicalError(line, source[begin]);
+
+                    case LexerTable::Accept::UNEXPECTED_EOF:
+                        break;
+                }
+
+                throw LexicalError(line, 0);
             }
     };
 
+    // Lexes straight from the source file mapped into memory; a file that cannot be
+    // mapped (an empty one, a pipe) is read into m_contents instead. The Lexer does the
+    // work; the State machine it replaced stays behind a_legacy to test it against.
     class Scanner
     {
         private:
-            std::ifstream  m_srcFile;
+            void*          m_mapping{};
+            size_t         m_mappingSize{};
+            std::string    m_contents;
+            bool           m_legacy;
+            Lexer          m_lexer;
             State::Machine m_stateMachine;
 
             InitialState     m_initialState{};
@@ -426,16 +631,43 @@ namespace mli {
 
             State* m_currentState{};
 
+            std::string_view map(const std::string& a_srcFileName)
+            {
+                int file = open(a_srcFileName.c_str(), O_RDONLY);
+                struct stat info{};
+                if (file >= 0 && fstat(file, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+                {
+                    void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+                    if (mapping != MAP_FAILED)
+                    {
+                        close(file);
+                        m_mapping     = mapping;
+                        m_mappingSize = info.st_size;
+                        return std::string_view(static_cast<const char*>(mapping), m_mappingSize);
+                    }
+                }
+                if (file >= 0)
+                {
+                    close(file);
+                }
+
+                std::ifstream srcFile{a_srcFileName, std::ios::binary};
+                m_contents.assign(std::istreambuf_iterator<char>(srcFile), std::istreambuf_iterator<char>());
+                return m_contents;
+            }
+
         public:
 
-            Scanner(const std::string& a_srcFileName)
-                : m_srcFile(std::ifstream(a_srcFileName))
+            Scanner(const std::string& a_srcFileName, bool a_legacy = false)
+                : m_legacy(a_legacy)
             {
                 if (!fs::exists(fs::path(a_srcFileName)))
                 {
                     throw std::runtime_error("[Scanner]: source file doesnt exist");
                 }
 
+                std::string_view source = map(a_srcFileName);
+
                 m_stateMachine = State::Machine{
                     &m_initialState,
                         &m_identState,
@@ -448,21 +680,30 @@ namespace mli {
                         &m_realState
                 };
 
+                m_lexer.setSource(source);
                 m_currentState = &m_initialState;
-                m_currentState->setSrcFile(&m_srcFile);
+                m_currentState->setSource(source);
                 m_currentState->setStateMachine(m_stateMachine);
             }
 
+            Scanner(const Scanner&) = delete;
+            Scanner& operator=(const Scanner&) = delete;
+
             ~Scanner()
             {
-                if (m_srcFile.is_open())
+                if (m_mapping)
                 {
-                    m_srcFile.close();
+                    munmap(m_mapping, m_mappingSize);
                 }
             }
 
             Token getToken()
             {
+                if (!m_legacy)
+                {
+                    return m_lexer.getToken();
+                }
+
                 Token undeterminedToken{};
                 Token fetchedToken{};
 
@@ -190,6 +190,11 @@ namespace mli {
                 return m_declaredVariables[a_token.getValue()];
             }
 
+            const std::vector<Ident>& fetchVariables() const
+            {
+                return m_declaredVariables;
+            }
+
             Mark& fetchMark(const Token& a_token)
             {
                 return m_gotoMarks[a_token.getValue()];
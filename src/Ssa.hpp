@@ -0,0 +1,275 @@
+#ifndef SSA_HPP
+#define SSA_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "Bytecode.hpp"
+#include "ControlFlow.hpp"
+
+namespace mli {
+
+    struct SsaValue
+    {
+        enum class Kind : uint8_t { ENTRY, DEFINITION, PHI };
+
+        Kind                 kind{Kind::ENTRY};
+        int32_t              variable{};
+        int32_t              site{};
+        std::vector<int32_t> operands;
+    };
+
+    // SSA numbering of the program variables over the control flow graph (Cytron et al.).
+    // Operand-stack values never cross statements except for lazy and/or, so only variables are renamed.
+    // ENTRY values stand for a variable before its first assignment; reading one is an error.
+    class SsaForm
+    {
+        private:
+            const ControlFlowGraph&           m_cfg;
+            const Program&                    m_program;
+            std::vector<SsaValue>             m_values;
+            std::vector<int32_t>              m_uses;
+            std::vector<int32_t>              m_defs;
+            std::vector<std::vector<int32_t>> m_phis;
+            std::vector<bool>                 m_maybeUnassigned;
+            std::vector<bool>                 m_definitelyUnassigned;
+
+            std::vector<std::vector<int32_t>> m_stacks;
+
+            void place()
+            {
+                const std::vector<Instruction>& code = m_program.code();
+                std::vector<std::vector<int32_t>> definedIn(variables());
+
+                for (int32_t block : m_cfg.reversePostorder())
+                {
+                    for (int32_t i = m_cfg.block(block).begin; i < m_cfg.block(block).end; ++i)
+                    {
+                        int32_t variable = defined(code[i]);
+                        if (variable != -1 && (definedIn[variable].empty() || definedIn[variable].back() != block))
+                        {
+                            definedIn[variable].push_back(block);
+                        }
+                    }
+                }
+
+                for (int32_t variable = 0; variable < variables(); ++variable)
+                {
+                    std::vector<bool> placed(m_cfg.blocks().size());
+                    std::vector<int32_t> worklist = definedIn[variable];
+
+                    while (!worklist.empty())
+                    {
+                        int32_t block = worklist.back();
+                        worklist.pop_back();
+
+                        for (int32_t frontier : m_cfg.block(block).frontier)
+                        {
+                            if (placed[frontier])
+                            {
+                                continue;
+                            }
+
+                            placed[frontier] = true;
+                            m_phis[frontier].push_back(m_values.size());
+                            m_values.push_back(SsaValue{SsaValue::Kind::PHI, variable, frontier,
+                                std::vector<int32_t>(m_cfg.block(frontier).predecessors.size(), -1)});
+                            worklist.push_back(frontier);
+                        }
+                    }
+                }
+            }
+
+            void rename(int32_t a_block)
+            {
+                const std::vector<Instruction>& code = m_program.code();
+                const BasicBlock& block = m_cfg.block(a_block);
+                std::vector<int32_t> pushed{};
+
+                for (int32_t phi : m_phis[a_block])
+                {
+                    m_stacks[m_values[phi].variable].push_back(phi);
+                    pushed.push_back(m_values[phi].variable);
+                }
+
+                for (int32_t i = block.begin; i < block.end; ++i)
+                {
+                    int32_t used = usedVariable(code[i]);
+                    if (used != -1)
+                    {
+                        m_uses[i] = m_stacks[used].back();
+                    }
+
+                    int32_t variable = defined(code[i]);
+                    if (variable != -1)
+                    {
+                        m_defs[i] = m_values.size();
+                        m_values.push_back(SsaValue{SsaValue::Kind::DEFINITION, variable, i, {}});
+                        m_stacks[variable].push_back(m_defs[i]);
+                        pushed.push_back(variable);
+                    }
+                }
+
+                for (int32_t successor : block.successors)
+                {
+                    const std::vector<int32_t>& predecessors = m_cfg.block(successor).predecessors;
+                    for (int32_t phi : m_phis[successor])
+                    {
+                        for (size_t k = 0; k < predecessors.size(); ++k)
+                        {
+                            if (predecessors[k] == a_block)
+                            {
+                                m_values[phi].operands[k] = m_stacks[m_values[phi].variable].back();
+                            }
+                        }
+                    }
+                }
+
+                for (int32_t child : block.children)
+                {
+                    rename(child);
+                }
+
+                for (int32_t variable : pushed)
+                {
+                    m_stacks[variable].pop_back();
+                }
+            }
+
+            void assignment()
+            {
+                m_maybeUnassigned.assign(m_values.size(), false);
+                m_definitelyUnassigned.assign(m_values.size(), false);
+                for (size_t value = 0; value < m_values.size(); ++value)
+                {
+                    m_maybeUnassigned[value]      = (m_values[value].kind == SsaValue::Kind::ENTRY);
+                    m_definitelyUnassigned[value] = (m_values[value].kind != SsaValue::Kind::DEFINITION);
+                }
+
+                bool changed = true;
+                while (changed)
+                {
+                    changed = false;
+                    for (size_t value = 0; value < m_values.size(); ++value)
+                    {
+                        if (m_values[value].kind != SsaValue::Kind::PHI)
+                        {
+                            continue;
+                        }
+
+                        for (int32_t operand : m_values[value].operands)
+                        {
+                            if (operand != -1 && m_maybeUnassigned[operand] && !m_maybeUnassigned[value])
+                            {
+                                m_maybeUnassigned[value] = changed = true;
+                            }
+                            if (operand != -1 && !m_definitelyUnassigned[operand] && m_definitelyUnassigned[value])
+                            {
+                                m_definitelyUnassigned[value] = false;
+                                changed = true;
+                            }
+                        }
+                    }
+                }
+            }
+
+        public:
+
+            SsaForm(const ControlFlowGraph& a_cfg)
+                : m_cfg(a_cfg), m_program(a_cfg.program())
+                , m_uses(m_program.code().size(), -1), m_defs(m_program.code().size(), -1)
+                , m_phis(a_cfg.blocks().size()), m_stacks(variables())
+            {
+                for (int32_t variable = 0; variable < variables(); ++variable)
+                {
+                    m_values.push_back(SsaValue{SsaValue::Kind::ENTRY, variable, -1, {}});
+                    m_stacks[variable].push_back(variable);
+                }
+
+                place();
+                rename(0);
+                assignment();
+            }
+
+            int32_t variables() const
+            {
+                return m_program.intSlots() + m_program.realSlots() + m_program.stringSlots();
+            }
+
+            int32_t variable(Token::Type a_type, int32_t a_slot) const
+            {
+                return (a_type == Token::Type::INT) ? a_slot
+                    : (a_type == Token::Type::REAL) ? m_program.intSlots() + a_slot
+                    : m_program.intSlots() + m_program.realSlots() + a_slot;
+            }
+
+            Token::Type typeOf(int32_t a_variable) const
+            {
+                return (a_variable < m_program.intSlots()) ? Token::Type::INT
+                    : (a_variable < m_program.intSlots() + m_program.realSlots()) ? Token::Type::REAL : Token::Type::STRING;
+            }
+
+            int32_t usedVariable(const Instruction& a_instruction) const
+            {
+                Opcode opcode = a_instruction.opcode;
+                if ((opcode >= Opcode::LOAD_INT && opcode <= Opcode::LOAD_STRING) || opcode == Opcode::APPEND_STRING)
+                {
+                    return variable(slotType(opcode), a_instruction.operand);
+                }
+                if (opcode == Opcode::INC_INT || opcode == Opcode::LOAD_INT_PUSH_INT)
+                {
+                    return variable(Token::Type::INT, a_instruction.arity);
+                }
+                return -1;
+            }
+
+            int32_t defined(const Instruction& a_instruction) const
+            {
+                Opcode opcode = a_instruction.opcode;
+                if (opcode >= Opcode::STORE_INT && opcode <= Opcode::APPEND_STRING)
+                {
+                    return variable(slotType(opcode), a_instruction.operand);
+                }
+                if (opcode == Opcode::INC_INT)
+                {
+                    return variable(Token::Type::INT, a_instruction.arity);
+                }
+                return -1;
+            }
+
+            const std::vector<SsaValue>& values() const
+            {
+                return m_values;
+            }
+
+            // The value an instruction reads, or -1.
+            int32_t use(int32_t a_instruction) const
+            {
+                return m_uses[a_instruction];
+            }
+
+            // The value an instruction defines, or -1.
+            int32_t def(int32_t a_instruction) const
+            {
+                return m_defs[a_instruction];
+            }
+
+            const std::vector<int32_t>& phis(int32_t a_block) const
+            {
+                return m_phis[a_block];
+            }
+
+            bool maybeUnassigned(int32_t a_value) const
+            {
+                return m_maybeUnassigned[a_value];
+            }
+
+            // No path assigns the variable before this value is read.
+            bool definitelyUnassigned(int32_t a_value) const
+            {
+                return m_definitelyUnassigned[a_value];
+            }
+    };
+}
+
+#endif // SSA_HPP
@@ -0,0 +1,98 @@
+#ifndef STRING_HEAP_HPP
+#define STRING_HEAP_HPP
+
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mli {
+
+    class StringHeap
+    {
+        private:
+            struct Entry
+            {
+                std::string value;
+                uint32_t    references{};
+            };
+
+            std::vector<Entry>    m_entries;
+            std::vector<uint32_t> m_free;
+
+        public:
+
+            void clear()
+            {
+                m_entries.clear();
+                m_free.clear();
+            }
+
+            uint32_t allocate(std::string&& a_value)
+            {
+                uint32_t handle{};
+
+                if (m_free.empty())
+                {
+                    handle = m_entries.size();
+                    m_entries.emplace_back();
+                }
+                else
+                {
+                    handle = m_free.back();
+                    m_free.pop_back();
+                }
+
+                m_entries[handle].value      = std::move(a_value);
+                m_entries[handle].references = 1;
+
+                return handle;
+            }
+
+            void retain(uint32_t a_handle)
+            {
+                assert(m_entries[a_handle].references && "retain of a dead string");
+                ++m_entries[a_handle].references;
+            }
+
+            void release(uint32_t a_handle)
+            {
+                Entry& entry = m_entries[a_handle];
+                assert(entry.references && "release of a dead string");
+
+                if (--entry.references == 0)
+                {
+                    std::string{}.swap(entry.value);
+                    m_free.push_back(a_handle);
+                }
+            }
+
+            const std::string& get(uint32_t a_handle) const
+            {
+                return m_entries[a_handle].value;
+            }
+
+            std::string& edit(uint32_t a_handle)
+            {
+                assert(m_entries[a_handle].references == 1 && "edit of a shared string");
+                return m_entries[a_handle].value;
+            }
+
+            bool isUnique(uint32_t a_handle) const
+            {
+                return m_entries[a_handle].references == 1;
+            }
+
+            size_t liveCount() const
+            {
+                return m_entries.size() - m_free.size();
+            }
+
+            size_t capacity() const
+            {
+                return m_entries.size();
+            }
+    };
+}
+
+#endif // STRING_HEAP_HPP
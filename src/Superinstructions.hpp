@@ -0,0 +1,155 @@
+#ifndef SUPERINSTRUCTIONS_HPP
+#define SUPERINSTRUCTIONS_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "Bytecode.hpp"
+
+namespace mli {
+
+    class Fuser
+    {
+        private:
+            Program m_program;
+
+            bool threadLazyJumps()
+            {
+                std::vector<Instruction>& code = m_program.code();
+                std::vector<bool> targets = m_program.jumpTargets();
+                std::vector<bool> removed(code.size() + 1);
+                bool changed{};
+
+                for (size_t i = code.size(); i-- > 0;)
+                {
+                    Opcode opcode = code[i].opcode;
+                    if (opcode != Opcode::JUMP_FALSE_LAZY && opcode != Opcode::JUMP_TRUE_LAZY)
+                    {
+                        continue;
+                    }
+
+                    int32_t target = code[i].operand;
+                    Opcode  next   = code[target].opcode;
+                    Opcode  joiner = (opcode == Opcode::JUMP_FALSE_LAZY) ? Opcode::AND : Opcode::OR;
+
+                    if ((next != Opcode::JUMP_FALSE && next != Opcode::JUMP_TRUE)
+                        || code[target - 1].opcode != joiner || targets[target - 1] || removed[target - 1])
+                    {
+                        continue;
+                    }
+
+                    bool    value       = (opcode == Opcode::JUMP_TRUE_LAZY);
+                    bool    jumpsOnPass = (next == Opcode::JUMP_TRUE) == value;
+                    int32_t destination = jumpsOnPass ? code[target].operand : target + 1;
+
+                    if (removed[destination])
+                    {
+                        continue;
+                    }
+
+                    code[i].opcode  = value ? Opcode::JUMP_TRUE : Opcode::JUMP_FALSE;
+                    code[i].operand = destination;
+                    targets[destination] = true;
+                    removed[target - 1]  = true;
+                    changed = true;
+                }
+
+                if (changed)
+                {
+                    m_program.compact(removed);
+                }
+
+                return changed;
+            }
+
+            static Opcode comparisonJump(Opcode a_comparison)
+            {
+                int offset = static_cast<int>(a_comparison) - static_cast<int>(Opcode::EQ_INT);
+                return static_cast<Opcode>(static_cast<int>(Opcode::EQ_INT_JUMP_FALSE) + offset);
+            }
+
+            // INC_INT and LOAD_INT_PUSH_INT read without an assignment check, so checked loads stay unfused.
+            void fusePatterns()
+            {
+                std::vector<Instruction>& code = m_program.code();
+                std::vector<bool> targets = m_program.jumpTargets();
+                std::vector<bool> removed(code.size() + 1);
+
+                auto straight = [&](size_t a_first, size_t a_length)
+                {
+                    if (a_first + a_length > code.size())
+                    {
+                        return false;
+                    }
+
+                    for (size_t i = a_first + 1; i < a_first + a_length; ++i)
+                    {
+                        if (targets[i])
+                        {
+                            return false;
+                        }
+                    }
+
+                    return true;
+                };
+
+                for (size_t i = 0; i < code.size(); ++i)
+                {
+                    const Instruction& first = code[i];
+
+                    if (first.opcode == Opcode::LOAD_INT && !(first.arity & Instruction::s_checked) && first.operand <= UINT16_MAX && straight(i, 4)
+                        && code[i + 1].opcode == Opcode::PUSH_INT
+                        && (code[i + 2].opcode == Opcode::ADD_INT || code[i + 2].opcode == Opcode::SUB_INT)
+                        && code[i + 3].opcode == Opcode::STORE_INT && code[i + 3].operand == first.operand)
+                    {
+                        int64_t step = code[i + 1].operand;
+                        if (code[i + 2].opcode == Opcode::SUB_INT)
+                        {
+                            step = -step;
+                        }
+
+                        code[i] = Instruction{Opcode::INC_INT, static_cast<uint16_t>(first.operand),
+                            static_cast<int32_t>(static_cast<uint32_t>(step))};
+                        removed[i + 1] = removed[i + 2] = removed[i + 3] = true;
+                        i += 3;
+                    }
+                    else if (first.opcode >= Opcode::EQ_INT && first.opcode <= Opcode::GEQ_INT && straight(i, 2)
+                        && code[i + 1].opcode == Opcode::JUMP_FALSE)
+                    {
+                        code[i] = Instruction{comparisonJump(first.opcode), 0, code[i + 1].operand};
+                        removed[i + 1] = true;
+                        i += 1;
+                    }
+                    else if (first.opcode == Opcode::LOAD_INT && !(first.arity & Instruction::s_checked) && first.operand <= UINT16_MAX && straight(i, 2)
+                        && code[i + 1].opcode == Opcode::PUSH_INT)
+                    {
+                        code[i] = Instruction{Opcode::LOAD_INT_PUSH_INT, static_cast<uint16_t>(first.operand), code[i + 1].operand};
+                        removed[i + 1] = true;
+                        i += 1;
+                    }
+                }
+
+                m_program.compact(removed);
+            }
+
+        public:
+
+            Fuser(const Program& a_program)
+                : m_program(a_program)
+            {
+            }
+
+            Program fuse()
+            {
+                while (threadLazyJumps())
+                {
+                }
+
+                fusePatterns();
+                m_program.setMaxDepth(Verifier(m_program).verify());
+                return m_program;
+            }
+    };
+}
+
+#endif // SUPERINSTRUCTIONS_HPP
@@ -0,0 +1,111 @@
+#ifndef SYMBOL_TABLE_HPP
+#define SYMBOL_TABLE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace mli {
+
+    // Interns names for the scanner: each is copied once, and looking one up by a view into
+    // the source is a hash, a shift and usually a single comparison (open addressing over a
+    // power of two table kept at most half full).
+    template<typename T>
+    class SymbolTable
+    {
+        private:
+            struct Entry
+            {
+                std::string name;
+                T           value{};
+                uint64_t    hash{};
+                bool        used{};
+            };
+
+            std::vector<Entry> m_entries;
+            size_t             m_size{};
+            int                m_shift{};
+
+            // Eight bytes a multiply; only the high bits are well mixed, so slot() starts from those.
+            static uint64_t hash(std::string_view a_name)
+            {
+                uint64_t hash = 14695981039346656037ull ^ a_name.size();
+                const char* data = a_name.data();
+                for (size_t left = a_name.size(); left > 0; )
+                {
+                    uint64_t chunk = 0;
+                    size_t   step  = std::min<size_t>(left, sizeof(chunk));
+                    std::memcpy(&chunk, data, step);
+                    hash = (hash ^ chunk) * 0x9E3779B97F4A7C15ull;
+                    data += step;
+                    left -= step;
+                }
+                return hash;
+            }
+
+            size_t slot(std::string_view a_name, uint64_t a_hash) const
+            {
+                size_t mask = m_entries.size() - 1;
+                for (size_t i = a_hash >> m_shift; ; i = (i + 1) & mask)
+                {
+                    const Entry& entry = m_entries[i];
+                    if (!entry.used || (entry.hash == a_hash && entry.name == a_name))
+                    {
+                        return i;
+                    }
+                }
+            }
+
+            void grow()
+            {
+                std::vector<Entry> entries(m_entries.size() * 2);
+                std::swap(entries, m_entries);
+                --m_shift;
+
+                for (Entry& entry : entries)
+                {
+                    if (entry.used)
+                    {
+                        m_entries[slot(entry.name, entry.hash)] = std::move(entry);
+                    }
+                }
+            }
+
+        public:
+
+            SymbolTable()
+                : m_entries(64), m_shift(64 - 6)
+            {
+            }
+
+            const T* find(std::string_view a_name) const
+            {
+                const Entry& entry = m_entries[slot(a_name, hash(a_name))];
+                return entry.used ? &entry.value : nullptr;
+            }
+
+            // Adds a_name unless it is there already; either way returns its value.
+            T& insert(std::string_view a_name, T a_value)
+            {
+                if ((m_size + 1) * 2 > m_entries.size())
+                {
+                    grow();
+                }
+
+                uint64_t code = hash(a_name);
+                Entry& entry = m_entries[slot(a_name, code)];
+                if (!entry.used)
+                {
+                    entry = Entry{std::string(a_name), std::move(a_value), code, true};
+                    ++m_size;
+                }
+                return entry.value;
+            }
+    };
+}
+
+#endif // SYMBOL_TABLE_HPP
@@ -0,0 +1,79 @@
+#ifndef TIERED_MACHINE_HPP
+#define TIERED_MACHINE_HPP
+
+#include <cstdint>
+#include <iostream>
+
+#include "Bytecode.hpp"
+#include "Jit.hpp"
+#include "VirtualMachine.hpp"
+
+namespace mli {
+
+    class TieredMachine
+    {
+        private:
+            VirtualMachine m_interpreter;
+            JitMachine     m_jit;
+            uint32_t       m_threshold;
+            bool           m_trace;
+            bool           m_compileTried{};
+            bool           m_compiled{};
+
+            bool tierUp(const Program& a_program, int32_t a_header)
+            {
+                if (!m_compileTried)
+                {
+                    m_compileTried = true;
+                    m_compiled     = m_jit.compile(a_program);
+
+                    if (!m_compiled && m_trace)
+                    {
+                        std::cerr << "[Tiered]: " << m_jit.reason() << ", staying in the interpreter\n";
+                    }
+                }
+
+                if (!m_compiled || !m_interpreter.stackEmpty() || !m_jit.canEnter(a_header))
+                {
+                    return false;
+                }
+
+                if (m_trace)
+                {
+                    std::cerr << "[Tiered]: loop at " << a_header << " is hot, entering native code\n";
+                }
+
+                return true;
+            }
+
+        public:
+
+            static constexpr uint32_t s_defaultThreshold = 1000;
+
+            TieredMachine(uint32_t a_threshold = s_defaultThreshold, bool a_trace = false)
+                : m_threshold(a_threshold), m_trace(a_trace)
+            {
+            }
+
+            void execute(const Program& a_program)
+            {
+                m_compileTried = false;
+                m_compiled     = false;
+
+                int32_t header = m_interpreter.executeTiered(a_program, m_threshold);
+                while (header != VirtualMachine::s_halted)
+                {
+                    if (tierUp(a_program, header))
+                    {
+                        m_jit.resume(m_interpreter.snapshot(), header);
+                        return;
+                    }
+
+                    header = m_interpreter.resume(a_program, header);
+                }
+                OutputBuffer::standard().flush();
+            }
+    };
+}
+
+#endif // TIERED_MACHINE_HPP
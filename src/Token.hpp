@@ -1,9 +1,14 @@
 #ifndef TOKEN_HPP
 #define TOKEN_HPP
 
+#include <algorithm>
+#include <functional>
+#include <iterator>
 #include <map>
 #include <ostream>
 #include <string>
+#include <string_view>
+#include <utility>
 
 #undef NULL
 
@@ -87,7 +92,7 @@ namespace mli {
                     return elem.second == a_tokenType;
                 };
 
-                auto tokenString = [mapCheck](std::map<std::string, Token::Type> a_map) -> std::string
+                auto tokenString = [mapCheck](const std::map<std::string, Token::Type, std::less<>>& a_map) -> std::string
                 {
                     auto mapPair = std::find_if(a_map.begin(), a_map.end(), mapCheck);
 
@@ -181,8 +186,53 @@ namespace mli {
                 return a_out;
             }
 
-            static std::map<std::string, Token::Type> s_reservedWords;
-            static std::map<std::string, Token::Type> s_delimeters;
+            using Spelling = std::pair<std::string_view, Token::Type>;
+
+            // The spellings every table of the scanners is built from, the lexer's at compile time.
+            static constexpr Spelling s_reservedSpellings[] {
+                { "",        Token::Type::NULL },
+                    { "program", Token::Type::ENTRY },
+                    { "int",     Token::Type::INT },
+                    { "string",  Token::Type::STRING },
+                    { "real",    Token::Type::REAL },
+                    { "goto",    Token::Type::GOTO },
+                    { "case_of", Token::Type::CASE_OF },
+                    { "while",   Token::Type::WHILE },
+                    { "do",      Token::Type::DO },
+                    { "read",    Token::Type::READ },
+                    { "write",   Token::Type::WRITE },
+                    { "not",     Token::Type::NOT },
+                    { "and",     Token::Type::AND },
+                    { "if",      Token::Type::IF },
+                    { "else",    Token::Type::ELSE },
+                    { "or",      Token::Type::OR }
+            };
+
+            static constexpr Spelling s_delimeterSpellings[] {
+                { "",  Token::Token::Type::NULL },
+                    { "{",  Token::Type::BEGIN },
+                    { "}",  Token::Type::END },
+                    { ";",  Token::Type::SEMICOLON },
+                    { ":",  Token::Type::COLON },
+                    { ",",  Token::Type::COMMA },
+                    { "=",  Token::Type::ASSIGN },
+                    { "\"", Token::Type::PARENTHESIS },
+                    { "(",  Token::Type::OPEN_B },
+                    { ")",  Token::Type::CLOSE_B },
+                    { "==", Token::Type::EQ },
+                    { "<",  Token::Type::LESS },
+                    { ">",  Token::Type::GREATER },
+                    { "!=", Token::Type::NEQ },
+                    { "<=", Token::Type::LEQ },
+                    { ">=", Token::Type::GEQ },
+                    { "+",  Token::Type::PLUS },
+                    { "-",  Token::Type::MINUS },
+                    { "*",  Token::Type::MULTIPLY },
+                    { "/",  Token::Type::DIVIDE }
+            };
+
+            static std::map<std::string, Token::Type, std::less<>> s_reservedWords;
+            static std::map<std::string, Token::Type, std::less<>> s_delimeters;
 
         private:
             Token::Type m_type;
@@ -190,46 +240,12 @@ namespace mli {
             int    m_value;
     };
 
-    std::map<std::string, Token::Type> Token::s_reservedWords {
-        { "",        Token::Type::NULL },
-            { "program", Token::Type::ENTRY },
-            { "int",     Token::Type::INT },
-            { "string",  Token::Type::STRING },
-            { "real",    Token::Type::REAL },
-            { "goto",    Token::Type::GOTO },
-            { "case_of", Token::Type::CASE_OF },
-            { "while",   Token::Type::WHILE },
-            { "do",      Token::Type::DO },
-            { "read",    Token::Type::READ },
-            { "write",   Token::Type::WRITE },
-            { "not",     Token::Type::NOT },
-            { "and",     Token::Type::AND },
-            { "if",      Token::Type::IF },
-            { "else",    Token::Type::ELSE },
-            { "or",      Token::Type::OR }
+    std::map<std::string, Token::Type, std::less<>> Token::s_reservedWords {
+        std::begin(Token::s_reservedSpellings), std::end(Token::s_reservedSpellings)
     };
 
-    std::map<std::string, Token::Type> Token::s_delimeters {
-        { "",  Token::Token::Type::NULL },
-            { "{",  Token::Type::BEGIN },
-            { "}",  Token::Type::END },
-            { ";",  Token::Type::SEMICOLON },
-            { ":",  Token::Type::COLON },
-            { ",",  Token::Type::COMMA },
-            { "=",  Token::Type::ASSIGN },
-            { "\"", Token::Type::PARENTHESIS },
-            { "(",  Token::Type::OPEN_B },
-            { ")",  Token::Type::CLOSE_B },
-            { "==", Token::Type::EQ },
-            { "<",  Token::Type::LESS },
-            { ">",  Token::Type::GREATER },
-            { "!=", Token::Type::NEQ },
-            { "<=", Token::Type::LEQ },
-            { ">=", Token::Type::GEQ },
-            { "+",  Token::Type::PLUS },
-            { "-",  Token::Type::MINUS },
-            { "*",  Token::Type::MULTIPLY },
-            { "/",  Token::Type::DIVIDE }
+    std::map<std::string, Token::Type, std::less<>> Token::s_delimeters {
+        std::begin(Token::s_delimeterSpellings), std::end(Token::s_delimeterSpellings)
     };
 }
 
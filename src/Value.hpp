@@ -0,0 +1,94 @@
+#ifndef VALUE_HPP
+#define VALUE_HPP
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+namespace mli {
+
+    class Value
+    {
+        private:
+            static constexpr uint64_t s_tagMask     = 0xFFFF000000000000ull;
+            static constexpr uint64_t s_payloadMask = 0x00000000FFFFFFFFull;
+            static constexpr uint64_t s_intTag      = 0xFFF9000000000000ull;
+            static constexpr uint64_t s_stringTag   = 0xFFFA000000000000ull;
+            static constexpr uint64_t s_canonicalNaN = 0x7FF8000000000000ull;
+
+            uint64_t m_bits{s_intTag};
+
+            constexpr explicit Value(uint64_t a_bits)
+                : m_bits(a_bits)
+            {
+            }
+
+        public:
+
+            constexpr Value() = default;
+
+            static constexpr Value fromInt(int32_t a_value)
+            {
+                return Value(s_intTag | static_cast<uint32_t>(a_value));
+            }
+
+            static Value fromReal(double a_value)
+            {
+                return Value(std::isnan(a_value) ? s_canonicalNaN : std::bit_cast<uint64_t>(a_value));
+            }
+
+            static constexpr Value fromString(uint32_t a_handle)
+            {
+                return Value(s_stringTag | a_handle);
+            }
+
+            constexpr bool isInt() const
+            {
+                return (m_bits & s_tagMask) == s_intTag;
+            }
+
+            constexpr bool isString() const
+            {
+                return (m_bits & s_tagMask) == s_stringTag;
+            }
+
+            constexpr bool isReal() const
+            {
+                return m_bits < s_intTag;
+            }
+
+            constexpr int32_t asInt() const
+            {
+                return static_cast<int32_t>(static_cast<uint32_t>(m_bits & s_payloadMask));
+            }
+
+            double asReal() const
+            {
+                return std::bit_cast<double>(m_bits);
+            }
+
+            constexpr uint32_t asString() const
+            {
+                return static_cast<uint32_t>(m_bits & s_payloadMask);
+            }
+
+            double toReal() const
+            {
+                return isInt() ? static_cast<double>(asInt()) : asReal();
+            }
+
+            int32_t toInt() const
+            {
+                return isInt() ? asInt() : static_cast<int32_t>(asReal());
+            }
+
+            constexpr uint64_t bits() const
+            {
+                return m_bits;
+            }
+    };
+
+    static_assert(sizeof(Value) == 8);
+}
+
+#endif // VALUE_HPP
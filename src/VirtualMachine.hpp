@@ -0,0 +1,765 @@
+#ifndef VIRTUAL_MACHINE_HPP
+#define VIRTUAL_MACHINE_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Bytecode.hpp"
+#include "InputBuffer.hpp"
+#include "OpcodeProfile.hpp"
+#include "OutputBuffer.hpp"
+#include "StringHeap.hpp"
+#include "Value.hpp"
+
+#if defined(__GNUC__)
+#define MLI_THREADED_DISPATCH
+#endif
+
+namespace mli {
+
+    struct VariableState
+    {
+        std::vector<int32_t>     ints;
+        std::vector<double>      reals;
+        std::vector<std::string> strings;
+        std::vector<uint8_t>     intAssigned;
+        std::vector<uint8_t>     realAssigned;
+        std::vector<uint8_t>     stringAssigned;
+    };
+
+    class VirtualMachine
+    {
+        private:
+            std::vector<Value> m_stack;
+            Value*             m_top{};
+
+            std::vector<int32_t>  m_ints;
+            std::vector<double>   m_reals;
+            std::vector<uint32_t> m_strings;
+            std::vector<uint8_t>  m_intAssigned;
+            std::vector<uint8_t>  m_realAssigned;
+            std::vector<uint8_t>  m_stringAssigned;
+
+            StringHeap            m_heap;
+            std::vector<uint32_t> m_constants;
+            OpcodeProfile*        m_profile{};
+            std::vector<uint32_t> m_backEdges;
+            uint32_t              m_tierThreshold{};
+
+            static int32_t wrap(int64_t a_value)
+            {
+                return static_cast<int32_t>(static_cast<uint32_t>(a_value));
+            }
+
+            static int32_t readInt()
+            {
+                return InputBuffer::standard().readInt();
+            }
+
+            static double readReal()
+            {
+                return InputBuffer::standard().readReal();
+            }
+
+            uint32_t readString()
+            {
+                return m_heap.allocate(InputBuffer::standard().readString());
+            }
+
+            void release(Value a_value)
+            {
+                if (a_value.isString())
+                {
+                    m_heap.release(a_value.asString());
+                }
+            }
+
+            void storeString(int32_t a_slot, uint32_t a_handle)
+            {
+                if (m_stringAssigned[a_slot])
+                {
+                    m_heap.release(m_strings[a_slot]);
+                }
+
+                m_strings[a_slot]        = a_handle;
+                m_stringAssigned[a_slot] = true;
+            }
+
+            static void assignedCheck(const std::vector<uint8_t>& a_assigned, int32_t a_slot)
+            {
+                if (!a_assigned[a_slot])
+                {
+                    throw std::runtime_error("variable is not assigned");
+                }
+            }
+
+            static void assignedCheck(const std::vector<uint8_t>& a_assigned, const Instruction* a_load)
+            {
+                if (a_load->arity & Instruction::s_checked)
+                {
+                    assignedCheck(a_assigned, a_load->operand);
+                }
+            }
+
+            static void divisorCheck(int32_t a_divisor, const Instruction* a_division)
+            {
+                if ((a_division->arity & Instruction::s_checked) && a_divisor == 0)
+                {
+                    throw std::runtime_error("division by zero");
+                }
+            }
+
+            void write(Value a_value)
+            {
+                if (a_value.isString())
+                {
+                    OutputBuffer::standard().write(m_heap.get(a_value.asString()));
+                    m_heap.release(a_value.asString());
+                }
+                else if (a_value.isReal())
+                {
+                    OutputBuffer::standard().write(a_value.asReal());
+                }
+                else
+                {
+                    OutputBuffer::standard().write(a_value.asInt());
+                }
+            }
+
+            uint32_t concatenate(uint32_t a_head, const Value* a_tail, size_t a_count)
+            {
+                size_t length = m_heap.get(a_head).size();
+                for (size_t i = 0; i < a_count; ++i)
+                {
+                    length += m_heap.get(a_tail[i].asString()).size();
+                }
+
+                uint32_t result = a_head;
+                if (!m_heap.isUnique(a_head))
+                {
+                    std::string copy{};
+                    copy.reserve(length);
+                    copy += m_heap.get(a_head);
+                    m_heap.release(a_head);
+                    result = m_heap.allocate(std::move(copy));
+                }
+
+                std::string& target = m_heap.edit(result);
+                if (target.capacity() < length)
+                {
+                    target.reserve(std::max(length, 2 * target.capacity()));
+                }
+
+                for (size_t i = 0; i < a_count; ++i)
+                {
+                    target += m_heap.get(a_tail[i].asString());
+                    m_heap.release(a_tail[i].asString());
+                }
+
+                return result;
+            }
+
+            template<typename Compare>
+            bool compareStrings(Value a_left, Value a_right, Compare a_compare)
+            {
+                bool result = a_compare(m_heap.get(a_left.asString()), m_heap.get(a_right.asString()));
+                m_heap.release(a_left.asString());
+                m_heap.release(a_right.asString());
+                return result;
+            }
+
+            void reset(const Program& a_program)
+            {
+                if (a_program.maxDepth() < 0)
+                {
+                    throw std::runtime_error("[VirtualMachine]: program was not verified");
+                }
+
+                m_stack.assign(a_program.maxDepth(), Value{});
+                m_top = m_stack.data();
+
+                m_ints.assign(a_program.intSlots(), 0);
+                m_reals.assign(a_program.realSlots(), 0.0);
+                m_strings.assign(a_program.stringSlots(), 0);
+                m_intAssigned.assign(a_program.intSlots(), false);
+                m_realAssigned.assign(a_program.realSlots(), false);
+                m_stringAssigned.assign(a_program.stringSlots(), false);
+
+                m_heap.clear();
+                m_constants.clear();
+                for (auto& string : a_program.strings())
+                {
+                    m_constants.push_back(m_heap.allocate(std::string(string)));
+                }
+            }
+
+            template<bool t_profile, bool t_tiered>
+            int32_t run(const Program& a_program, int32_t a_start)
+            {
+                const Instruction* code  = a_program.code().data();
+                const Instruction* pc    = code + a_start;
+                const double*      reals = a_program.reals().data();
+                Value*             top   = m_top;
+
+#ifdef MLI_THREADED_DISPATCH
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+                static void* s_dispatchTable[] = {
+#define MLI_DISPATCH_LABEL(name) &&op_##name,
+                    MLI_OPCODES(MLI_DISPATCH_LABEL)
+#undef MLI_DISPATCH_LABEL
+                };
+
+#define MLI_PROFILE()   if constexpr (t_profile) { m_profile->record(pc->opcode, pc - code); }
+#define MLI_BACK_EDGE() if constexpr (t_tiered) { if (pc->operand <= pc - code && ++m_backEdges[pc->operand] == m_tierThreshold) { m_top = top; return pc->operand; } }
+#define MLI_CASE(name)  op_##name:
+#define MLI_NEXT()      { ++pc; MLI_PROFILE(); goto *s_dispatchTable[static_cast<int>(pc->opcode)]; }
+#define MLI_JUMP()      { MLI_BACK_EDGE(); pc = code + pc->operand; MLI_PROFILE(); goto *s_dispatchTable[static_cast<int>(pc->opcode)]; }
+
+                MLI_PROFILE();
+                goto *s_dispatchTable[static_cast<int>(pc->opcode)];
+#else
+#define MLI_PROFILE()   if constexpr (t_profile) { m_profile->record(pc->opcode, pc - code); }
+#define MLI_BACK_EDGE() if constexpr (t_tiered) { if (pc->operand <= pc - code && ++m_backEdges[pc->operand] == m_tierThreshold) { m_top = top; return pc->operand; } }
+#define MLI_CASE(name)  case Opcode::name:
+#define MLI_NEXT()      { ++pc; continue; }
+#define MLI_JUMP()      { MLI_BACK_EDGE(); pc = code + pc->operand; continue; }
+
+                for (;;)
+                {
+                    MLI_PROFILE();
+                    switch (pc->opcode)
+                    {
+#endif
+                MLI_CASE(PUSH_INT)
+                {
+                    *top++ = Value::fromInt(pc->operand);
+                    MLI_NEXT();
+                }
+                MLI_CASE(PUSH_REAL)
+                {
+                    *top++ = Value::fromReal(reals[pc->operand]);
+                    MLI_NEXT();
+                }
+                MLI_CASE(PUSH_STRING)
+                {
+                    m_heap.retain(m_constants[pc->operand]);
+                    *top++ = Value::fromString(m_constants[pc->operand]);
+                    MLI_NEXT();
+                }
+                MLI_CASE(LOAD_INT)
+                {
+                    assignedCheck(m_intAssigned, pc);
+                    *top++ = Value::fromInt(m_ints[pc->operand]);
+                    MLI_NEXT();
+                }
+                MLI_CASE(LOAD_REAL)
+                {
+                    assignedCheck(m_realAssigned, pc);
+                    *top++ = Value::fromReal(m_reals[pc->operand]);
+                    MLI_NEXT();
+                }
+                MLI_CASE(LOAD_STRING)
+                {
+                    assignedCheck(m_stringAssigned, pc);
+                    m_heap.retain(m_strings[pc->operand]);
+                    *top++ = Value::fromString(m_strings[pc->operand]);
+                    MLI_NEXT();
+                }
+                MLI_CASE(STORE_INT)
+                {
+                    m_ints[pc->operand] = (--top)->asInt();
+                    m_intAssigned[pc->operand] = true;
+                    MLI_NEXT();
+                }
+                MLI_CASE(STORE_REAL)
+                {
+                    m_reals[pc->operand] = (--top)->asReal();
+                    m_realAssigned[pc->operand] = true;
+                    MLI_NEXT();
+                }
+                MLI_CASE(STORE_STRING)
+                {
+                    storeString(pc->operand, (--top)->asString());
+                    MLI_NEXT();
+                }
+                MLI_CASE(STORE_KEEP_INT)
+                {
+                    m_ints[pc->operand] = top[-1].asInt();
+                    m_intAssigned[pc->operand] = true;
+                    MLI_NEXT();
+                }
+                MLI_CASE(STORE_KEEP_REAL)
+                {
+                    m_reals[pc->operand] = top[-1].asReal();
+                    m_realAssigned[pc->operand] = true;
+                    MLI_NEXT();
+                }
+                MLI_CASE(STORE_KEEP_STRING)
+                {
+                    m_heap.retain(top[-1].asString());
+                    storeString(pc->operand, top[-1].asString());
+                    MLI_NEXT();
+                }
+                MLI_CASE(READ_INT)
+                {
+                    m_ints[pc->operand] = readInt();
+                    m_intAssigned[pc->operand] = true;
+                    MLI_NEXT();
+                }
+                MLI_CASE(READ_REAL)
+                {
+                    m_reals[pc->operand] = readReal();
+                    m_realAssigned[pc->operand] = true;
+                    MLI_NEXT();
+                }
+                MLI_CASE(READ_STRING)
+                {
+                    storeString(pc->operand, readString());
+                    MLI_NEXT();
+                }
+                MLI_CASE(APPEND_STRING)
+                {
+                    assignedCheck(m_stringAssigned, pc->operand);
+                    m_strings[pc->operand] = concatenate(m_strings[pc->operand], top - pc->arity, pc->arity);
+                    top -= pc->arity;
+                    MLI_NEXT();
+                }
+                MLI_CASE(CONCAT)
+                {
+                    Value* operands = top - pc->operand;
+                    operands[0] = Value::fromString(concatenate(operands[0].asString(), operands + 1, pc->operand - 1));
+                    top -= pc->operand - 1;
+                    MLI_NEXT();
+                }
+                MLI_CASE(WRITE)
+                {
+                    write(*--top);
+                    MLI_NEXT();
+                }
+                MLI_CASE(POP)
+                {
+                    release(*--top);
+                    MLI_NEXT();
+                }
+                MLI_CASE(TO_INT)
+                {
+                    Value& operand = top[-1];
+                    operand = Value::fromInt(static_cast<int32_t>(operand.asReal()));
+                    MLI_NEXT();
+                }
+                MLI_CASE(TO_REAL)
+                {
+                    Value& operand = top[-1];
+                    operand = Value::fromReal(operand.asInt());
+                    MLI_NEXT();
+                }
+                MLI_CASE(TO_REAL_SECOND)
+                {
+                    Value& operand = top[-2];
+                    operand = Value::fromReal(operand.asInt());
+                    MLI_NEXT();
+                }
+                MLI_CASE(ADD_INT)
+                {
+                    int32_t right = (--top)->asInt();
+                    Value& left = top[-1];
+                    left = Value::fromInt(wrap(int64_t(left.asInt()) + right));
+                    MLI_NEXT();
+                }
+                MLI_CASE(SUB_INT)
+                {
+                    int32_t right = (--top)->asInt();
+                    Value& left = top[-1];
+                    left = Value::fromInt(wrap(int64_t(left.asInt()) - right));
+                    MLI_NEXT();
+                }
+                MLI_CASE(MUL_INT)
+                {
+                    int32_t right = (--top)->asInt();
+                    Value& left = top[-1];
+                    left = Value::fromInt(wrap(int64_t(left.asInt()) * right));
+                    MLI_NEXT();
+                }
+                MLI_CASE(DIV_INT)
+                {
+                    int32_t right = (--top)->asInt();
+                    divisorCheck(right, pc);
+                    Value& left = top[-1];
+                    left = Value::fromInt(wrap(int64_t(left.asInt()) / right));
+                    MLI_NEXT();
+                }
+                MLI_CASE(ADD_REAL)
+                {
+                    double right = (--top)->asReal();
+                    Value& left = top[-1];
+                    left = Value::fromReal(left.asReal() + right);
+                    MLI_NEXT();
+                }
+                MLI_CASE(SUB_REAL)
+                {
+                    double right = (--top)->asReal();
+                    Value& left = top[-1];
+                    left = Value::fromReal(left.asReal() - right);
+                    MLI_NEXT();
+                }
+                MLI_CASE(MUL_REAL)
+                {
+                    double right = (--top)->asReal();
+                    Value& left = top[-1];
+                    left = Value::fromReal(left.asReal() * right);
+                    MLI_NEXT();
+                }
+                MLI_CASE(DIV_REAL)
+                {
+                    double right = (--top)->asReal();
+                    Value& left = top[-1];
+                    left = Value::fromReal(left.asReal() / right);
+                    MLI_NEXT();
+                }
+                MLI_CASE(NEG_INT)
+                {
+                    Value& operand = top[-1];
+                    operand = Value::fromInt(wrap(-int64_t(operand.asInt())));
+                    MLI_NEXT();
+                }
+                MLI_CASE(NEG_REAL)
+                {
+                    Value& operand = top[-1];
+                    operand = Value::fromReal(-operand.asReal());
+                    MLI_NEXT();
+                }
+                MLI_CASE(NOT)
+                {
+                    Value& operand = top[-1];
+                    operand = Value::fromInt(!operand.asInt());
+                    MLI_NEXT();
+                }
+                MLI_CASE(EQ_INT)
+                {
+                    int32_t right = (--top)->asInt();
+                    Value& left = top[-1];
+                    left = Value::fromInt(left.asInt() == right);
+                    MLI_NEXT();
+                }
+                MLI_CASE(NEQ_INT)
+                {
+                    int32_t right = (--top)->asInt();
+                    Value& left = top[-1];
+                    left = Value::fromInt(left.asInt() != right);
+                    MLI_NEXT();
+                }
+                MLI_CASE(LESS_INT)
+                {
+                    int32_t right = (--top)->asInt();
+                    Value& left = top[-1];
+                    left = Value::fromInt(left.asInt() < right);
+                    MLI_NEXT();
+                }
+                MLI_CASE(GREATER_INT)
+                {
+                    int32_t right = (--top)->asInt();
+                    Value& left = top[-1];
+                    left = Value::fromInt(left.asInt() > right);
+                    MLI_NEXT();
+                }
+                MLI_CASE(LEQ_INT)
+                {
+                    int32_t right = (--top)->asInt();
+                    Value& left = top[-1];
+                    left = Value::fromInt(left.asInt() <= right);
+                    MLI_NEXT();
+                }
+                MLI_CASE(GEQ_INT)
+                {
+                    int32_t right = (--top)->asInt();
+                    Value& left = top[-1];
+                    left = Value::fromInt(left.asInt() >= right);
+                    MLI_NEXT();
+                }
+                MLI_CASE(EQ_REAL)
+                {
+                    double right = (--top)->asReal();
+                    Value& left = top[-1];
+                    left = Value::fromInt(left.asReal() == right);
+                    MLI_NEXT();
+                }
+                MLI_CASE(NEQ_REAL)
+                {
+                    double right = (--top)->asReal();
+                    Value& left = top[-1];
+                    left = Value::fromInt(left.asReal() != right);
+                    MLI_NEXT();
+                }
+                MLI_CASE(LESS_REAL)
+                {
+                    double right = (--top)->asReal();
+                    Value& left = top[-1];
+                    left = Value::fromInt(left.asReal() < right);
+                    MLI_NEXT();
+                }
+                MLI_CASE(GREATER_REAL)
+                {
+                    double right = (--top)->asReal();
+                    Value& left = top[-1];
+                    left = Value::fromInt(left.asReal() > right);
+                    MLI_NEXT();
+                }
+                MLI_CASE(LEQ_REAL)
+                {
+                    double right = (--top)->asReal();
+                    Value& left = top[-1];
+                    left = Value::fromInt(left.asReal() <= right);
+                    MLI_NEXT();
+                }
+                MLI_CASE(GEQ_REAL)
+                {
+                    double right = (--top)->asReal();
+                    Value& left = top[-1];
+                    left = Value::fromInt(left.asReal() >= right);
+                    MLI_NEXT();
+                }
+                MLI_CASE(EQ_STRING)
+                {
+                    Value right = *--top;
+                    top[-1] = Value::fromInt(compareStrings(top[-1], right, [](const auto& l, const auto& r) { return l == r; }));
+                    MLI_NEXT();
+                }
+                MLI_CASE(NEQ_STRING)
+                {
+                    Value right = *--top;
+                    top[-1] = Value::fromInt(compareStrings(top[-1], right, [](const auto& l, const auto& r) { return l != r; }));
+                    MLI_NEXT();
+                }
+                MLI_CASE(LESS_STRING)
+                {
+                    Value right = *--top;
+                    top[-1] = Value::fromInt(compareStrings(top[-1], right, [](const auto& l, const auto& r) { return l < r; }));
+                    MLI_NEXT();
+                }
+                MLI_CASE(GREATER_STRING)
+                {
+                    Value right = *--top;
+                    top[-1] = Value::fromInt(compareStrings(top[-1], right, [](const auto& l, const auto& r) { return l > r; }));
+                    MLI_NEXT();
+                }
+                MLI_CASE(LEQ_STRING)
+                {
+                    Value right = *--top;
+                    top[-1] = Value::fromInt(compareStrings(top[-1], right, [](const auto& l, const auto& r) { return l <= r; }));
+                    MLI_NEXT();
+                }
+                MLI_CASE(GEQ_STRING)
+                {
+                    Value right = *--top;
+                    top[-1] = Value::fromInt(compareStrings(top[-1], right, [](const auto& l, const auto& r) { return l >= r; }));
+                    MLI_NEXT();
+                }
+                MLI_CASE(AND)
+                {
+                    Value right = *--top;
+                    Value& left = top[-1];
+                    left = Value::fromInt(left.asInt() && right.asInt());
+                    MLI_NEXT();
+                }
+                MLI_CASE(OR)
+                {
+                    Value right = *--top;
+                    Value& left = top[-1];
+                    left = Value::fromInt(left.asInt() || right.asInt());
+                    MLI_NEXT();
+                }
+                MLI_CASE(JUMP)
+                {
+                    MLI_JUMP();
+                }
+                MLI_CASE(JUMP_FALSE)
+                {
+                    if (!(--top)->asInt())
+                    {
+                        MLI_JUMP();
+                    }
+                    MLI_NEXT();
+                }
+                MLI_CASE(JUMP_TRUE)
+                {
+                    if ((--top)->asInt())
+                    {
+                        MLI_JUMP();
+                    }
+                    MLI_NEXT();
+                }
+                MLI_CASE(JUMP_FALSE_LAZY)
+                {
+                    if (!top[-1].asInt())
+                    {
+                        MLI_JUMP();
+                    }
+                    MLI_NEXT();
+                }
+                MLI_CASE(JUMP_TRUE_LAZY)
+                {
+                    if (top[-1].asInt())
+                    {
+                        MLI_JUMP();
+                    }
+                    MLI_NEXT();
+                }
+                MLI_CASE(HALT)
+                {
+                    m_top = top;
+                    return s_halted;
+                }
+                MLI_CASE(INC_INT)
+                {
+                    m_ints[pc->arity] = wrap(int64_t(m_ints[pc->arity]) + pc->operand);
+                    MLI_NEXT();
+                }
+                MLI_CASE(LOAD_INT_PUSH_INT)
+                {
+                    *top++ = Value::fromInt(m_ints[pc->arity]);
+                    *top++ = Value::fromInt(pc->operand);
+                    MLI_NEXT();
+                }
+                MLI_CASE(EQ_INT_JUMP_FALSE)
+                {
+                    int32_t right = (--top)->asInt();
+                    if (!((--top)->asInt() == right))
+                    {
+                        MLI_JUMP();
+                    }
+                    MLI_NEXT();
+                }
+                MLI_CASE(NEQ_INT_JUMP_FALSE)
+                {
+                    int32_t right = (--top)->asInt();
+                    if (!((--top)->asInt() != right))
+                    {
+                        MLI_JUMP();
+                    }
+                    MLI_NEXT();
+                }
+                MLI_CASE(LESS_INT_JUMP_FALSE)
+                {
+                    int32_t right = (--top)->asInt();
+                    if (!((--top)->asInt() < right))
+                    {
+                        MLI_JUMP();
+                    }
+                    MLI_NEXT();
+                }
+                MLI_CASE(GREATER_INT_JUMP_FALSE)
+                {
+                    int32_t right = (--top)->asInt();
+                    if (!((--top)->asInt() > right))
+                    {
+                        MLI_JUMP();
+                    }
+                    MLI_NEXT();
+                }
+                MLI_CASE(LEQ_INT_JUMP_FALSE)
+                {
+                    int32_t right = (--top)->asInt();
+                    if (!((--top)->asInt() <= right))
+                    {
+                        MLI_JUMP();
+                    }
+                    MLI_NEXT();
+                }
+                MLI_CASE(GEQ_INT_JUMP_FALSE)
+                {
+                    int32_t right = (--top)->asInt();
+                    if (!((--top)->asInt() >= right))
+                    {
+                        MLI_JUMP();
+                    }
+                    MLI_NEXT();
+                }
+#ifdef MLI_THREADED_DISPATCH
+#pragma GCC diagnostic pop
+#else
+                    }
+                }
+#endif
+
+#undef MLI_PROFILE
+#undef MLI_CASE
+#undef MLI_NEXT
+#undef MLI_JUMP
+#undef MLI_BACK_EDGE
+            }
+
+        public:
+
+            const StringHeap& heap() const
+            {
+                return m_heap;
+            }
+
+            static constexpr int32_t s_halted = -1;
+
+            void execute(const Program& a_program)
+            {
+                reset(a_program);
+                run<false, false>(a_program, 0);
+                OutputBuffer::standard().flush();
+            }
+
+            void profile(const Program& a_program, OpcodeProfile& a_profile)
+            {
+                m_profile = &a_profile;
+                reset(a_program);
+                try
+                {
+                    run<true, false>(a_program, 0);
+                }
+                catch (...)
+                {
+                    OutputBuffer::standard().flush();
+                    m_profile->endRun();
+                    m_profile = nullptr;
+                    throw;
+                }
+                OutputBuffer::standard().flush();
+                m_profile->endRun();
+                m_profile = nullptr;
+            }
+
+            int32_t executeTiered(const Program& a_program, uint32_t a_threshold)
+            {
+                m_tierThreshold = a_threshold;
+                m_backEdges.assign(a_program.code().size(), 0);
+                reset(a_program);
+                return run<false, true>(a_program, 0);
+            }
+
+            int32_t resume(const Program& a_program, int32_t a_pc)
+            {
+                return run<false, true>(a_program, a_pc);
+            }
+
+            bool stackEmpty() const
+            {
+                return m_top == m_stack.data();
+            }
+
+            VariableState snapshot() const
+            {
+                VariableState state{m_ints, m_reals, {}, m_intAssigned, m_realAssigned, m_stringAssigned};
+
+                state.strings.resize(m_strings.size());
+                for (size_t slot = 0; slot < m_strings.size(); ++slot)
+                {
+                    if (m_stringAssigned[slot])
+                    {
+                        state.strings[slot] = m_heap.get(m_strings[slot]);
+                    }
+                }
+
+                return state;
+            }
+    };
+}
+
+#endif // VIRTUAL_MACHINE_HPP
@@ -0,0 +1,570 @@
+#ifndef X86_ASSEMBLER_HPP
+#define X86_ASSEMBLER_HPP
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace mli {
+
+    enum class Reg : uint8_t
+    {
+        RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+        R8, R9, R10, R11, R12, R13, R14, R15
+    };
+
+    enum class Xmm : uint8_t
+    {
+        XMM0, XMM1, XMM2
+    };
+
+    enum class Condition : uint8_t
+    {
+        B  = 0x2,
+        AE = 0x3,
+        E  = 0x4,
+        NE = 0x5,
+        BE = 0x6,
+        A  = 0x7,
+        S  = 0x8,
+        NS = 0x9,
+        P  = 0xA,
+        NP = 0xB,
+        L  = 0xC,
+        GE = 0xD,
+        LE = 0xE,
+        G  = 0xF
+    };
+
+    class X86Assembler
+    {
+        private:
+            std::vector<uint8_t> m_code;
+
+            static int id(Reg a_reg)
+            {
+                return static_cast<int>(a_reg);
+            }
+
+            static int id(Xmm a_reg)
+            {
+                return static_cast<int>(a_reg);
+            }
+
+            void rex(bool a_wide, int a_reg, int a_base)
+            {
+                uint8_t prefix = 0x40 | (a_wide ? 0x08 : 0) | ((a_reg & 8) ? 0x04 : 0) | ((a_base & 8) ? 0x01 : 0);
+                if (prefix != 0x40)
+                {
+                    byte(prefix);
+                }
+            }
+
+            void memory(int a_reg, Reg a_base, int32_t a_displacement)
+            {
+                byte(0x80 | ((a_reg & 7) << 3) | (id(a_base) & 7));
+                if ((id(a_base) & 7) == 4)
+                {
+                    byte(0x24);
+                }
+                dword(a_displacement);
+            }
+
+            void direct(int a_reg, int a_rm)
+            {
+                byte(0xC0 | ((a_reg & 7) << 3) | (a_rm & 7));
+            }
+
+            void memoryOp(bool a_wide, uint8_t a_opcode, int a_reg, Reg a_base, int32_t a_displacement)
+            {
+                rex(a_wide, a_reg, id(a_base));
+                byte(a_opcode);
+                memory(a_reg, a_base, a_displacement);
+            }
+
+            void registerOp(bool a_wide, uint8_t a_opcode, int a_reg, int a_rm)
+            {
+                rex(a_wide, a_reg, a_rm);
+                byte(a_opcode);
+                direct(a_reg, a_rm);
+            }
+
+            void sseRegisterOp(uint8_t a_prefix, bool a_wide, uint8_t a_opcode, int a_reg, int a_rm)
+            {
+                byte(a_prefix);
+                rex(a_wide, a_reg, a_rm);
+                byte(0x0F);
+                byte(a_opcode);
+                direct(a_reg, a_rm);
+            }
+
+            void sseMemoryOp(uint8_t a_prefix, uint8_t a_opcode, int a_reg, Reg a_base, int32_t a_displacement)
+            {
+                byte(a_prefix);
+                rex(false, a_reg, id(a_base));
+                byte(0x0F);
+                byte(a_opcode);
+                memory(a_reg, a_base, a_displacement);
+            }
+
+        public:
+
+            const std::vector<uint8_t>& code() const
+            {
+                return m_code;
+            }
+
+            size_t size() const
+            {
+                return m_code.size();
+            }
+
+            void byte(uint8_t a_value)
+            {
+                m_code.push_back(a_value);
+            }
+
+            void dword(uint32_t a_value)
+            {
+                for (int i = 0; i < 4; ++i)
+                {
+                    byte(a_value >> (8 * i));
+                }
+            }
+
+            void qword(uint64_t a_value)
+            {
+                for (int i = 0; i < 8; ++i)
+                {
+                    byte(a_value >> (8 * i));
+                }
+            }
+
+            void movImm(Reg a_dst, uint64_t a_value)
+            {
+                rex(true, 0, id(a_dst));
+                byte(0xB8 | (id(a_dst) & 7));
+                qword(a_value);
+            }
+
+            void mov(Reg a_dst, Reg a_src)
+            {
+                registerOp(true, 0x89, id(a_src), id(a_dst));
+            }
+
+            void load64(Reg a_dst, Reg a_base, int32_t a_displacement)
+            {
+                memoryOp(true, 0x8B, id(a_dst), a_base, a_displacement);
+            }
+
+            void store64(Reg a_base, int32_t a_displacement, Reg a_src)
+            {
+                memoryOp(true, 0x89, id(a_src), a_base, a_displacement);
+            }
+
+            void load32(Reg a_dst, Reg a_base, int32_t a_displacement)
+            {
+                memoryOp(false, 0x8B, id(a_dst), a_base, a_displacement);
+            }
+
+            void store32(Reg a_base, int32_t a_displacement, Reg a_src)
+            {
+                memoryOp(false, 0x89, id(a_src), a_base, a_displacement);
+            }
+
+            void lea(Reg a_dst, Reg a_base, int32_t a_displacement)
+            {
+                memoryOp(true, 0x8D, id(a_dst), a_base, a_displacement);
+            }
+
+            size_t leaRip(Reg a_dst)
+            {
+                rex(true, id(a_dst), 0);
+                byte(0x8D);
+                byte(0x05 | ((id(a_dst) & 7) << 3));
+                dword(0);
+                return size() - 4;
+            }
+
+            void movzxByteLoad(Reg a_dst, Reg a_base, int32_t a_displacement)
+            {
+                rex(false, id(a_dst), id(a_base));
+                byte(0x0F);
+                byte(0xB6);
+                memory(id(a_dst), a_base, a_displacement);
+            }
+
+            void storeByteReg(Reg a_base, int32_t a_displacement, Reg a_src)
+            {
+                assert(id(a_src) < 4 && "byte store from a register without a legacy low byte");
+                memoryOp(false, 0x88, id(a_src), a_base, a_displacement);
+            }
+
+            void storeImm64(Reg a_base, int32_t a_displacement, int32_t a_value)
+            {
+                memoryOp(true, 0xC7, 0, a_base, a_displacement);
+                dword(a_value);
+            }
+
+            void cmp64(Reg a_left, Reg a_right)
+            {
+                registerOp(true, 0x39, id(a_right), id(a_left));
+            }
+
+            void cmp64(Reg a_left, Reg a_base, int32_t a_displacement)
+            {
+                memoryOp(true, 0x3B, id(a_left), a_base, a_displacement);
+            }
+
+            void cmpImm(Reg a_left, int32_t a_value)
+            {
+                registerOp(true, 0x81, 7, id(a_left));
+                dword(a_value);
+            }
+
+            void add64(Reg a_dst, Reg a_src)
+            {
+                registerOp(true, 0x01, id(a_src), id(a_dst));
+            }
+
+            void sub64(Reg a_dst, Reg a_src)
+            {
+                registerOp(true, 0x29, id(a_src), id(a_dst));
+            }
+
+            void and64(Reg a_dst, Reg a_src)
+            {
+                registerOp(true, 0x21, id(a_src), id(a_dst));
+            }
+
+            void imulImm(Reg a_dst, Reg a_src, int32_t a_value)
+            {
+                registerOp(true, 0x69, id(a_dst), id(a_src));
+                dword(a_value);
+            }
+
+            void div64(Reg a_divisor)
+            {
+                registerOp(true, 0xF7, 6, id(a_divisor));
+            }
+
+            void neg64(Reg a_dst)
+            {
+                registerOp(true, 0xF7, 3, id(a_dst));
+            }
+
+            void shrImm(Reg a_dst, uint8_t a_count)
+            {
+                registerOp(true, 0xC1, 5, id(a_dst));
+                byte(a_count);
+            }
+
+            void movsx64(Reg a_dst, Reg a_src)
+            {
+                registerOp(true, 0x63, id(a_dst), id(a_src));
+            }
+
+            void mov32(Reg a_dst, Reg a_src)
+            {
+                registerOp(false, 0x89, id(a_src), id(a_dst));
+            }
+
+            void syscall()
+            {
+                byte(0x0F);
+                byte(0x05);
+            }
+
+            void repMovsb()
+            {
+                byte(0xF3);
+                byte(0xA4);
+            }
+
+            void loadSigned32(Reg a_dst, Reg a_base, int32_t a_displacement)
+            {
+                memoryOp(true, 0x63, id(a_dst), a_base, a_displacement);
+            }
+
+            void storeByte(Reg a_base, int32_t a_displacement, uint8_t a_value)
+            {
+                memoryOp(false, 0xC6, 0, a_base, a_displacement);
+                byte(a_value);
+            }
+
+            void cmpByte(Reg a_base, int32_t a_displacement, uint8_t a_value)
+            {
+                memoryOp(false, 0x80, 7, a_base, a_displacement);
+                byte(a_value);
+            }
+
+            void cmpDword(Reg a_base, int32_t a_displacement, int8_t a_value)
+            {
+                memoryOp(false, 0x83, 7, a_base, a_displacement);
+                byte(a_value);
+            }
+
+            void cmp32(Reg a_left, Reg a_base, int32_t a_displacement)
+            {
+                memoryOp(false, 0x3B, id(a_left), a_base, a_displacement);
+            }
+
+            void addTo32(Reg a_base, int32_t a_displacement, Reg a_src)
+            {
+                memoryOp(false, 0x01, id(a_src), a_base, a_displacement);
+            }
+
+            void subFrom32(Reg a_base, int32_t a_displacement, Reg a_src)
+            {
+                memoryOp(false, 0x29, id(a_src), a_base, a_displacement);
+            }
+
+            void addImmTo32(Reg a_base, int32_t a_displacement, int32_t a_value)
+            {
+                memoryOp(false, 0x81, 0, a_base, a_displacement);
+                dword(a_value);
+            }
+
+            void neg32(Reg a_base, int32_t a_displacement)
+            {
+                memoryOp(false, 0xF7, 3, a_base, a_displacement);
+            }
+
+            void imul32(Reg a_dst, Reg a_base, int32_t a_displacement)
+            {
+                rex(false, id(a_dst), id(a_base));
+                byte(0x0F);
+                byte(0xAF);
+                memory(id(a_dst), a_base, a_displacement);
+            }
+
+            void cqo()
+            {
+                byte(0x48);
+                byte(0x99);
+            }
+
+            void idiv64(Reg a_divisor)
+            {
+                registerOp(true, 0xF7, 7, id(a_divisor));
+            }
+
+            void cdq()
+            {
+                byte(0x99);
+            }
+
+            void idiv32(Reg a_divisor)
+            {
+                registerOp(false, 0xF7, 7, id(a_divisor));
+            }
+
+            void addImm(Reg a_dst, int32_t a_value)
+            {
+                registerOp(true, 0x81, 0, id(a_dst));
+                dword(a_value);
+            }
+
+            void subImm(Reg a_dst, int32_t a_value)
+            {
+                registerOp(true, 0x81, 5, id(a_dst));
+                dword(a_value);
+            }
+
+            void or64(Reg a_dst, Reg a_src)
+            {
+                registerOp(true, 0x09, id(a_src), id(a_dst));
+            }
+
+            void xor64(Reg a_dst, Reg a_src)
+            {
+                registerOp(true, 0x31, id(a_src), id(a_dst));
+            }
+
+            void test64(Reg a_left, Reg a_right)
+            {
+                registerOp(true, 0x85, id(a_right), id(a_left));
+            }
+
+            void test32(Reg a_left, Reg a_right)
+            {
+                registerOp(false, 0x85, id(a_right), id(a_left));
+            }
+
+            void and8(Reg a_dst, Reg a_src)
+            {
+                registerOp(false, 0x20, id(a_src), id(a_dst));
+            }
+
+            void or8(Reg a_dst, Reg a_src)
+            {
+                registerOp(false, 0x08, id(a_src), id(a_dst));
+            }
+
+            void setcc(Condition a_condition, Reg a_dst)
+            {
+                rex(false, 0, id(a_dst));
+                byte(0x0F);
+                byte(0x90 | static_cast<uint8_t>(a_condition));
+                direct(0, id(a_dst));
+            }
+
+            void movzxByte(Reg a_dst, Reg a_src)
+            {
+                rex(false, id(a_dst), id(a_src));
+                byte(0x0F);
+                byte(0xB6);
+                direct(id(a_dst), id(a_src));
+            }
+
+            void movsdLoad(Xmm a_dst, Reg a_base, int32_t a_displacement)
+            {
+                sseMemoryOp(0xF2, 0x10, id(a_dst), a_base, a_displacement);
+            }
+
+            void movsdStore(Reg a_base, int32_t a_displacement, Xmm a_src)
+            {
+                sseMemoryOp(0xF2, 0x11, id(a_src), a_base, a_displacement);
+            }
+
+            void addsd(Xmm a_dst, Reg a_base, int32_t a_displacement)
+            {
+                sseMemoryOp(0xF2, 0x58, id(a_dst), a_base, a_displacement);
+            }
+
+            void mulsd(Xmm a_dst, Reg a_base, int32_t a_displacement)
+            {
+                sseMemoryOp(0xF2, 0x59, id(a_dst), a_base, a_displacement);
+            }
+
+            void subsd(Xmm a_dst, Reg a_base, int32_t a_displacement)
+            {
+                sseMemoryOp(0xF2, 0x5C, id(a_dst), a_base, a_displacement);
+            }
+
+            void divsd(Xmm a_dst, Reg a_base, int32_t a_displacement)
+            {
+                sseMemoryOp(0xF2, 0x5E, id(a_dst), a_base, a_displacement);
+            }
+
+            void ucomisd(Xmm a_left, Reg a_base, int32_t a_displacement)
+            {
+                sseMemoryOp(0x66, 0x2E, id(a_left), a_base, a_displacement);
+            }
+
+            void ucomisd(Xmm a_left, Xmm a_right)
+            {
+                byte(0x66);
+                byte(0x0F);
+                byte(0x2E);
+                direct(id(a_left), id(a_right));
+            }
+
+            void cvttsd2si(Reg a_dst, Reg a_base, int32_t a_displacement)
+            {
+                sseMemoryOp(0xF2, 0x2C, id(a_dst), a_base, a_displacement);
+            }
+
+            void cvtsi2sd(Xmm a_dst, Reg a_base, int32_t a_displacement)
+            {
+                sseMemoryOp(0xF2, 0x2A, id(a_dst), a_base, a_displacement);
+            }
+
+            void addsd(Xmm a_dst, Xmm a_src)
+            {
+                sseRegisterOp(0xF2, false, 0x58, id(a_dst), id(a_src));
+            }
+
+            void mulsd(Xmm a_dst, Xmm a_src)
+            {
+                sseRegisterOp(0xF2, false, 0x59, id(a_dst), id(a_src));
+            }
+
+            void divsd(Xmm a_dst, Xmm a_src)
+            {
+                sseRegisterOp(0xF2, false, 0x5E, id(a_dst), id(a_src));
+            }
+
+            void cvtsi2sd64(Xmm a_dst, Reg a_src)
+            {
+                sseRegisterOp(0xF2, true, 0x2A, id(a_dst), id(a_src));
+            }
+
+            void cvtsd2si64(Reg a_dst, Xmm a_src)
+            {
+                sseRegisterOp(0xF2, true, 0x2D, id(a_dst), id(a_src));
+            }
+
+            void movqFromXmm(Reg a_dst, Xmm a_src)
+            {
+                sseRegisterOp(0x66, true, 0x7E, id(a_src), id(a_dst));
+            }
+
+            void movqToXmm(Xmm a_dst, Reg a_src)
+            {
+                byte(0x66);
+                rex(true, id(a_dst), id(a_src));
+                byte(0x0F);
+                byte(0x6E);
+                direct(id(a_dst), id(a_src));
+            }
+
+            size_t jmp()
+            {
+                byte(0xE9);
+                dword(0);
+                return size() - 4;
+            }
+
+            size_t jcc(Condition a_condition)
+            {
+                byte(0x0F);
+                byte(0x80 | static_cast<uint8_t>(a_condition));
+                dword(0);
+                return size() - 4;
+            }
+
+            void patch(size_t a_fixup, size_t a_target)
+            {
+                int32_t relative = static_cast<int32_t>(a_target - (a_fixup + 4));
+                std::memcpy(&m_code[a_fixup], &relative, sizeof(relative));
+            }
+
+            size_t call()
+            {
+                byte(0xE8);
+                dword(0);
+                return size() - 4;
+            }
+
+            void call(Reg a_target)
+            {
+                registerOp(false, 0xFF, 2, id(a_target));
+            }
+
+            void jmp(Reg a_target)
+            {
+                registerOp(false, 0xFF, 4, id(a_target));
+            }
+
+            void push(Reg a_reg)
+            {
+                rex(false, 0, id(a_reg));
+                byte(0x50 | (id(a_reg) & 7));
+            }
+
+            void pop(Reg a_reg)
+            {
+                rex(false, 0, id(a_reg));
+                byte(0x58 | (id(a_reg) & 7));
+            }
+
+            void ret()
+            {
+                byte(0xC3);
+            }
+    };
+}
+
+#endif // X86_ASSEMBLER_HPP
@@ -1,34 +1,384 @@
 #include <iostream>
+#include <string_view>
 
 #include "Scanner.hpp"
 #include "Parser.hpp"
 #include "Executer.hpp"
+#include "Bytecode.hpp"
+#include "DefiniteAssignment.hpp"
+#include "BranchProfile.hpp"
+#include "BlockLayout.hpp"
+#include "PartialEvaluator.hpp"
+#include "VirtualMachine.hpp"
+#include "RegisterMachine.hpp"
+#include "Optimizer.hpp"
+#include "GlobalOptimizer.hpp"
+#include "LoopOptimizer.hpp"
+#include "RangeAnalysis.hpp"
+#include "Superinstructions.hpp"
+#include "Jit.hpp"
+#include "TieredMachine.hpp"
+#include "CppEmitter.hpp"
+#include "ElfEmitter.hpp"
 
 namespace mli {
 
+    struct Options
+    {
+        enum class Engine { POLIZ, BYTECODE, REGISTER, JIT, TIERED };
+
+        const char* fileName{};
+        Engine      engine{Engine::BYTECODE};
+        bool        dumpPoliz{};
+        bool        dumpBytecode{};
+        bool        dumpRegisters{};
+        bool        profilePairs{};
+        bool        emitCpp{};
+        const char* emitElf{};
+        const char* profileOut{};
+        const char* profileIn{};
+        bool        partialEval{};
+        const char* inputs{};
+        uint64_t    evalBudget{PartialEvaluator::s_defaultBudget};
+        size_t      evalOutput{PartialEvaluator::s_defaultOutputLimit};
+        bool        perfMap{};
+        bool        traceTiers{};
+        uint32_t    tierThreshold{TieredMachine::s_defaultThreshold};
+        bool        optimize{true};
+        bool        optimizerStats{};
+        int32_t     unrollFactor{LoopOptimizer::s_defaultUnrollFactor};
+        bool        fuse{true};
+        bool        legacyScanner{};
+        bool        dumpTokens{};
+
+        Options(int argc, char** argv)
+        {
+            for (int i = 1; i < argc; ++i)
+            {
+                std::string_view argument{argv[i]};
+
+                if (argument == "--engine=poliz")
+                {
+                    engine = Engine::POLIZ;
+                }
+                else if (argument == "--engine=bytecode")
+                {
+                    engine = Engine::BYTECODE;
+                }
+                else if (argument == "--engine=register")
+                {
+                    engine = Engine::REGISTER;
+                }
+                else if (argument == "--engine=jit")
+                {
+                    engine = Engine::JIT;
+                }
+                else if (argument == "--engine=tiered")
+                {
+                    engine = Engine::TIERED;
+                }
+                else if (argument.starts_with("--tier-threshold="))
+                {
+                    tierThreshold = std::stoul(std::string(argument.substr(argument.find('=') + 1)));
+                }
+                else if (argument == "--trace-tiers")
+                {
+                    traceTiers = true;
+                }
+                else if (argument == "--dump-poliz")
+                {
+                    dumpPoliz = true;
+                }
+                else if (argument == "--dump-bytecode")
+                {
+                    dumpBytecode = true;
+                }
+                else if (argument == "--dump-registers")
+                {
+                    dumpRegisters = true;
+                }
+                else if (argument == "--profile-pairs")
+                {
+                    profilePairs = true;
+                }
+                else if (argument == "--perf-map")
+                {
+                    perfMap = true;
+                }
+                else if (argument == "--emit-cpp")
+                {
+                    emitCpp = true;
+                }
+                else if (argument == "--emit-elf" && i + 1 < argc)
+                {
+                    emitElf = argv[++i];
+                }
+                else if (argument == "--profile-out" && i + 1 < argc)
+                {
+                    profileOut = argv[++i];
+                }
+                else if (argument == "--profile-in" && i + 1 < argc)
+                {
+                    profileIn = argv[++i];
+                }
+                else if (argument == "--partial-eval")
+                {
+                    partialEval = true;
+                }
+                else if (argument == "--inputs" && i + 1 < argc)
+                {
+                    partialEval = true;
+                    inputs = argv[++i];
+                }
+                else if (argument.starts_with("--eval-budget="))
+                {
+                    evalBudget = std::stoull(std::string(argument.substr(argument.find('=') + 1)));
+                }
+                else if (argument.starts_with("--eval-output="))
+                {
+                    evalOutput = std::stoull(std::string(argument.substr(argument.find('=') + 1)));
+                }
+                else if (argument == "--no-optimize")
+                {
+                    optimize = false;
+                }
+                else if (argument.starts_with("--unroll="))
+                {
+                    unrollFactor = std::stoi(std::string(argument.substr(argument.find('=') + 1)));
+                }
+                else if (argument == "--optimizer-stats")
+                {
+                    optimizerStats = true;
+                }
+                else if (argument == "--no-fuse")
+                {
+                    fuse = false;
+                }
+                else if (argument == "--legacy-scanner")
+                {
+                    legacyScanner = true;
+                }
+                else if (argument == "--dump-tokens")
+                {
+                    dumpTokens = true;
+                }
+                else if (argument.starts_with("--") || fileName)
+                {
+                    throw std::runtime_error("[main]: invalid argument " + std::string(argument));
+                }
+                else
+                {
+                    fileName = argv[i];
+                }
+            }
+
+            if (!fileName)
+            {
+                throw std::runtime_error("[main]: invalid number of arguments");
+            }
+        }
+    };
+
     class Interpretator
     {
         private:
-            std::string m_fileName;
-            Parser      m_parser;
-            Executer    m_executer;
+            Options              m_options;
+            std::string          m_fileName;
+            Parser               m_parser;
+            Executer             m_executer;
+            Program              m_program;
+            Program              m_profiled;
+            std::vector<int32_t> m_origins;
+            VirtualMachine       m_machine;
+            RegisterProgram      m_registerProgram;
+            RegisterMachine      m_registerMachine;
+            JitMachine           m_jit;
+            TieredMachine        m_tiered;
 
         public:
 
-            Interpretator(const char* a_fileName)
-                : m_fileName(a_fileName), m_parser(a_fileName)
+            Interpretator(const Options& a_options)
+                : m_options(a_options), m_fileName(a_options.fileName), m_parser(a_options.fileName, a_options.legacyScanner),
+                  m_tiered(a_options.tierThreshold, a_options.traceTiers)
             {
                 m_parser.analyze();
+                Compiler compiler{m_parser.fetchPoliz(), m_parser.fetchVariables()};
+                m_program = compiler.compile();
+                m_origins = compiler.origins();
+
+                DefiniteAssignment assignment{m_program};
+                m_program = m_profiled = assignment.check();
+
+                if (m_options.optimizerStats)
+                {
+                    std::cerr << "[DefiniteAssignment]: " << assignment.checked() << " of "
+                              << assignment.checked() + assignment.unchecked() << " loads checked\n";
+                }
+
+                if (m_options.profileIn)
+                {
+                    BlockLayout layout{m_program, BranchProfile::load(m_options.profileIn).counts(m_origins)};
+                    m_program = layout.layout();
+
+                    if (m_options.optimizerStats)
+                    {
+                        std::cerr << "[BlockLayout]: " << layout.inverted() << " branches inverted, "
+                                  << layout.cold() << " cold blocks moved\n";
+                    }
+                }
+
+                if (m_options.partialEval)
+                {
+                    PartialEvaluator evaluator{m_program, m_options.inputs ? PartialEvaluator::load(m_options.inputs) : "", m_options.evalBudget, m_options.evalOutput};
+                    m_program = evaluator.evaluate();
+
+                    if (m_options.optimizerStats)
+                    {
+                        std::cerr << "[PartialEvaluator]: " << evaluator.evaluated() << " instructions evaluated, "
+                                  << evaluator.consumed() << " inputs consumed, ";
+                        if (evaluator.folded())
+                        {
+                            std::cerr << "program folded\n";
+                        }
+                        else
+                        {
+                            std::cerr << "resumed at " << evaluator.resumed() << "\n";
+                        }
+                    }
+                }
+
+                if (m_options.optimize)
+                {
+                    Optimizer optimizer{m_program};
+                    m_program = optimizer.optimize();
+
+                    if (m_options.optimizerStats)
+                    {
+                        std::cerr << "[Optimizer]: " << optimizer.before() << " -> " << m_program.code().size() << " instructions\n";
+                    }
+
+                    GlobalOptimizer global{m_program};
+                    size_t before = m_program.code().size();
+                    m_program = global.optimize();
+
+                    if (m_options.optimizerStats)
+                    {
+                        std::cerr << "[GlobalOptimizer]: " << before << " -> " << m_program.code().size() << " instructions, "
+                                  << global.constants() << " constants, " << global.redundant() << " redundant expressions, "
+                                  << global.deadStores() << " dead stores\n";
+                    }
+
+                    LoopOptimizer loops{m_program, m_options.unrollFactor};
+                    m_program = loops.optimize();
+
+                    if (m_options.optimizerStats)
+                    {
+                        std::cerr << "[LoopOptimizer]: " << loops.loops() << " loops, " << loops.hoisted() << " invariant expressions hoisted, "
+                                  << loops.reduced() << " induction expressions reduced, " << loops.inverted() << " inverted, "
+                                  << loops.unrolled() << " copies unrolled\n";
+                    }
+                }
+
+                RangeAnalysis ranges{m_program};
+                m_program = ranges.analyze();
+
+                if (m_options.optimizerStats)
+                {
+                    std::cerr << "[RangeAnalysis]: " << ranges.checked() << " of " << ranges.checked() + ranges.unchecked()
+                              << " divisions checked, " << ranges.exact() << " of " << ranges.exact() + ranges.wrapping()
+                              << " int operations exact\n";
+                }
+
+                m_registerProgram = RegisterTranslator(m_program).translate();
+
+                if (m_options.fuse)
+                {
+                    m_program = Fuser(m_program).fuse();
+                }
             }
 
             void run()
             {
-                m_executer.executePoliz(m_parser.fetchPoliz());
+                if (m_options.dumpPoliz)
+                {
+                    semanticalUnitTest();
+                }
+
+                if (m_options.dumpBytecode)
+                {
+                    m_program.dump(std::cout);
+                }
+
+                if (m_options.dumpRegisters)
+                {
+                    m_registerProgram.dump(std::cout);
+                }
+
+                if (m_options.emitCpp)
+                {
+                    CppEmitter(m_program).emit(std::cout);
+                }
+                else if (m_options.emitElf)
+                {
+                    ElfEmitter(m_program).write(m_options.emitElf);
+                }
+                else if (m_options.engine == Options::Engine::POLIZ)
+                {
+                    m_executer.executePoliz(m_parser.fetchPoliz());
+                }
+                else if (m_options.profileOut)
+                {
+                    // A training run that fails still saves the branches it took before the error.
+                    OpcodeProfile profile{};
+                    try
+                    {
+                        m_machine.profile(m_profiled, profile);
+                    }
+                    catch (...)
+                    {
+                        BranchProfile(profile, m_origins).save(m_options.profileOut);
+                        throw;
+                    }
+                    BranchProfile(profile, m_origins).save(m_options.profileOut);
+                }
+                else if (m_options.profilePairs)
+                {
+                    OpcodeProfile profile{};
+                    m_machine.profile(m_program, profile);
+                    std::cout.flush();
+                    profile.report(std::cerr);
+                }
+                else if (m_options.engine == Options::Engine::REGISTER)
+                {
+                    m_registerMachine.execute(m_registerProgram);
+                }
+                else if (m_options.engine == Options::Engine::TIERED)
+                {
+                    m_tiered.execute(m_program);
+                }
+                else if (m_options.engine == Options::Engine::JIT && m_jit.compile(m_program))
+                {
+                    if (m_options.perfMap)
+                    {
+                        m_jit.writePerfMap(m_fileName);
+                    }
+
+                    m_jit.execute();
+                }
+                else
+                {
+                    if (m_options.engine == Options::Engine::JIT)
+                    {
+                        std::cerr << "[Jit]: " << m_jit.reason() << ", falling back to the interpreter\n";
+                    }
+
+                    m_machine.execute(m_program);
+                }
             }
 
-            void lexicalUnitTest()
+            static void lexicalUnitTest(const Options& a_options)
             {
-                Scanner scaner(m_fileName);
+                Scanner scaner(a_options.fileName, a_options.legacyScanner);
 
                 Token token{};
                 while((token = scaner.getToken()).getType() != Token::Type::FINISH)
@@ -60,17 +410,19 @@ int main(int argc, char** argv)
 {
     try
     {
-        if (argc != 2)
+        mli::Options options(argc, argv);
+        if (options.dumpTokens)
         {
-            throw std::runtime_error("[main]: invalid number of arguments");
+            mli::Interpretator::lexicalUnitTest(options);
+            return EXIT_SUCCESS;
         }
 
-        mli::Interpretator app{ argv[1] };
-        app.semanticalUnitTest();
+        mli::Interpretator app{options};
         app.run();
     }
     catch (const std::exception& error)
     {
+        mli::OutputBuffer::standard().flush();
         std::cerr << error.what() << std::endl;
         return EXIT_FAILURE;
     }
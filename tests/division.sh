@@ -0,0 +1,37 @@
+#!/bin/sh
+# Runs a division whose divisor truncates to 0 on every engine and expects the
+# interpreter's "division by zero" error rather than a trap.
+# usage: tests/division.sh <mli>
+
+mli=$1
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+cat > "$work/program" <<'PROGRAM'
+program
+{
+    int a, b = 5, c;
+    read (a);
+    c = 7 / (a / b);
+    write (c);
+}
+PROGRAM
+
+status=0
+for flags in "--engine=poliz" "--engine=bytecode" "--engine=bytecode --no-optimize" "--engine=register" \
+             "--engine=jit" "--engine=tiered" "--partial-eval"
+do
+    echo 1 | "$mli" $flags "$work/program" > "$work/output" 2>&1
+    code=$?
+    if [ $code -gt 128 ] || ! grep -q "division by zero" "$work/output"
+    then
+        echo "FAIL $flags (exit $code)"
+        cat "$work/output"
+        status=1
+    else
+        echo "PASS $flags"
+    fi
+done
+
+exit $status
@@ -0,0 +1,38 @@
+#!/bin/sh
+# Builds each program with --emit-cpp and diffs the native binary's output
+# against the POLIZ Executer.
+# usage: tests/emit_cpp.sh <mli> [programs...]
+
+set -e
+
+mli=$1
+shift
+[ $# -gt 0 ] || set -- tests/test1 tests/test2 tests/test3 tests/test4 tests/test5
+
+root=$(cd "$(dirname "$0")/.." && pwd)
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+status=0
+for program in "$@"
+do
+    name=$(basename "$program")
+    input="$work/$name.in"
+    echo "hello 42 2.5" > "$input"
+
+    "$mli" --emit-cpp "$program" > "$work/$name.cpp"
+    ${CXX:-c++} -O2 -std=c++20 -I "$root/src" "$work/$name.cpp" -o "$work/$name"
+
+    "$mli" --engine=poliz "$program" < "$input" > "$work/$name.expected" 2>&1 || true
+    "$work/$name" < "$input" > "$work/$name.actual" 2>&1 || true
+
+    if diff -u "$work/$name.expected" "$work/$name.actual"
+    then
+        echo "PASS $program"
+    else
+        echo "FAIL $program"
+        status=1
+    fi
+done
+
+exit $status
@@ -0,0 +1,48 @@
+#!/bin/sh
+# Builds each program with --emit-elf and diffs the executable's output
+# against the bytecode interpreter, for every line of input below.
+# usage: tests/emit_elf.sh <mli> [programs...]
+
+set -e
+
+mli=$1
+shift
+[ $# -gt 0 ] || set -- tests/test1 tests/test2 tests/test3 tests/test4 tests/test5
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+status=0
+for program in "$@"
+do
+    name=$(basename "$program")
+    "$mli" --emit-elf "$work/$name" "$program"
+
+    while read -r line
+    do
+        input="$work/$name.in"
+        echo "$line" > "$input"
+
+        "$mli" --engine=bytecode "$program" < "$input" > "$work/$name.expected" 2>&1 || true
+        "$work/$name" < "$input" > "$work/$name.actual" 2>&1 || true
+
+        if diff -u "$work/$name.expected" "$work/$name.actual"
+        then
+            echo "PASS $program < '$line'"
+        else
+            echo "FAIL $program < '$line'"
+            status=1
+        fi
+    done <<INPUTS
+hello 42 2.5
+7 2.5 word -3 1e3 tail
+-2147483649 tail 1 2 3
+-2147483648 -0 x 2147483648 4 y
+1e400 2.5e-320 7 x
+12 .5e2 a 5 1e x 1 2 z
++3 -.25 b - 1 c
+
+INPUTS
+done
+
+exit $status
@@ -0,0 +1,32 @@
+#!/bin/sh
+# Dumps the tokens of each program with the table-driven lexer and with the
+# legacy State machine scanner, and diffs the two.
+# usage: tests/lexer_diff.sh <mli> [programs...]
+
+set -e
+
+mli=$1
+shift
+[ $# -gt 0 ] || set -- tests/test1 tests/test2 tests/test3
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+status=0
+for program in "$@"
+do
+    name=$(basename "$program")
+
+    "$mli" --dump-tokens --legacy-scanner "$program" > "$work/$name.expected" 2>&1 || true
+    "$mli" --dump-tokens "$program" > "$work/$name.actual" 2>&1 || true
+
+    if diff -u "$work/$name.expected" "$work/$name.actual"
+    then
+        echo "PASS $program"
+    else
+        echo "FAIL $program"
+        status=1
+    fi
+done
+
+exit $status
@@ -0,0 +1,57 @@
+#!/bin/sh
+# Partially evaluates each program under several output limits and diffs the
+# result against the bytecode interpreter. A program that writes more than the
+# limit must be resumed at run time, not folded into its output.
+# usage: tests/partial_eval.sh <mli> [programs...]
+
+set -e
+
+mli=$1
+shift
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+# Folded NaNs must print like the interpreter's canonical one, whatever sign the host gives them.
+cat > "$work/nan" <<'PROGRAM'
+program
+{
+    int i3 = 3;
+    real r0 = 0.0, r;
+    r = (r0 - r0) / (i3 - 3);
+    write (r, 0.0 / 0.0);
+}
+PROGRAM
+
+[ $# -gt 0 ] || set -- tests/test1 tests/test2 tests/test3 tests/test4 bench/output "$work/nan"
+
+status=0
+for program in "$@"
+do
+    name=$(basename "$program")
+    input="$work/$name.in"
+    echo "hello 42 2.5" > "$input"
+
+    "$mli" --engine=bytecode --no-optimize "$program" < "$input" > "$work/$name.expected" 2>&1 || true
+    written=$(wc -c < "$work/$name.expected")
+
+    for limit in 0 16 4096 65536
+    do
+        "$mli" --partial-eval --eval-budget=100000000 --eval-output=$limit --optimizer-stats "$program" \
+            < "$input" > "$work/$name.actual" 2> "$work/$name.stats" || true
+
+        if ! diff -u "$work/$name.expected" "$work/$name.actual"
+        then
+            echo "FAIL $program --eval-output=$limit"
+            status=1
+        elif [ "$written" -gt "$limit" ] && grep -q "program folded" "$work/$name.stats"
+        then
+            echo "FAIL $program --eval-output=$limit: $written bytes of output folded"
+            status=1
+        else
+            echo "PASS $program --eval-output=$limit"
+        fi
+    done
+done
+
+exit $status